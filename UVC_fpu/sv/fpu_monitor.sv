@@ -8,6 +8,17 @@ class top_core_monitor extends uvm_monitor;
     logic [31:0] fp_reg_file[32];
     logic [31:0] int_reg_file[32];
     logic [31:0] last_pc;
+    logic [4:0]  last_fflags;   // Accrued fflags after the previous retirement
+    
+    // fcsr is written in WB, cycles after an instruction is fetched, so
+    // fetched packets wait here until their retirement supplies fflags
+    fpu_packet   pending[$];
+    int          max_pending = 64;  // Enough for the slowest FP divide to retire
+    
+    // Instruction that left MEM for WB at the previous sample
+    bit          retire_valid = 0;
+    logic [31:0] retire_pc;
+    logic [31:0] retire_insn;
     
     function new(string name = "top_core_monitor", uvm_component parent = null);
         super.new(name, parent);
@@ -26,6 +37,7 @@ class top_core_monitor extends uvm_monitor;
             int_reg_file[i] = i;
         end
         last_pc = 32'h8000_0000;
+        last_fflags = '0;
     endfunction
     
     virtual task run_phase(uvm_phase phase);
@@ -41,11 +53,19 @@ class top_core_monitor extends uvm_monitor;
             // Update register file tracking
             update_register_file(monitored_item);
             
-            // Send to scoreboard
-            item_collected_port.write(monitored_item);
+            // Send to scoreboard once retired
+            pending.push_back(monitored_item);
+            collect_retirement();
+            while (pending.size() > max_pending) item_collected_port.write(pending.pop_front());
         end
     endtask
     
+    // Packets still in flight at the end of the run go out without fflags
+    virtual function void extract_phase(uvm_phase phase);
+        super.extract_phase(phase);
+        while (pending.size() > 0) item_collected_port.write(pending.pop_front());
+    endfunction
+    
     virtual task collect_transaction(fpu_packet item);
         // Wait for clock edge
         @(vif.monitor_cb);
@@ -59,6 +79,10 @@ class top_core_monitor extends uvm_monitor;
         item.memW_en_MEM = vif.monitor_cb.memW_en_MEM;
         item.dmem_dataOUT = vif.monitor_cb.dmem_dataOUT;
         
+        // Filled in when the instruction retires
+        item.fflags = 'x;
+        item.fflags_accrued = 'x;
+        
         // Decode instruction
         item.decode_instruction();
         
@@ -76,6 +100,52 @@ class top_core_monitor extends uvm_monitor;
                  UVM_HIGH)
     endtask
     
+    virtual function void collect_retirement();
+        logic [4:0] raised = 'x;
+        
+        // fcsr now includes the WB write of the instruction that left MEM
+        // at the previous sample. The core only accrues flags, so what it
+        // raised is what became set since the last retirement; CSR writes
+        // are taken as is.
+        if (retire_valid) begin
+            if (!$isunknown(vif.monitor_cb.fcsr)) begin
+                raised = (retire_insn[6:0] != OP_SYSTEM) ? vif.monitor_cb.fcsr[4:0] & ~last_fflags : '0;
+            end
+            retire(retire_pc, retire_insn, raised, last_fflags);
+            if (!$isunknown(vif.monitor_cb.fcsr)) last_fflags = vif.monitor_cb.fcsr[4:0];
+        end
+        
+        retire_valid = (vif.monitor_cb.MEM_WB_en === 1'b1) && (vif.monitor_cb.pc_curr_MEM != 0);
+        retire_pc = vif.monitor_cb.pc_curr_MEM;
+        retire_insn = vif.monitor_cb.inst_MEM;
+    endfunction
+    
+    // Writes the pending packets up to the retiring one. Those ahead of it
+    // never retired (flushed, or sampled again while fetch stalled, in
+    // which case the last sample is the one that retires) and go out
+    // without fflags.
+    virtual function void retire(logic [31:0] pc, logic [31:0] insn, logic [4:0] raised, logic [4:0] accrued);
+        fpu_packet item;
+        int match = -1;
+        
+        foreach (pending[i]) begin
+            if (pending[i].pc_curr === pc && pending[i].instruction === insn) match = i;
+            else if (match >= 0) break;
+        end
+        if (match < 0) begin
+            `uvm_info(get_type_name(),
+                     $sformatf("Retirement of 0x%08h at PC=0x%08h matches no fetched instruction", insn, pc),
+                     UVM_HIGH)
+            return;
+        end
+        
+        repeat (match) item_collected_port.write(pending.pop_front());
+        item = pending.pop_front();
+        item.fflags = raised;
+        item.fflags_accrued = accrued;
+        item_collected_port.write(item);
+    endfunction
+    
     virtual function void update_register_file(fpu_packet item);
         // Update FP register file based on instruction type
         if (item.instr_category == INSTR_CAT_FLOAT) begin
@@ -15,6 +15,8 @@ class fpu_packet extends uvm_sequence_item;
     logic [2:0]  func3_MEM;
     logic        memW_en_MEM;
     logic [31:0] dmem_dataOUT;
+    logic [4:0]  fflags;       // Exception flags newly set in fcsr (NV,DZ,OF,UF,NX), X if not observed
+    logic [4:0]  fflags_accrued;  // Flags already set before the instruction, not seen again
     
     //===========================================
     // Expected Outputs (for Scoreboard)
@@ -37,6 +39,7 @@ class fpu_packet extends uvm_sequence_item;
     
     // Expected FP result (for scoreboard checking)
     logic [31:0] exp_fp_result;
+    logic [4:0]  exp_fflags;
     
     //===========================================
     // Instruction Decoding Fields
@@ -85,6 +85,64 @@ package fpu_pkg;
         INSTR_CAT_SYSTEM
     } instr_category_e;
     
+    // Native RV32F reference engine (spike/fp32_ref.cpp): bit-exact result
+    // and fflags for one instruction; returns 0, or -1 for an illegal encoding
+    import "DPI-C" function int fp32_ref_execute(
+        input  int instruction,
+        input  int op1,
+        input  int op2,
+        input  int op3,
+        input  int frm,
+        output int result,
+        output int fflags
+    );
+    
+    // Batch evaluation of one operation (spike/fp32_batch.cpp) on the host
+    // FPU; op is FP32_BATCH_*, returns the lane count or -1
+    localparam int FP32_BATCH_ADD    = 0;
+    localparam int FP32_BATCH_SUB    = 1;
+    localparam int FP32_BATCH_MUL    = 2;
+    localparam int FP32_BATCH_DIV    = 3;
+    localparam int FP32_BATCH_SQRT   = 4;
+    localparam int FP32_BATCH_FMADD  = 5;
+    localparam int FP32_BATCH_FMSUB  = 6;
+    localparam int FP32_BATCH_FNMSUB = 7;
+    localparam int FP32_BATCH_FNMADD = 8;
+    
+    import "DPI-C" function int fp32_ref_batch(
+        input  int  op,
+        input  int  rm,
+        input  int  a[],
+        input  int  b[],
+        input  int  c[],
+        output int  result[],
+        output byte fflags[]
+    );
+    
+    // Corner-case operand generator (spike/fp32_corner.cpp): seeded batches
+    // of operands aimed at one corner class each, picked by weight.
+    // FP32_CORNER_WORDS ints per entry: a, b, c and a control word with the
+    // rounding mode in [2:0] and the class in [15:8]
+    localparam int FP32_CORNER_RANDOM    = 0;
+    localparam int FP32_CORNER_SUBNORMAL = 1;
+    localparam int FP32_CORNER_TIE       = 2;
+    localparam int FP32_CORNER_OVERFLOW  = 3;
+    localparam int FP32_CORNER_UNDERFLOW = 4;
+    localparam int FP32_CORNER_CANCEL    = 5;
+    localparam int FP32_CORNER_SPECIAL   = 6;
+    localparam int FP32_CORNER_CLASSES   = 7;
+    localparam int FP32_CORNER_WORDS     = 4;
+    
+    import "DPI-C" function chandle fp32_corner_open(input longint seed);
+    import "DPI-C" function void fp32_corner_close(input chandle gen);
+    import "DPI-C" function int fp32_corner_weight(input chandle gen, input int corner, input int weight);
+    import "DPI-C" function int fp32_corner_fill(
+        input  chandle gen,
+        input  int     op,
+        input  int     rm_mask,
+        output int     entries[]
+    );
+    
     // Helper functions
     function automatic logic [31:0] encode_fpu_r4(
         input logic [4:0] rd,
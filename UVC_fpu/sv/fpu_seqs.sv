@@ -435,3 +435,110 @@ class riscv_f_extension_seq extends top_core_base_seq;
     
 endclass
 
+
+
+class top_core_fp_corner_seq extends top_core_base_seq;
+    `uvm_object_utils(top_core_fp_corner_seq)
+    
+    // Test configuration
+    int num_fp_ops = 200;
+    longint seed = 1;              // Same seed, same operands and rounding modes
+    int batch_size = 64;           // Entries per fp32_corner_fill() call
+    int rm_mask = 0;               // Rounding modes to draw (bit n for mode n), 0 for all
+    int corner_weights[int];       // FP32_CORNER_* class -> weight; unset classes keep the default
+    
+    // Operand registers, and x5 as scratch for building their values
+    localparam logic [4:0] SCRATCH_XREG = 5'd5;
+    localparam logic [4:0] RD_FREG = 5'd4;
+    
+    function new(string name = "top_core_fp_corner_seq");
+        super.new(name);
+        enable_fp_ops = 1;
+    endfunction
+    
+    virtual task body();
+        static string corner_names[FP32_CORNER_CLASSES] = '{"random", "subnormal", "tie", "overflow",
+                                                           "underflow", "cancel", "special"};
+        chandle gen = fp32_corner_open(seed);
+        int entries[];
+        
+        if (gen == null) begin
+            `uvm_fatal(get_type_name(), "Cannot create the corner-case operand generator")
+        end
+        foreach (corner_weights[c]) begin
+            if (fp32_corner_weight(gen, c, corner_weights[c]) != 0) begin
+                `uvm_error(get_type_name(), $sformatf("Bad weight %0d for corner class %0d", corner_weights[c], c))
+            end
+        end
+        
+        `uvm_info(get_type_name(), $sformatf("Starting FP corner-case sequence: %0d ops, seed %0d", num_fp_ops, seed), UVM_LOW)
+        
+        // One operation per batch, rotating through all nine
+        for (int base = 0; base < num_fp_ops; base += batch_size) begin
+            int op = (base / batch_size) % (FP32_BATCH_FNMADD + 1);
+            int count = (num_fp_ops - base < batch_size) ? num_fp_ops - base : batch_size;
+            
+            entries = new[count * FP32_CORNER_WORDS];
+            if (fp32_corner_fill(gen, op, rm_mask, entries) != count) begin
+                `uvm_error(get_type_name(), $sformatf("Corner-case generator failed for op %0d", op))
+                break;
+            end
+            
+            for (int i = 0; i < count; i++) begin
+                int word = i * FP32_CORNER_WORDS;
+                rounding_mode_e rm = rounding_mode_e'(entries[word + 3][2:0]);
+                int corner = (entries[word + 3] >> 8) & 'hFF;
+                
+                load_fp_reg(5'd1, entries[word]);
+                if (op != FP32_BATCH_SQRT) load_fp_reg(5'd2, entries[word + 1]);
+                if (op >= FP32_BATCH_FMADD) load_fp_reg(5'd3, entries[word + 2]);
+                
+                send_instruction(encode_op(op, rm), $sformatf("fp_corner_%0d", base + i));
+                
+                `uvm_info("GEN_INST", $sformatf("Corner %s op %0d: f1=0x%08h f2=0x%08h f3=0x%08h rm=%s",
+                          corner_names[corner], op, entries[word], entries[word + 1], entries[word + 2],
+                          rm.name()), UVM_HIGH)
+            end
+        end
+        
+        fp32_corner_close(gen);
+        `uvm_info(get_type_name(), "FP corner-case sequence completed", UVM_LOW)
+    endtask
+    
+    // Instruction for one FP32_BATCH_* operation: f4 = op(f1, f2, f3)
+    virtual function logic [31:0] encode_op(int op, rounding_mode_e rm);
+        case (op)
+            FP32_BATCH_ADD:    return {FADD_S,  2'b00, 5'd2, 5'd1, rm, RD_FREG, OP_FP};
+            FP32_BATCH_SUB:    return {FSUB_S,  2'b00, 5'd2, 5'd1, rm, RD_FREG, OP_FP};
+            FP32_BATCH_MUL:    return {FMUL_S,  2'b00, 5'd2, 5'd1, rm, RD_FREG, OP_FP};
+            FP32_BATCH_DIV:    return {FDIV_S,  2'b00, 5'd2, 5'd1, rm, RD_FREG, OP_FP};
+            FP32_BATCH_SQRT:   return {FSQRT_S, 2'b00, 5'd0, 5'd1, rm, RD_FREG, OP_FP};
+            FP32_BATCH_FMADD:  return {5'd3, 2'b00, 5'd2, 5'd1, rm, RD_FREG, OP_FMADD};
+            FP32_BATCH_FMSUB:  return {5'd3, 2'b00, 5'd2, 5'd1, rm, RD_FREG, OP_FMSUB};
+            FP32_BATCH_FNMSUB: return {5'd3, 2'b00, 5'd2, 5'd1, rm, RD_FREG, OP_FNMSUB};
+            default:           return {5'd3, 2'b00, 5'd2, 5'd1, rm, RD_FREG, OP_FNMADD};
+        endcase
+    endfunction
+    
+    // Put a value in an FP register: lui/addi into the scratch register, then fmv.w.x
+    virtual task load_fp_reg(logic [4:0] freg, logic [31:0] value);
+        logic [31:0] upper = value + 32'h800;   // addi sign-extends its immediate
+        
+        send_instruction({upper[31:12], SCRATCH_XREG, OP_LUI}, "fp_corner_lui");
+        send_instruction({value[11:0], SCRATCH_XREG, 3'b000, SCRATCH_XREG, OP_OP_IMM}, "fp_corner_addi");
+        send_instruction({FMV_W_X, 2'b00, 5'd0, SCRATCH_XREG, 3'b000, freg, OP_FP}, "fp_corner_fmv");
+        fp_regs[freg] = value;
+    endtask
+    
+    virtual task send_instruction(logic [31:0] instruction, string name);
+        fpu_packet item = fpu_packet::type_id::create(name);
+        
+        start_item(item);
+        item.latency = $urandom_range(1, 3);
+        item.instruction = instruction;
+        item.decode_instruction();
+        finish_item(item);
+        #10;
+    endtask
+    
+endclass
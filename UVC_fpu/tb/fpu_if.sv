@@ -9,6 +9,13 @@ interface top_core_if(input logic clk);
     logic [2:0]  func3_MEM;
     logic        memW_en_MEM;
     logic [31:0] dmem_dataOUT;
+    logic [7:0]  fcsr;          // Probed from the core's CSR file (frm, accrued fflags)
+    
+    // Probed from the core's MEM stage: the instruction there moves to WB
+    // (retires) at the next edge when MEM_WB_en is set
+    logic [31:0] pc_curr_MEM;
+    logic [31:0] inst_MEM;
+    logic        MEM_WB_en;
     
     // Clocking blocks for driver and monitor
     clocking driver_cb @(posedge clk);
@@ -33,6 +40,10 @@ interface top_core_if(input logic clk);
         input func3_MEM;
         input memW_en_MEM;
         input dmem_dataOUT;
+        input fcsr;
+        input pc_curr_MEM;
+        input inst_MEM;
+        input MEM_WB_en;
     endclocking
     
     // Modports
@@ -142,3 +142,43 @@ class riscv_f_extension_test extends top_core_base_test;
     
 endclass
 
+
+
+
+class top_core_fp_corner_test extends top_core_base_test;
+    `uvm_component_utils(top_core_fp_corner_test)
+    
+    longint seed = 1;
+    
+    function new(string name = "top_core_fp_corner_test", uvm_component parent = null);
+        super.new(name, parent);
+        num_transactions = 450;
+    endfunction
+    
+    virtual function void build_phase(uvm_phase phase);
+        super.build_phase(phase);
+        void'(uvm_config_db#(longint)::get(this, "", "fp_corner_seed", seed));
+    endfunction
+    
+    virtual task run_phase(uvm_phase phase);
+        top_core_fp_corner_seq corner_seq;
+        
+        phase.raise_objection(this);
+        
+        `uvm_info(get_type_name(), "Starting FP corner-case test", UVM_LOW)
+        
+        // Corner-case operands from the C++ generator, 50 per operation
+        corner_seq = top_core_fp_corner_seq::type_id::create("corner_seq");
+        corner_seq.num_fp_ops = num_transactions;
+        corner_seq.batch_size = 50;
+        corner_seq.seed = seed;
+        corner_seq.start(env.agent.sequencer);
+        
+        // Wait for completion
+        #2000;
+        
+        `uvm_info(get_type_name(), "FP corner-case test completed", UVM_LOW)
+        phase.drop_objection(this);
+    endtask
+    
+endclass
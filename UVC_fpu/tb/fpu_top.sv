@@ -35,6 +35,13 @@ module top_tb;
         .dmem_dataOUT(vif.dmem_dataOUT)
     );
     
+    // Not ports of the core; the monitor derives each retirement's fflags
+    // from fcsr after the instruction leaves MEM
+    assign vif.fcsr = dut.CSR.fcsr;
+    assign vif.pc_curr_MEM = dut.pc_curr_MEM;
+    assign vif.inst_MEM = dut.inst_MEM;
+    assign vif.MEM_WB_en = dut.MEM_WB_en;
+    
     // Initial block for UVM
     initial begin
         // Set virtual interface in config db
@@ -21,6 +21,11 @@
 
 // compile files
 
+// Native FP reference model (DPI)
+/home/cc/fpu_uvm/spike/fp32_ref.cpp
+/home/cc/fpu_uvm/spike/fp32_batch.cpp
+/home/cc/fpu_uvm/spike/fp32_corner.cpp
+
 /home/cc/fpu_uvm/UVC_fpu/sv/fpu_pkg.sv
 /home/cc/fpu_uvm/UVC_fpu/tb/fpu_if.sv
 /home/cc/fpu_uvm/rtl/top_core.sv
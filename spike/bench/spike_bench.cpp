@@ -0,0 +1,426 @@
+/*******************************************************************************
+ * Spike DPI Wrapper Microbenchmarks
+ *
+ * Drives the extern "C" API of spike_wrapper.cpp directly, without a
+ * simulator: instance setup, state access, memory access and instruction
+ * execution over representative RV32F streams in every execution mode,
+ * the cost of instructions that trap, and of FP coverage sampling.
+ * Results go to stdout as one JSON object per line:
+ *
+ *   {"bench":"execute_commit/fp_mix/direct","iterations":200000,
+ *    "ns_per_op":48.21,"ops_per_sec":20742584}
+ *
+ * Usage: spike_bench [-s scale] [-f filter] [-i isa]
+ *   -s  Multiply every iteration count (default 1.0)
+ *   -f  Only run benchmarks whose name contains this string
+ *   -i  ISA string (default RV32IF)
+ *
+ * Compile (from spike/, with bench/svdpi.h standing in for the simulator's):
+ *   g++ -O2 -std=c++17 -o spike_bench bench/spike_bench.cpp spike_wrapper.cpp \
+ *       -Ibench -I. -I$RISCV/include -L$RISCV/lib -lriscv -pthread \
+ *       -Wl,-rpath,$RISCV/lib
+ * The direct variants only run in a -DSPIKE_DIRECT_INJECT build (see
+ * spike_wrapper.cpp).
+ ******************************************************************************/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include "svdpi.h"
+
+extern "C" {
+void* spike_init(const char* isa_string);
+int spike_reset(void* handle);
+void spike_close(void* handle);
+int spike_checkpoint(void* handle);
+int spike_restore(void* handle);
+int spike_read_freg(void* handle, int reg_num);
+int spike_write_freg(void* handle, int reg_num, int value);
+int spike_read_xreg(void* handle, int reg_num);
+int spike_write_xreg(void* handle, int reg_num, int value);
+int spike_read_pc(void* handle);
+int spike_write_pc(void* handle, int pc_value);
+int spike_read_csr(void* handle, int csr_addr);
+int spike_write_csr(void* handle, int csr_addr, int value);
+int spike_get_arch_state(void* handle, const svOpenArrayHandle state);
+int spike_execute_instruction(void* handle, int instruction);
+int spike_execute_commit(void* handle, int instruction, svBitVecVal* commit);
+int spike_execute_trap(void* handle, int instruction, svBitVecVal* commit, svBitVecVal* trap);
+int spike_execute_batch(void* handle, const svOpenArrayHandle instructions,
+                        const svOpenArrayHandle results);
+int spike_set_direct_inject(void* handle, int enable);
+int spike_set_async(void* handle, int enable);
+int spike_submit(void* handle, int instruction);
+int spike_poll_result(void* handle, int ticket, svBitVecVal* commit);
+int spike_read_mem(void* handle, int addr);
+int spike_write_mem(void* handle, int addr, int data);
+int spike_read_mem_block(void* handle, int addr, const svOpenArrayHandle data);
+int spike_write_mem_block(void* handle, int addr, const svOpenArrayHandle data);
+int spike_mem_digest(void* handle, int addr, int size, int64_t* digest);
+int spike_set_log_level(int level);
+int spike_coverage_enable(void* handle, int enable);
+}
+
+#define BENCH_CODE_BASE  0x80000000u
+#define BENCH_DATA_BASE  0x80400000u   // x10 points here for FLW/FSW
+#define BENCH_COMMIT_WORDS 8           // spike_commit_t
+#define BENCH_TRAP_WORDS 3             // spike_trap_t
+#define BENCH_ARCH_STATE_WORDS 66      // spike_arch_state_t
+#define BENCH_BATCH 1024               // Instructions per spike_execute_batch()
+#define BENCH_ASYNC_DEPTH 1024         // SPIKE_ASYNC_RING_SIZE
+
+typedef struct {
+    double scale;
+    std::string filter;
+    std::string isa;
+} bench_config_t;
+
+static bench_config_t g_config = {1.0, "", "RV32IF"};
+
+//==============================================================================
+// Timing and Reporting
+//==============================================================================
+
+static bool selected(const std::string& name) {
+    return g_config.filter.empty() || name.find(g_config.filter) != std::string::npos;
+}
+
+static uint64_t scaled(uint64_t iterations) {
+    uint64_t n = (uint64_t)(iterations * g_config.scale);
+    return n > 0 ? n : 1;
+}
+
+static void report(const std::string& name, uint64_t iterations, double seconds) {
+    printf("{\"bench\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.2f,\"ops_per_sec\":%.0f}\n",
+           name.c_str(), (unsigned long long)iterations, seconds * 1e9 / iterations,
+           seconds > 0 ? iterations / seconds : 0.0);
+    fflush(stdout);
+}
+
+/**
+ * Time body(i) for i in [0, iterations) and report it
+ */
+template <typename F>
+static void run(const std::string& name, uint64_t iterations, F body) {
+    if (!selected(name)) return;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; i++) body(i);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    report(name, iterations, seconds);
+}
+
+//==============================================================================
+// Instruction Streams
+//==============================================================================
+
+static uint32_t op_fp(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t rm, uint32_t rd) {
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (rm << 12) | (rd << 7) | 0x53;
+}
+
+static uint32_t op_fused(uint32_t opcode, uint32_t rs3, uint32_t rs2, uint32_t rs1, uint32_t rd) {
+    return (rs3 << 27) | (rs2 << 20) | (rs1 << 15) | (7u << 12) | (rd << 7) | opcode;
+}
+
+static uint32_t op_flw(uint32_t rd, uint32_t offset) {
+    return (offset << 20) | (10u << 15) | (2u << 12) | (rd << 7) | 0x07;
+}
+
+static uint32_t op_fsw(uint32_t rs2, uint32_t offset) {
+    return ((offset >> 5) << 25) | (rs2 << 20) | (10u << 15) | (2u << 12) | ((offset & 0x1F) << 7) | 0x27;
+}
+
+/**
+ * Build an instruction stream
+ * @param kind - "fadd": FADD.S only; "fp_arith": FADD/FSUB/FMUL.S;
+ *               "fp_mix": arithmetic with FDIV, FSQRT, FMADD, FCVT,
+ *               compares and FLW/FSW, roughly as the random tests issue them
+ */
+static std::vector<uint32_t> make_stream(const std::string& kind, size_t length, std::mt19937& rng) {
+    std::uniform_int_distribution<uint32_t> reg(1, 31);
+    std::uniform_int_distribution<uint32_t> pick(0, 99);
+    std::uniform_int_distribution<uint32_t> slot(0, 63);
+    std::vector<uint32_t> stream(length);
+
+    for (size_t i = 0; i < length; i++) {
+        uint32_t rd = reg(rng), rs1 = reg(rng), rs2 = reg(rng), rs3 = reg(rng);
+        uint32_t xrd = (rd == 10) ? 11 : rd;    // Integer results must not move x10
+        uint32_t p = (kind == "fadd") ? 0 : pick(rng);
+
+        if (kind != "fp_mix") {
+            uint32_t funct7 = (p < 34) ? 0x00 : (p < 67) ? 0x04 : 0x08;   // FADD, FSUB, FMUL
+            stream[i] = op_fp(funct7, rs2, rs1, 7, rd);
+        } else if (p < 20) {
+            stream[i] = op_fp(0x00, rs2, rs1, 7, rd);                     // FADD.S
+        } else if (p < 30) {
+            stream[i] = op_fp(0x04, rs2, rs1, 7, rd);                     // FSUB.S
+        } else if (p < 45) {
+            stream[i] = op_fp(0x08, rs2, rs1, 7, rd);                     // FMUL.S
+        } else if (p < 52) {
+            stream[i] = op_fp(0x0C, rs2, rs1, 7, rd);                     // FDIV.S
+        } else if (p < 56) {
+            stream[i] = op_fp(0x2C, 0, rs1, 7, rd);                       // FSQRT.S
+        } else if (p < 70) {
+            static const uint32_t fused[] = {0x43, 0x47, 0x4B, 0x4F};
+            stream[i] = op_fused(fused[p & 3], rs3, rs2, rs1, rd);        // FMADD family
+        } else if (p < 76) {
+            stream[i] = op_fp(0x60, 0, rs1, 1, xrd);                      // FCVT.W.S (rtz)
+        } else if (p < 80) {
+            stream[i] = op_fp(0x50, rs2, rs1, 1, xrd);                    // FLT.S
+        } else if (p < 90) {
+            stream[i] = op_flw(rd, slot(rng) * 4);
+        } else {
+            stream[i] = op_fsw(rs2, slot(rng) * 4);
+        }
+    }
+    return stream;
+}
+
+/**
+ * Put an instance in a known state for running a stream: random finite
+ * FP registers, x10 at the data area, PC at the code base
+ */
+static void prepare(void* h, std::mt19937& rng) {
+    std::uniform_real_distribution<float> value(-1000.0f, 1000.0f);
+
+    spike_reset(h);
+    for (int i = 0; i < 32; i++) {
+        float f = value(rng);
+        int bits;
+        memcpy(&bits, &f, sizeof(bits));
+        spike_write_freg(h, i, bits);
+    }
+    spike_write_xreg(h, 10, (int)BENCH_DATA_BASE);
+    spike_write_pc(h, (int)BENCH_CODE_BASE);
+    spike_write_csr(h, 0x003, 0);
+}
+
+//==============================================================================
+// Benchmarks
+//==============================================================================
+
+static void bench_lifecycle() {
+    run("init_close", scaled(20), [](uint64_t) {
+        void* h = spike_init(g_config.isa.c_str());
+        spike_close(h);
+    });
+
+    void* h = spike_init(g_config.isa.c_str());
+    run("reset", scaled(100000), [h](uint64_t) { spike_reset(h); });
+
+    // Restore cost with a few pages dirtied after the checkpoint
+    spike_checkpoint(h);
+    run("restore/16_pages", scaled(20000), [h](uint64_t i) {
+        for (int p = 0; p < 16; p++) spike_write_mem(h, (int)(BENCH_DATA_BASE + p * 4096), (int)i);
+        spike_restore(h);
+    });
+    spike_close(h);
+}
+
+static void bench_state_access() {
+    void* h = spike_init(g_config.isa.c_str());
+    uint64_t n = scaled(2000000);
+    volatile int sink = 0;
+
+    run("read_freg", n, [&](uint64_t i) { sink += spike_read_freg(h, (int)(i & 31)); });
+    run("write_freg", n, [&](uint64_t i) { spike_write_freg(h, (int)(i & 31), (int)i); });
+    run("read_xreg", n, [&](uint64_t i) { sink += spike_read_xreg(h, (int)(i & 31)); });
+    run("write_xreg", n, [&](uint64_t i) { spike_write_xreg(h, (int)(i & 31), (int)i); });
+    run("read_pc", n, [&](uint64_t) { sink += spike_read_pc(h); });
+    run("write_pc", n, [&](uint64_t i) { spike_write_pc(h, (int)(BENCH_CODE_BASE + (i & 0xFFF) * 4)); });
+    run("read_csr/fcsr", n, [&](uint64_t) { sink += spike_read_csr(h, 0x003); });
+    run("write_csr/fcsr", n, [&](uint64_t i) { spike_write_csr(h, 0x003, (int)(i & 0xFF)); });
+
+    int state[BENCH_ARCH_STATE_WORDS];
+    sv_stub_array_t state_array = {state, BENCH_ARCH_STATE_WORDS, sizeof(int)};
+    run("get_arch_state", scaled(500000), [&](uint64_t) { spike_get_arch_state(h, &state_array); });
+
+    run("read_mem", n, [&](uint64_t i) { sink += spike_read_mem(h, (int)(BENCH_DATA_BASE + (i & 0xFFFF) * 4)); });
+    run("write_mem", n, [&](uint64_t i) { spike_write_mem(h, (int)(BENCH_DATA_BASE + (i & 0xFFFF) * 4), (int)i); });
+
+    // One 4KB block per call; compare against 1024 read_mem/write_mem calls
+    std::vector<int> block(1024);
+    sv_stub_array_t block_array = {block.data(), (int)block.size(), sizeof(int)};
+    run("read_mem_block/4k", scaled(200000), [&](uint64_t i) {
+        spike_read_mem_block(h, (int)(BENCH_DATA_BASE + (i & 0xF) * 4096), &block_array);
+    });
+    run("write_mem_block/4k", scaled(200000), [&](uint64_t i) {
+        spike_write_mem_block(h, (int)(BENCH_DATA_BASE + (i & 0xF) * 4096), &block_array);
+    });
+
+    // Whole default 128MB memory; after the first call only dirtied pages are hashed
+    int64_t digest;
+    spike_mem_digest(h, (int)BENCH_CODE_BASE, 0x08000000, &digest);
+    run("mem_digest/128m_clean", scaled(2000), [&](uint64_t) {
+        spike_mem_digest(h, (int)BENCH_CODE_BASE, 0x08000000, &digest);
+    });
+    run("mem_digest/128m_16_dirty", scaled(2000), [&](uint64_t i) {
+        for (int p = 0; p < 16; p++) spike_write_mem(h, (int)(BENCH_DATA_BASE + p * 65536), (int)i);
+        spike_mem_digest(h, (int)BENCH_CODE_BASE, 0x08000000, &digest);
+    });
+
+    spike_close(h);
+}
+
+static void bench_execute() {
+    static const char* const kinds[] = {"fadd", "fp_arith", "fp_mix"};
+    static const char* const modes[] = {"fetched", "direct"};
+    std::mt19937 rng(1);
+    uint64_t n = scaled(500000);
+    // Fetched execution stores each instruction at the PC; keep the
+    // stream within the code area below the data
+    size_t length = std::min<uint64_t>(n, (BENCH_DATA_BASE - BENCH_CODE_BASE) / 4);
+
+    void* h = spike_init(g_config.isa.c_str());
+    std::vector<uint32_t> commits(BENCH_BATCH * BENCH_COMMIT_WORDS);
+
+    for (const char* kind : kinds) {
+        std::vector<uint32_t> stream = make_stream(kind, length, rng);
+
+        for (int direct = 0; direct < 2; direct++) {
+            std::string suffix = std::string("/") + kind + "/" + modes[direct];
+            if (spike_set_direct_inject(h, direct) != 0) continue;   // Built without SPIKE_DIRECT_INJECT
+
+            prepare(h, rng);
+            run("execute_instruction" + suffix, length, [&](uint64_t i) {
+                spike_execute_instruction(h, (int)stream[i]);
+            });
+
+            prepare(h, rng);
+            run("execute_commit" + suffix, length, [&](uint64_t i) {
+                spike_execute_commit(h, (int)stream[i], commits.data());
+            });
+
+            // Same with FP coverage sampled on every retire
+            prepare(h, rng);
+            spike_coverage_enable(h, 1);
+            run("execute_coverage" + suffix, length, [&](uint64_t i) {
+                spike_execute_commit(h, (int)stream[i], commits.data());
+            });
+            spike_coverage_enable(h, 0);
+
+            // One DPI call per BENCH_BATCH instructions; iterations are
+            // instructions so the figures compare with the single calls
+            prepare(h, rng);
+            std::string name = "execute_batch" + suffix;
+            if (selected(name)) {
+                auto start = std::chrono::steady_clock::now();
+                for (size_t base = 0; base < length; base += BENCH_BATCH) {
+                    int count = (int)std::min<size_t>(BENCH_BATCH, length - base);
+                    sv_stub_array_t insns = {&stream[base], count, sizeof(uint32_t)};
+                    sv_stub_array_t results = {commits.data(), count, BENCH_COMMIT_WORDS * sizeof(uint32_t)};
+                    spike_execute_batch(h, &insns, &results);
+                }
+                report(name, length,
+                       std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+
+            // Worker thread mode: keep the ring full, collect in order
+            name = "submit_poll" + suffix;
+            if (selected(name)) {
+                prepare(h, rng);
+                spike_set_async(h, 1);
+                std::deque<int> tickets;
+                auto start = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < length; i++) {
+                    if (tickets.size() == BENCH_ASYNC_DEPTH) {
+                        while (spike_poll_result(h, tickets.front(), commits.data()) == 0) {}
+                        tickets.pop_front();
+                    }
+                    tickets.push_back(spike_submit(h, (int)stream[i]));
+                }
+                while (!tickets.empty()) {
+                    while (spike_poll_result(h, tickets.front(), commits.data()) == 0) {}
+                    tickets.pop_front();
+                }
+                report(name, length,
+                       std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+                spike_set_async(h, 0);
+            }
+        }
+    }
+
+    spike_close(h);
+}
+
+/**
+ * Faulting instructions against a retiring one of the same kind: the
+ * trapping cases should cost no more than the baseline
+ */
+static void bench_traps() {
+    static const char* const modes[] = {"fetched", "direct"};
+    static const struct {
+        const char* name;
+        uint32_t instruction;
+    } cases[] = {
+        {"flw", op_flw(1, 8)},
+        {"flw_misaligned", op_flw(1, 6)},
+        {"fsw_misaligned", op_fsw(1, 2)},
+        {"illegal", 0x00000000u},
+    };
+    std::mt19937 rng(2);
+    uint64_t n = scaled(500000);
+    uint32_t commit[BENCH_COMMIT_WORDS];
+    uint32_t trap[BENCH_TRAP_WORDS];
+
+    void* h = spike_init(g_config.isa.c_str());
+    for (int direct = 0; direct < 2; direct++) {
+        if (spike_set_direct_inject(h, direct) != 0) continue;   // Built without SPIKE_DIRECT_INJECT
+        prepare(h, rng);
+
+        for (const auto& c : cases) {
+            // A trap leaves the PC at the handler; start every try at code
+            run(std::string("execute_trap/") + c.name + "/" + modes[direct], n, [&](uint64_t i) {
+                spike_write_pc(h, (int)(BENCH_CODE_BASE + (i & 0xFFF) * 4));
+                spike_execute_trap(h, (int)c.instruction, commit, trap);
+            });
+        }
+    }
+    spike_close(h);
+}
+
+//==============================================================================
+// Main
+//==============================================================================
+
+static void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [-s scale] [-f filter] [-i isa]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "s:f:i:h")) != -1) {
+        switch (opt) {
+            case 's':
+                g_config.scale = atof(optarg);
+                break;
+            case 'f':
+                g_config.filter = optarg;
+                break;
+            case 'i':
+                g_config.isa = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    // Keep stdout to results: only warnings and errors from the wrapper
+    spike_set_log_level(2);    // SPIKE_LOG_WARN
+
+    bench_lifecycle();
+    bench_state_access();
+    bench_execute();
+    bench_traps();
+    return 0;
+}
@@ -0,0 +1,48 @@
+/*******************************************************************************
+ * Minimal svdpi.h for building spike_wrapper.cpp outside a simulator
+ *
+ * Provides only the types and open array accessors the wrapper uses. An
+ * open array is passed as a pointer to sv_stub_array_t describing a plain
+ * C array indexed from 0.
+ ******************************************************************************/
+
+#ifndef SVDPI_STUB_H
+#define SVDPI_STUB_H
+
+#include <stdint.h>
+
+typedef uint32_t svBitVecVal;
+typedef uint8_t svBit;
+typedef void* svOpenArrayHandle;
+
+typedef struct {
+    void* data;
+    int size;                   // Elements
+    int elem_size;              // Bytes per element
+} sv_stub_array_t;
+
+static inline int svSize(const svOpenArrayHandle h, int dim) {
+    (void)dim;
+    return ((const sv_stub_array_t*)h)->size;
+}
+
+static inline int svLow(const svOpenArrayHandle h, int dim) {
+    (void)h;
+    (void)dim;
+    return 0;
+}
+
+static inline int svHigh(const svOpenArrayHandle h, int dim) {
+    return svSize(h, dim) - 1;
+}
+
+static inline void* svGetArrayPtr(const svOpenArrayHandle h) {
+    return ((const sv_stub_array_t*)h)->data;
+}
+
+static inline void* svGetArrElemPtr1(const svOpenArrayHandle h, int index) {
+    const sv_stub_array_t* a = (const sv_stub_array_t*)h;
+    return (char*)a->data + (size_t)index * a->elem_size;
+}
+
+#endif // SVDPI_STUB_H
@@ -0,0 +1,425 @@
+/*******************************************************************************
+ * Batch RV32F Golden Evaluator
+ *
+ * Blocks of lanes are computed in two passes:
+ *   1. AVX2/FMA3 single-precision arithmetic with MXCSR set to the requested
+ *      rounding mode; the block's sticky MXCSR flags are read back.
+ *   2. With MXCSR back at round-to-nearest, per-lane inexact is derived from
+ *      exact double-precision residuals (the float product of two operands
+ *      is exact in double, and TwoSum recovers the error of a double add).
+ * Lanes with Inf/NaN operands, and lanes whose result could carry invalid,
+ * divide-by-zero, overflow or underflow when the block raised one of those,
+ * are redone one at a time: NaN lanes in soft-float (RISC-V canonical NaN
+ * rules), the rest on the scalar FPU with their own MXCSR flags. RMM has no
+ * MXCSR encoding and always uses soft-float, as do hosts without
+ * AVX2/FMA3/BMI2 (the vector kernels are selected at run time).
+ *
+ * Compile (standalone DPI library):
+ *   g++ -O2 -shared -fPIC -o libfp32_ref.so fp32_ref.cpp fp32_batch.cpp \
+ *       -I$XCELIUM/tools/include
+ ******************************************************************************/
+
+#include "fp32_batch.h"
+#include "fp32_ref.h"
+
+#include <cstring>
+#include <vector>
+#include <immintrin.h>
+#include "svdpi.h"
+
+//==============================================================================
+// MXCSR Helpers
+//==============================================================================
+
+#define FP32_BATCH_BLOCK 64
+
+#define MXCSR_IE 0x0001
+#define MXCSR_ZE 0x0004
+#define MXCSR_OE 0x0008
+#define MXCSR_UE 0x0010
+#define MXCSR_PE 0x0020
+#define MXCSR_FLAGS 0x003F
+#define MXCSR_MASK_ALL 0x1F80
+#define MXCSR_EXCEPTIONAL (MXCSR_IE | MXCSR_ZE | MXCSR_OE | MXCSR_UE)
+
+// MXCSR.RC for RNE, RTZ, RDN, RUP
+static const uint32_t k_mxcsr_rc[4] = {0x0000, 0x6000, 0x2000, 0x4000};
+
+static inline void write_mxcsr(uint32_t value) {
+    // Memory clobbers keep arithmetic on either side of the mode switch
+    asm volatile("" ::: "memory");
+    _mm_setcsr(value);
+    asm volatile("" ::: "memory");
+}
+
+static inline uint32_t read_mxcsr() {
+    asm volatile("" ::: "memory");
+    return _mm_getcsr();
+}
+
+static inline uint8_t mxcsr_to_fflags(uint32_t mxcsr) {
+    uint8_t flags = 0;
+    if (mxcsr & MXCSR_IE) flags |= FP32_FLAG_NV;
+    if (mxcsr & MXCSR_ZE) flags |= FP32_FLAG_DZ;
+    if (mxcsr & MXCSR_OE) flags |= FP32_FLAG_OF;
+    if (mxcsr & MXCSR_UE) flags |= FP32_FLAG_UF;
+    if (mxcsr & MXCSR_PE) flags |= FP32_FLAG_NX;
+    return flags;
+}
+
+static inline bool is_nan_bits(uint32_t x) {
+    return (x & 0x7F800000u) == 0x7F800000u && (x & 0x007FFFFFu);
+}
+
+//==============================================================================
+// Scalar Paths
+//==============================================================================
+
+static uint32_t soft_eval(int op, int rm, uint32_t a, uint32_t b, uint32_t c, uint32_t* flags) {
+    switch (op) {
+        case FP32_BATCH_ADD:    return fp32_add(a, b, rm, flags);
+        case FP32_BATCH_SUB:    return fp32_sub(a, b, rm, flags);
+        case FP32_BATCH_MUL:    return fp32_mul(a, b, rm, flags);
+        case FP32_BATCH_DIV:    return fp32_div(a, b, rm, flags);
+        case FP32_BATCH_SQRT:   return fp32_sqrt(a, rm, flags);
+        case FP32_BATCH_FMADD:  return fp32_fma(a, b, c, rm, flags);
+        case FP32_BATCH_FMSUB:  return fp32_fma(a, b, c ^ 0x80000000u, rm, flags);
+        case FP32_BATCH_FNMSUB: return fp32_fma(a ^ 0x80000000u, b, c, rm, flags);
+        default:                return fp32_fma(a ^ 0x80000000u, b, c ^ 0x80000000u, rm, flags);
+    }
+}
+
+/**
+ * One lane on the scalar FPU, with its own MXCSR flags
+ */
+__attribute__((target("avx2,fma,bmi2")))
+static uint32_t host_eval_lane(int op, uint32_t csr, uint32_t a, uint32_t b, uint32_t c,
+                               uint8_t* fflags) {
+    __m128 va = _mm_castsi128_ps(_mm_cvtsi32_si128((int)a));
+    __m128 vb = _mm_castsi128_ps(_mm_cvtsi32_si128((int)b));
+    __m128 vc = _mm_castsi128_ps(_mm_cvtsi32_si128((int)c));
+    volatile uint32_t out;
+
+    write_mxcsr(csr);
+    __m128 r;
+    switch (op) {
+        case FP32_BATCH_ADD:    r = _mm_add_ss(va, vb); break;
+        case FP32_BATCH_SUB:    r = _mm_sub_ss(va, vb); break;
+        case FP32_BATCH_MUL:    r = _mm_mul_ss(va, vb); break;
+        case FP32_BATCH_DIV:    r = _mm_div_ss(va, vb); break;
+        case FP32_BATCH_SQRT:   r = _mm_sqrt_ss(va); break;
+        case FP32_BATCH_FMADD:  r = _mm_fmadd_ss(va, vb, vc); break;
+        case FP32_BATCH_FMSUB:  r = _mm_fmsub_ss(va, vb, vc); break;
+        case FP32_BATCH_FNMSUB: r = _mm_fnmadd_ss(va, vb, vc); break;
+        default:                r = _mm_fnmsub_ss(va, vb, vc); break;
+    }
+    out = (uint32_t)_mm_cvtsi128_si32(_mm_castps_si128(r));
+    uint32_t status = read_mxcsr();
+
+    uint32_t bits = out;
+    *fflags = mxcsr_to_fflags(status);
+    // x86 returns its default NaN; RISC-V returns the canonical one
+    return is_nan_bits(bits) ? FP32_CANONICAL_NAN : bits;
+}
+
+//==============================================================================
+// Vector Kernel
+//==============================================================================
+
+/**
+ * Bitmask of lanes whose 32-bit value has an all-ones exponent (Inf/NaN)
+ */
+__attribute__((target("avx2,fma,bmi2")))
+static inline uint32_t inf_nan_mask(__m256i v) {
+    const __m256i exp_mask = _mm256_set1_epi32(0x7F800000);
+    __m256i hit = _mm256_cmpeq_epi32(_mm256_and_si256(v, exp_mask), exp_mask);
+    return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(hit));
+}
+
+/**
+ * Pass 1: results under the requested rounding mode
+ * @param operand_special - Lanes with an Inf/NaN operand
+ * @param result_special  - Lanes whose result could carry NV/DZ/OF/UF: NaN,
+ *                          Inf, largest finite (directed overflow), zero,
+ *                          subnormal, smallest normal (tininess after rounding)
+ * @return Sticky MXCSR flags raised by the block
+ */
+__attribute__((target("avx2,fma,bmi2")))
+static uint32_t block_results(int op, uint32_t csr, const uint32_t* a, const uint32_t* b,
+                              const uint32_t* c, uint32_t* r, uint64_t* operand_special,
+                              uint64_t* result_special) {
+    const __m256i abs_mask = _mm256_set1_epi32(0x7FFFFFFF);
+    const __m256i exp_mask = _mm256_set1_epi32(0x7F800000);
+    const __m256i max_finite = _mm256_set1_epi32(0x7F7FFFFF);
+    const __m256i min_normal = _mm256_set1_epi32(0x00800000);
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t ops_mask = 0, res_mask = 0;
+
+    write_mxcsr(csr);
+    for (int i = 0; i < FP32_BATCH_BLOCK; i += 8) {
+        __m256i ia = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i ib = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i ic = _mm256_loadu_si256((const __m256i*)(c + i));
+        __m256 va = _mm256_castsi256_ps(ia);
+        __m256 vb = _mm256_castsi256_ps(ib);
+        __m256 vc = _mm256_castsi256_ps(ic);
+        __m256 vr;
+        switch (op) {
+            case FP32_BATCH_ADD:    vr = _mm256_add_ps(va, vb); break;
+            case FP32_BATCH_SUB:    vr = _mm256_sub_ps(va, vb); break;
+            case FP32_BATCH_MUL:    vr = _mm256_mul_ps(va, vb); break;
+            case FP32_BATCH_DIV:    vr = _mm256_div_ps(va, vb); break;
+            case FP32_BATCH_SQRT:   vr = _mm256_sqrt_ps(va); break;
+            case FP32_BATCH_FMADD:  vr = _mm256_fmadd_ps(va, vb, vc); break;
+            case FP32_BATCH_FMSUB:  vr = _mm256_fmsub_ps(va, vb, vc); break;
+            case FP32_BATCH_FNMSUB: vr = _mm256_fnmadd_ps(va, vb, vc); break;
+            default:                vr = _mm256_fnmsub_ps(va, vb, vc); break;
+        }
+        _mm256_storeu_ps((float*)(r + i), vr);
+
+        uint32_t ops = inf_nan_mask(ia);
+        if (op != FP32_BATCH_SQRT) ops |= inf_nan_mask(ib);
+        if (op >= FP32_BATCH_FMADD) ops |= inf_nan_mask(ic);
+        ops_mask |= (uint64_t)ops << i;
+
+        __m256i mag = _mm256_and_si256(_mm256_castps_si256(vr), abs_mask);
+        __m256i exp = _mm256_and_si256(mag, exp_mask);
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi32(exp, exp_mask),
+                                      _mm256_cmpeq_epi32(exp, zero));
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi32(mag, max_finite));
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi32(mag, min_normal));
+        res_mask |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(hit)) << i;
+    }
+    uint32_t flags = read_mxcsr() & MXCSR_FLAGS;
+
+    *operand_special = ops_mask;
+    *result_special = res_mask;
+    return flags;
+}
+
+/**
+ * TwoSum: s + err == x + y exactly (round-to-nearest only)
+ */
+__attribute__((target("avx2,fma,bmi2")))
+static inline __m256d two_sum_err(__m256d x, __m256d y, __m256d s) {
+    __m256d yv = _mm256_sub_pd(s, x);
+    __m256d xv = _mm256_sub_pd(s, yv);
+    return _mm256_add_pd(_mm256_sub_pd(x, xv), _mm256_sub_pd(y, yv));
+}
+
+/**
+ * Pass 2: per-lane inexact from exact residuals, MXCSR at round-to-nearest
+ */
+__attribute__((target("avx2,fma,bmi2")))
+static void block_inexact(int op, const uint32_t* a, const uint32_t* b, const uint32_t* c,
+                          const uint32_t* r, uint8_t* fflags) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d neg = _mm256_set1_pd(-0.0);
+    uint64_t nx_mask = 0;
+
+    write_mxcsr(MXCSR_MASK_ALL);
+    for (int i = 0; i < FP32_BATCH_BLOCK; i += 4) {
+        __m256d va = _mm256_cvtps_pd(_mm_loadu_ps((const float*)a + i));
+        __m256d vb = _mm256_cvtps_pd(_mm_loadu_ps((const float*)b + i));
+        __m256d vc = _mm256_cvtps_pd(_mm_loadu_ps((const float*)c + i));
+        __m256d vr = _mm256_cvtps_pd(_mm_loadu_ps((const float*)r + i));
+        __m256d inexact;
+
+        switch (op) {
+            case FP32_BATCH_ADD:
+            case FP32_BATCH_SUB: {
+                if (op == FP32_BATCH_SUB) vb = _mm256_xor_pd(vb, neg);
+                __m256d s = _mm256_add_pd(va, vb);
+                __m256d err = two_sum_err(va, vb, s);
+                inexact = _mm256_or_pd(_mm256_cmp_pd(vr, s, _CMP_NEQ_UQ),
+                                       _mm256_cmp_pd(err, zero, _CMP_NEQ_UQ));
+                break;
+            }
+            case FP32_BATCH_MUL:
+                inexact = _mm256_cmp_pd(vr, _mm256_mul_pd(va, vb), _CMP_NEQ_UQ);
+                break;
+            case FP32_BATCH_DIV:
+                inexact = _mm256_cmp_pd(_mm256_mul_pd(vr, vb), va, _CMP_NEQ_UQ);
+                break;
+            case FP32_BATCH_SQRT:
+                inexact = _mm256_cmp_pd(_mm256_mul_pd(vr, vr), va, _CMP_NEQ_UQ);
+                break;
+            default: {
+                if (op == FP32_BATCH_FNMSUB || op == FP32_BATCH_FNMADD) va = _mm256_xor_pd(va, neg);
+                if (op == FP32_BATCH_FMSUB || op == FP32_BATCH_FNMADD) vc = _mm256_xor_pd(vc, neg);
+                __m256d p = _mm256_mul_pd(va, vb);
+                __m256d s = _mm256_add_pd(p, vc);
+                __m256d err = two_sum_err(p, vc, s);
+                inexact = _mm256_or_pd(_mm256_cmp_pd(vr, s, _CMP_NEQ_UQ),
+                                       _mm256_cmp_pd(err, zero, _CMP_NEQ_UQ));
+                break;
+            }
+        }
+        nx_mask |= (uint64_t)(uint32_t)_mm256_movemask_pd(inexact) << i;
+    }
+
+    // Spread one NX bit per lane into one byte per lane (NX is bit 0)
+    for (int i = 0; i < FP32_BATCH_BLOCK; i += 8) {
+        uint64_t bytes = _pdep_u64((nx_mask >> i) & 0xFF, 0x0101010101010101ull);
+        memcpy(fflags + i, &bytes, sizeof(bytes));
+    }
+}
+
+__attribute__((target("avx2,fma,bmi2")))
+static void eval_vector(int op, int rm, const uint32_t* a, const uint32_t* b, const uint32_t* c,
+                        uint32_t* result, uint8_t* fflags, size_t count) {
+    // Unused operands and the tail of the last block read 1.0f, which
+    // raises nothing in any operation
+    alignas(32) uint32_t ones[FP32_BATCH_BLOCK];
+    alignas(32) uint32_t ta[FP32_BATCH_BLOCK], tb[FP32_BATCH_BLOCK], tc[FP32_BATCH_BLOCK];
+    alignas(32) uint32_t tr[FP32_BATCH_BLOCK];
+    uint8_t tf[FP32_BATCH_BLOCK];
+    uint32_t csr = MXCSR_MASK_ALL | k_mxcsr_rc[rm];
+    uint32_t saved = _mm_getcsr();
+
+    for (size_t i = 0; i < FP32_BATCH_BLOCK; i++) ones[i] = 0x3F800000u;
+
+    for (size_t base = 0; base < count; base += FP32_BATCH_BLOCK) {
+        size_t n = (count - base < FP32_BATCH_BLOCK) ? count - base : FP32_BATCH_BLOCK;
+        const uint32_t *pa, *pb, *pc;
+        uint32_t* pr;
+        uint8_t* pf;
+
+        if (n == FP32_BATCH_BLOCK) {
+            // Full block: work in place
+            pa = a + base;
+            pb = b ? b + base : ones;
+            pc = c ? c + base : ones;
+            pr = result + base;
+            pf = fflags ? fflags + base : tf;
+        } else {
+            for (size_t i = 0; i < FP32_BATCH_BLOCK; i++) {
+                bool live = i < n;
+                ta[i] = live ? a[base + i] : 0x3F800000u;
+                tb[i] = (live && b) ? b[base + i] : 0x3F800000u;
+                tc[i] = (live && c) ? c[base + i] : 0x3F800000u;
+            }
+            pa = ta;
+            pb = tb;
+            pc = tc;
+            pr = tr;
+            pf = tf;
+        }
+
+        uint64_t operand_special, result_special;
+        uint32_t block_flags = block_results(op, csr, pa, pb, pc, pr,
+                                             &operand_special, &result_special);
+        block_inexact(op, pa, pb, pc, pr, pf);
+
+        uint64_t special = operand_special;
+        if (block_flags & MXCSR_EXCEPTIONAL) special |= result_special;
+        if (n < FP32_BATCH_BLOCK) special &= (1ull << n) - 1;
+
+        while (special) {
+            int i = __builtin_ctzll(special);
+            special &= special - 1;
+            if (is_nan_bits(pa[i]) || is_nan_bits(pb[i]) || is_nan_bits(pc[i]) ||
+                (op >= FP32_BATCH_FMADD && is_nan_bits(pr[i]))) {
+                uint32_t flags = 0;
+                pr[i] = soft_eval(op, rm, pa[i], pb[i], pc[i], &flags);
+                pf[i] = (uint8_t)flags;
+            } else {
+                pr[i] = host_eval_lane(op, csr, pa[i], pb[i], pc[i], &pf[i]);
+            }
+        }
+
+        if (n < FP32_BATCH_BLOCK) {
+            memcpy(result + base, tr, n * sizeof(uint32_t));
+            if (fflags) memcpy(fflags + base, tf, n);
+        }
+    }
+
+    write_mxcsr(saved);
+}
+
+static void eval_soft(int op, int rm, const uint32_t* a, const uint32_t* b, const uint32_t* c,
+                      uint32_t* result, uint8_t* fflags, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t flags = 0;
+        result[i] = soft_eval(op, rm, a[i], b ? b[i] : 0, c ? c[i] : 0, &flags);
+        if (fflags) fflags[i] = (uint8_t)flags;
+    }
+}
+
+int fp32_batch_eval(int op, int rm, const uint32_t* a, const uint32_t* b, const uint32_t* c,
+                    uint32_t* result, uint8_t* fflags, size_t count) {
+    static const bool have_avx2_fma = __builtin_cpu_supports("avx2") &&
+                                      __builtin_cpu_supports("fma") &&
+                                      __builtin_cpu_supports("bmi2");
+
+    if (op < FP32_BATCH_ADD || op > FP32_BATCH_FNMADD) return -1;
+    if (rm < FP32_RM_RNE || rm > FP32_RM_RMM) return -1;
+    if ((op != FP32_BATCH_SQRT && b == nullptr) || (op >= FP32_BATCH_FMADD && c == nullptr)) {
+        return -1;
+    }
+
+    if (rm == FP32_RM_RMM || !have_avx2_fma) {
+        eval_soft(op, rm, a, b, c, result, fflags, count);
+    } else {
+        eval_vector(op, rm, a, b, c, result, fflags, count);
+    }
+    return 0;
+}
+
+//==============================================================================
+// DPI Interface
+//==============================================================================
+
+// Contiguous view of an open array, copied when the simulator's layout is not
+static const uint32_t* array_words(const svOpenArrayHandle h, int count,
+                                   std::vector<uint32_t>& copy) {
+    const uint32_t* ptr = (const uint32_t*)svGetArrayPtr(h);
+    if (ptr != nullptr) return ptr;
+    int lo = svLow(h, 1);
+    copy.resize(count);
+    for (int i = 0; i < count; i++) copy[i] = *(const uint32_t*)svGetArrElemPtr1(h, lo + i);
+    return copy.data();
+}
+
+extern "C" {
+
+/**
+ * Evaluate a batch of one operation
+ * @param op - FP32_BATCH_* operation
+ * @param rm - Static rounding mode
+ * @param a, b, c - Operand open arrays (b and c may be empty when unused)
+ * @param result - Open array receiving result bits, sized like a
+ * @param fflags - Open byte array receiving fflags, sized like a
+ * @return Number of lanes evaluated, -1 on error
+ */
+int fp32_ref_batch(int op, int rm, const svOpenArrayHandle a, const svOpenArrayHandle b,
+                   const svOpenArrayHandle c, const svOpenArrayHandle result,
+                   const svOpenArrayHandle fflags) {
+    int count = svSize(a, 1);
+    if (svSize(result, 1) < count || svSize(fflags, 1) < count) return -1;
+    if (op != FP32_BATCH_SQRT && svSize(b, 1) < count) return -1;
+    if (op >= FP32_BATCH_FMADD && svSize(c, 1) < count) return -1;
+
+    std::vector<uint32_t> ca, cb, cc;
+    const uint32_t* pa = array_words(a, count, ca);
+    const uint32_t* pb = (svSize(b, 1) >= count) ? array_words(b, count, cb) : nullptr;
+    const uint32_t* pc = (svSize(c, 1) >= count) ? array_words(c, count, cc) : nullptr;
+
+    std::vector<uint32_t> res(count);
+    std::vector<uint8_t> flags(count);
+    if (fp32_batch_eval(op, rm, pa, pb, pc, res.data(), flags.data(), count) != 0) return -1;
+
+    int lo_r = svLow(result, 1);
+    int lo_f = svLow(fflags, 1);
+    uint32_t* dst = (uint32_t*)svGetArrayPtr(result);
+    if (dst != nullptr) {
+        memcpy(dst, res.data(), count * sizeof(uint32_t));
+    } else {
+        for (int i = 0; i < count; i++) *(uint32_t*)svGetArrElemPtr1(result, lo_r + i) = res[i];
+    }
+    for (int i = 0; i < count; i++) *(uint8_t*)svGetArrElemPtr1(fflags, lo_f + i) = flags[i];
+
+    return count;
+}
+
+} // extern "C"
@@ -0,0 +1,39 @@
+/*******************************************************************************
+ * Batch RV32F Golden Evaluator
+ *
+ * Evaluates arrays of operand triples for one arithmetic operation and
+ * rounding mode on the host FPU (AVX2/FMA3 under the matching MXCSR
+ * rounding mode), producing the same result bits and fflags as the
+ * soft-float engine in fp32_ref.h.
+ ******************************************************************************/
+
+#ifndef FP32_BATCH_H
+#define FP32_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Operations accepted by fp32_batch_eval
+#define FP32_BATCH_ADD    0
+#define FP32_BATCH_SUB    1
+#define FP32_BATCH_MUL    2
+#define FP32_BATCH_DIV    3
+#define FP32_BATCH_SQRT   4
+#define FP32_BATCH_FMADD  5   //  a*b + c
+#define FP32_BATCH_FMSUB  6   //  a*b - c
+#define FP32_BATCH_FNMSUB 7   // -a*b + c
+#define FP32_BATCH_FNMADD 8   // -a*b - c
+
+/**
+ * Evaluate count lanes of one operation
+ * @param op     - FP32_BATCH_* operation
+ * @param rm     - Static rounding mode (FP32_RM_RNE..FP32_RM_RMM)
+ * @param a, b, c - Operand arrays; b and c may be null when unused
+ * @param result - Result bits, count entries
+ * @param fflags - fflags per lane, count entries (may be null)
+ * @return 0 on success, -1 for an unknown op or rounding mode
+ */
+int fp32_batch_eval(int op, int rm, const uint32_t* a, const uint32_t* b, const uint32_t* c,
+                    uint32_t* result, uint8_t* fflags, size_t count);
+
+#endif // FP32_BATCH_H
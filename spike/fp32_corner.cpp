@@ -0,0 +1,533 @@
+/*******************************************************************************
+ * RV32F Corner-Case Operand Generator
+ *
+ * Operands are built from the target result, not filtered from random
+ * ones, so every entry of a class lands in its corner:
+ *   - Ties: an addend of exactly half an ulp of the other operand, a
+ *     multiplier 1 + 2^-t against a significand whose low t bits are
+ *     100..0, and for FMA an addend that completes the exact product to a
+ *     halfway value. A quotient or square root is never exactly halfway;
+ *     division uses divisors 1 + 2^-23 and 1 - 2^-24, whose quotients sit
+ *     within 2^-12 ulp of one, and square root keeps the candidate nearest
+ *     halfway out of several random ones.
+ *   - Overflow and underflow: operand exponents chosen so the exact
+ *     result's exponent is at the edge of the finite or normal range.
+ *   - Cancellation: a second operand (or an FMA addend against the
+ *     rounded product) equal to the first in all but a few low bits, with
+ *     the sign that makes the operation subtract. Division and
+ *     multiplication get quotients and products next to 1.0 instead.
+ * Subnormal and special operands are drawn directly.
+ *
+ * Compile (standalone DPI library, or alongside fp32_batch.cpp):
+ *   g++ -O2 -shared -fPIC -o libfp32_corner.so fp32_corner.cpp \
+ *       -I$XCELIUM/tools/include
+ ******************************************************************************/
+
+#include "fp32_corner.h"
+#include "fp32_batch.h"
+
+#include <cmath>
+#include <cstring>
+#include <new>
+#include "svdpi.h"
+
+//==============================================================================
+// Random Numbers
+//==============================================================================
+
+// Entries per corner class when no weight has been set
+static const int k_default_weights[FP32_CORNER_CLASSES] = {
+    2,  // RANDOM
+    2,  // SUBNORMAL
+    3,  // TIE
+    1,  // OVERFLOW
+    2,  // UNDERFLOW
+    2,  // CANCEL
+    2,  // SPECIAL
+};
+
+// Square root tie candidates tried per entry
+#define FP32_CORNER_SQRT_TRIES 16
+
+struct fp32_corner {
+    uint64_t state;                         // splitmix64
+    int weights[FP32_CORNER_CLASSES];
+};
+
+static inline uint64_t next_u64(fp32_corner_t* gen) {
+    uint64_t z = (gen->state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [lo, hi]
+static inline int next_range(fp32_corner_t* gen, int lo, int hi) {
+    return lo + (int)(next_u64(gen) % (uint64_t)(hi - lo + 1));
+}
+
+static inline uint32_t next_sign(fp32_corner_t* gen) {
+    return (uint32_t)(next_u64(gen) >> 63) << 31;
+}
+
+static inline uint32_t next_frac(fp32_corner_t* gen) {
+    return (uint32_t)next_u64(gen) & 0x7FFFFF;
+}
+
+//==============================================================================
+// Value Helpers
+//==============================================================================
+
+#define SIGN_BIT 0x80000000u
+#define EXP_MAX  254
+
+static inline uint32_t make_fp(uint32_t sign, int exp, uint32_t frac) {
+    return sign | ((uint32_t)exp << 23) | (frac & 0x7FFFFF);
+}
+
+static inline int exp_of(uint32_t x) {
+    return (int)((x >> 23) & 0xFF);
+}
+
+static inline float bits_to_float(uint32_t x) {
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static inline uint32_t float_to_bits(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    return x;
+}
+
+// Nonzero subnormal magnitude from any of the 23 subnormal binades
+static inline uint32_t next_subnormal(fp32_corner_t* gen) {
+    return (next_frac(gen) | 0x400000) >> next_range(gen, 0, 22);
+}
+
+static inline bool is_fma(int op) {
+    return op >= FP32_BATCH_FMADD;
+}
+
+// Sign applied to the product and to the addend by each FMA variant
+static inline double fma_product_sign(int op) {
+    return (op == FP32_BATCH_FNMSUB || op == FP32_BATCH_FNMADD) ? -1.0 : 1.0;
+}
+
+static inline double fma_addend_sign(int op) {
+    return (op == FP32_BATCH_FMSUB || op == FP32_BATCH_FNMADD) ? -1.0 : 1.0;
+}
+
+// Sign bit of b that makes a (op) b subtract magnitudes; ADD/SUB only
+static inline uint32_t cancel_sign(int op, uint32_t a) {
+    return (op == FP32_BATCH_SUB) ? (a & SIGN_BIT) : ((a & SIGN_BIT) ^ SIGN_BIT);
+}
+
+/**
+ * Exponents of two factors whose exact product has biased exponent
+ * near target (target may lie outside 1..254)
+ */
+static void product_exponents(fp32_corner_t* gen, int target, int* ea, int* eb) {
+    int lo = target - 126 > 1 ? target - 126 : 1;
+    int hi = target + 126 < EXP_MAX ? target + 126 : EXP_MAX;
+    *ea = next_range(gen, lo, hi);
+    *eb = target - *ea + 127;
+}
+
+/**
+ * Exponents of a dividend and divisor whose exact quotient has biased
+ * exponent near target
+ */
+static void quotient_exponents(fp32_corner_t* gen, int target, int* ea, int* eb) {
+    int lo = target - 126 > 1 ? target - 126 : 1;
+    int hi = target + 127 < EXP_MAX ? target + 127 : EXP_MAX;
+    *ea = next_range(gen, lo, hi);
+    *eb = *ea + 127 - target;
+}
+
+/**
+ * FMA addend that completes the exact product p to a value halfway
+ * between two floats
+ * @return false when the addend is not exactly representable
+ */
+static bool fma_tie_addend(int op, uint32_t a, uint32_t b, uint32_t* c) {
+    double product = fma_product_sign(op) * (double)bits_to_float(a) * (double)bits_to_float(b);
+    if (product == 0.0 || !std::isfinite(product)) return false;
+
+    // Truncate the exact (48-bit) product to 24 significant bits
+    int exp;
+    std::frexp(product, &exp);
+    double ulp = std::ldexp(1.0, exp - 24);
+    double truncated = std::trunc(product / ulp) * ulp;
+    double target = truncated + std::copysign(ulp / 2, product);
+
+    double addend = fma_addend_sign(op) * (target - product);
+    float narrowed = (float)addend;
+    if ((double)narrowed != addend || !std::isfinite(narrowed)) return false;
+    if (std::fabs(target) >= 3.4028234663852886e38 || std::fabs(target) < 1.1754943508222875e-38) return false;
+    *c = float_to_bits(narrowed);
+    return true;
+}
+
+//==============================================================================
+// Corner Classes
+//==============================================================================
+
+static void gen_random(fp32_corner_t* gen, int op, uint32_t v[3]) {
+    for (int i = 0; i < 3; i++) {
+        v[i] = make_fp(next_sign(gen), next_range(gen, 64, 190), next_frac(gen));
+    }
+    if (op == FP32_BATCH_SQRT) v[0] &= ~SIGN_BIT;
+}
+
+static void gen_subnormal(fp32_corner_t* gen, int op, uint32_t v[3]) {
+    v[0] = next_sign(gen) | next_subnormal(gen);
+
+    // The other operands: subnormal half the time, otherwise normal with
+    // an exponent that keeps the result near the subnormal range
+    for (int i = 1; i < 3; i++) {
+        if (next_u64(gen) & 1) {
+            v[i] = next_sign(gen) | next_subnormal(gen);
+        } else if (op == FP32_BATCH_MUL || op == FP32_BATCH_DIV || (is_fma(op) && i == 1)) {
+            v[i] = make_fp(next_sign(gen), next_range(gen, 100, 160), next_frac(gen));
+        } else {
+            v[i] = make_fp(next_sign(gen), next_range(gen, 1, 4), next_frac(gen));
+        }
+    }
+    if (op == FP32_BATCH_SQRT && (next_u64(gen) & 3) != 0) v[0] &= ~SIGN_BIT;
+}
+
+static void gen_tie(fp32_corner_t* gen, int op, uint32_t v[3]) {
+    v[2] = 0;
+    switch (op) {
+        case FP32_BATCH_ADD:
+        case FP32_BATCH_SUB: {
+            // b's lowest set bit at half an ulp of a, k binades below a
+            int ea = next_range(gen, 25, 253);
+            int k = next_range(gen, 1, 24);
+            v[0] = make_fp(next_sign(gen), ea, next_frac(gen) | 1);
+            uint32_t frac = (k == 24) ? 0 : ((next_frac(gen) & ~((1u << k) - 1)) | (1u << (k - 1)));
+            v[1] = make_fp(next_sign(gen), ea - k, frac);
+            break;
+        }
+        case FP32_BATCH_MUL:
+        case FP32_BATCH_FMADD:
+        case FP32_BATCH_FMSUB:
+        case FP32_BATCH_FNMSUB:
+        case FP32_BATCH_FNMADD: {
+            // M * (1 + 2^-t) drops t bits of M, 100..0, when it stays below 2^(24 + t)
+            int t = next_range(gen, 1, 23);
+            uint32_t low = (1u << t) - 1;
+            uint32_t bound = (uint32_t)((((uint64_t)1 << (24 + t)) - 1) / ((1u << t) + 1));
+            uint32_t m = (1u << 23) + (uint32_t)(next_u64(gen) % (bound - (1u << 23) + 1));
+            m = (m & ~low) | (1u << (t - 1));
+            if (m > bound) m -= 1u << t;
+
+            int ea, eb;
+            product_exponents(gen, next_range(gen, 40, 210), &ea, &eb);
+            v[0] = make_fp(next_sign(gen), ea, m);
+            v[1] = make_fp(next_sign(gen), eb, 1u << (23 - t));
+            if (next_u64(gen) & 1) {
+                uint32_t swap = v[0];
+                v[0] = v[1];
+                v[1] = swap;
+            }
+
+            // FMA: half the time a random product completed to a tie by c
+            if (is_fma(op)) {
+                v[2] = next_sign(gen);
+                if (next_u64(gen) & 1) {
+                    product_exponents(gen, next_range(gen, 40, 210), &ea, &eb);
+                    uint32_t a = make_fp(next_sign(gen), ea, next_frac(gen));
+                    uint32_t b = make_fp(next_sign(gen), eb, next_frac(gen));
+                    uint32_t c;
+                    if (fma_tie_addend(op, a, b, &c)) {
+                        v[0] = a;
+                        v[1] = b;
+                        v[2] = c;
+                    }
+                }
+            }
+            break;
+        }
+        case FP32_BATCH_DIV: {
+            // a / (1 + 2^-23) with a's significand 1.5 + j ulp, or
+            // a / (1 - 2^-24) with a's significand 1.0 + j ulp
+            int ea, eb;
+            quotient_exponents(gen, next_range(gen, 40, 210), &ea, &eb);
+            int j = next_range(gen, 0, 1023);
+            if (next_u64(gen) & 1) {
+                v[0] = make_fp(next_sign(gen), ea, (1u << 22) + j - 512);
+                v[1] = make_fp(next_sign(gen), eb, 1);
+            } else {
+                if (eb < 2) eb = 2;
+                v[0] = make_fp(next_sign(gen), ea, j);
+                v[1] = make_fp(next_sign(gen), eb - 1, 0x7FFFFF);
+            }
+            break;
+        }
+        default: {
+            // Square root: keep the candidate nearest halfway between floats
+            double best = 1.0;
+            for (int i = 0; i < FP32_CORNER_SQRT_TRIES; i++) {
+                uint32_t a = make_fp(0, next_range(gen, 1, EXP_MAX), next_frac(gen));
+                double root = std::sqrt((double)bits_to_float(a));
+                int exp;
+                std::frexp(root, &exp);
+                double units = std::ldexp(root, 24 - exp);
+                double distance = std::fabs(units - std::floor(units) - 0.5);
+                if (distance < best) {
+                    best = distance;
+                    v[0] = a;
+                }
+            }
+            v[1] = 0;
+            break;
+        }
+    }
+}
+
+static void gen_overflow(fp32_corner_t* gen, int op, uint32_t v[3]) {
+    int ea, eb;
+    int target = next_range(gen, 253, 255);
+    v[2] = 0;
+
+    switch (op) {
+        case FP32_BATCH_ADD:
+        case FP32_BATCH_SUB:
+            v[0] = make_fp(next_sign(gen), next_range(gen, 252, EXP_MAX), next_frac(gen) | 0x700000);
+            v[1] = make_fp(cancel_sign(op, v[0]) ^ SIGN_BIT, next_range(gen, 230, EXP_MAX), next_frac(gen));
+            break;
+        case FP32_BATCH_DIV:
+            quotient_exponents(gen, target, &ea, &eb);
+            v[0] = make_fp(next_sign(gen), ea, next_frac(gen));
+            v[1] = make_fp(next_sign(gen), eb, next_frac(gen));
+            break;
+        case FP32_BATCH_SQRT:
+            v[0] = make_fp(0, next_range(gen, 252, EXP_MAX), next_frac(gen));
+            v[1] = 0;
+            break;
+        default:
+            product_exponents(gen, target, &ea, &eb);
+            v[0] = make_fp(next_sign(gen), ea, next_frac(gen));
+            v[1] = make_fp(next_sign(gen), eb, next_frac(gen));
+            if (is_fma(op)) v[2] = make_fp(next_sign(gen), next_range(gen, 240, EXP_MAX), next_frac(gen));
+            break;
+    }
+}
+
+static void gen_underflow(fp32_corner_t* gen, int op, uint32_t v[3]) {
+    int ea, eb;
+    // Mostly straddling the normal/subnormal boundary, sometimes deep in it
+    int target = (next_u64(gen) & 3) ? next_range(gen, -2, 2) : next_range(gen, -24, -3);
+    v[2] = 0;
+
+    switch (op) {
+        case FP32_BATCH_ADD:
+        case FP32_BATCH_SUB:
+            // Nearly cancelling small normals leave a subnormal difference
+            v[0] = make_fp(next_sign(gen), next_range(gen, 1, 3), next_frac(gen));
+            v[1] = make_fp(cancel_sign(op, v[0]), exp_of(v[0]),
+                           v[0] ^ ((uint32_t)next_u64(gen) & ((1u << next_range(gen, 1, 23)) - 1)));
+            break;
+        case FP32_BATCH_DIV:
+            quotient_exponents(gen, target, &ea, &eb);
+            v[0] = make_fp(next_sign(gen), ea, next_frac(gen));
+            v[1] = make_fp(next_sign(gen), eb, next_frac(gen));
+            break;
+        case FP32_BATCH_SQRT:
+            v[0] = (next_u64(gen) & 1) ? make_fp(0, next_range(gen, 1, 3), next_frac(gen))
+                                       : next_subnormal(gen);
+            v[1] = 0;
+            break;
+        default:
+            product_exponents(gen, target, &ea, &eb);
+            v[0] = make_fp(next_sign(gen), ea, next_frac(gen));
+            v[1] = make_fp(next_sign(gen), eb, next_frac(gen));
+            if (is_fma(op)) v[2] = next_sign(gen) | next_subnormal(gen);
+            break;
+    }
+}
+
+static void gen_cancel(fp32_corner_t* gen, int op, uint32_t v[3]) {
+    // Low bits that differ between the nearly equal values
+    uint32_t flip = (uint32_t)next_u64(gen) & ((1u << next_range(gen, 1, 23)) - 1);
+    v[2] = 0;
+
+    switch (op) {
+        case FP32_BATCH_ADD:
+        case FP32_BATCH_SUB: {
+            v[0] = make_fp(next_sign(gen), next_range(gen, 2, EXP_MAX), next_frac(gen));
+            int eb = exp_of(v[0]) - ((next_u64(gen) & 3) == 0);
+            v[1] = make_fp(cancel_sign(op, v[0]), eb, v[0] ^ flip);
+            break;
+        }
+        case FP32_BATCH_MUL: {
+            // b near 1/a: the product's significand crosses 2.0 or 1.0
+            v[0] = make_fp(next_sign(gen), next_range(gen, 64, 190), next_frac(gen));
+            uint32_t inverse = float_to_bits(1.0f / bits_to_float(v[0] & ~SIGN_BIT));
+            v[1] = next_sign(gen) | (inverse ^ flip);
+            break;
+        }
+        case FP32_BATCH_DIV:
+            v[0] = make_fp(next_sign(gen), next_range(gen, 1, EXP_MAX), next_frac(gen));
+            v[1] = next_sign(gen) | ((v[0] & ~SIGN_BIT) ^ flip);
+            break;
+        case FP32_BATCH_SQRT:
+            // Just either side of a power of four
+            v[0] = make_fp(0, 127 + 2 * next_range(gen, -60, 60), flip);
+            if (next_u64(gen) & 1) v[0] = make_fp(0, exp_of(v[0]) - 1, 0x7FFFFF ^ flip);
+            v[1] = 0;
+            break;
+        default: {
+            // c within a few ulps of -(a * b) after the FMA's sign changes
+            int ea, eb;
+            product_exponents(gen, next_range(gen, 40, 210), &ea, &eb);
+            v[0] = make_fp(next_sign(gen), ea, next_frac(gen));
+            v[1] = make_fp(next_sign(gen), eb, next_frac(gen));
+            float product = (float)(fma_product_sign(op) * bits_to_float(v[0]) * bits_to_float(v[1]));
+            float addend = (float)(-fma_addend_sign(op) * product);
+            v[2] = float_to_bits(addend) ^ flip;
+            break;
+        }
+    }
+}
+
+static uint32_t special_value(fp32_corner_t* gen) {
+    uint32_t sign = next_sign(gen);
+    switch (next_range(gen, 0, 9)) {
+        case 0:  return sign;                                           // +-0
+        case 1:  return sign | 0x7F800000u;                             // +-Inf
+        case 2:  return sign | 0x7FC00000u | (next_frac(gen) >> 1);     // qNaN
+        case 3:                                                         // sNaN
+        case 4:  return sign | 0x7F800000u | ((next_frac(gen) >> 1) | 1);
+        case 5:  return sign | 0x7F7FFFFFu;                             // Largest finite
+        case 6:  return sign | 0x00800000u;                             // Smallest normal
+        case 7:  return sign | 0x007FFFFFu;                             // Largest subnormal
+        case 8:  return sign | 1;                                       // Smallest subnormal
+        default: return make_fp(sign, 127, 0);                          // +-1.0
+    }
+}
+
+static void gen_special(fp32_corner_t* gen, int op, uint32_t v[3]) {
+    (void)op;
+    for (int i = 0; i < 3; i++) v[i] = special_value(gen);
+}
+
+typedef void (*corner_fn_t)(fp32_corner_t* gen, int op, uint32_t v[3]);
+
+static const corner_fn_t k_corner_fns[FP32_CORNER_CLASSES] = {
+    gen_random, gen_subnormal, gen_tie, gen_overflow, gen_underflow, gen_cancel, gen_special
+};
+
+//==============================================================================
+// API
+//==============================================================================
+
+fp32_corner_t* fp32_corner_create(uint64_t seed) {
+    fp32_corner_t* gen = new (std::nothrow) fp32_corner_t;
+    if (gen == nullptr) return nullptr;
+    gen->state = seed;
+    memcpy(gen->weights, k_default_weights, sizeof(gen->weights));
+    return gen;
+}
+
+void fp32_corner_destroy(fp32_corner_t* gen) {
+    delete gen;
+}
+
+int fp32_corner_set_weight(fp32_corner_t* gen, int corner, int weight) {
+    if (corner < 0 || corner >= FP32_CORNER_CLASSES || weight < 0) return -1;
+    gen->weights[corner] = weight;
+    return 0;
+}
+
+int fp32_corner_generate(fp32_corner_t* gen, int op, int rm_mask, uint32_t* entries, size_t count) {
+    if (op < FP32_BATCH_ADD || op > FP32_BATCH_FNMADD) return -1;
+    if (rm_mask == 0) rm_mask = 0x1F;
+    rm_mask &= 0x1F;
+    if (rm_mask == 0) return -1;
+
+    int total = 0;
+    for (int i = 0; i < FP32_CORNER_CLASSES; i++) total += gen->weights[i];
+    if (total == 0) return -1;
+
+    int modes[5];
+    int mode_count = 0;
+    for (int rm = 0; rm < 5; rm++) {
+        if ((rm_mask >> rm) & 1) modes[mode_count++] = rm;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        int pick = next_range(gen, 0, total - 1);
+        int corner = 0;
+        while (pick >= gen->weights[corner]) pick -= gen->weights[corner++];
+
+        uint32_t* entry = &entries[i * FP32_CORNER_WORDS];
+        k_corner_fns[corner](gen, op, entry);
+        if (op == FP32_BATCH_SQRT) entry[1] = 0;
+        if (!is_fma(op)) entry[2] = 0;
+        entry[3] = (uint32_t)modes[next_range(gen, 0, mode_count - 1)] | ((uint32_t)corner << 8);
+    }
+    return 0;
+}
+
+//==============================================================================
+// DPI Interface
+//==============================================================================
+
+extern "C" {
+
+/**
+ * Create a generator for a sequence
+ * @param seed - Same seed, same entries
+ * @return Handle for fp32_corner_fill(), null when out of memory
+ */
+void* fp32_corner_open(int64_t seed) {
+    return fp32_corner_create((uint64_t)seed);
+}
+
+void fp32_corner_close(void* handle) {
+    fp32_corner_destroy((fp32_corner_t*)handle);
+}
+
+/**
+ * Set the relative weight of one FP32_CORNER_* class
+ * @return 0 on success, -1 for a bad handle, class or weight
+ */
+int fp32_corner_weight(void* handle, int corner, int weight) {
+    if (handle == nullptr) return -1;
+    return fp32_corner_set_weight((fp32_corner_t*)handle, corner, weight);
+}
+
+/**
+ * Fill an open array with entries for one operation
+ * @param op      - FP32_BATCH_* operation
+ * @param rm_mask - Rounding modes to draw from (bit n for mode n, 0 for all)
+ * @param entries - FP32_CORNER_WORDS ints per entry: a, b, c, control
+ * @return Number of entries written, -1 on error
+ */
+int fp32_corner_fill(void* handle, int op, int rm_mask, const svOpenArrayHandle entries) {
+    if (handle == nullptr) return -1;
+    int count = svSize(entries, 1) / FP32_CORNER_WORDS;
+
+    uint32_t* dst = (uint32_t*)svGetArrayPtr(entries);
+    if (dst != nullptr) {
+        if (fp32_corner_generate((fp32_corner_t*)handle, op, rm_mask, dst, count) != 0) return -1;
+        return count;
+    }
+
+    uint32_t words[64 * FP32_CORNER_WORDS];
+    int lo = svLow(entries, 1);
+    for (int base = 0; base < count; base += 64) {
+        int n = (count - base < 64) ? count - base : 64;
+        if (fp32_corner_generate((fp32_corner_t*)handle, op, rm_mask, words, n) != 0) return -1;
+        for (int i = 0; i < n * FP32_CORNER_WORDS; i++) {
+            *(uint32_t*)svGetArrElemPtr1(entries, lo + base * FP32_CORNER_WORDS + i) = words[i];
+        }
+    }
+    return count;
+}
+
+} // extern "C"
@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * RV32F Corner-Case Operand Generator
+ *
+ * Seeded generator of operand triples and rounding modes aimed at the
+ * IEEE-754 cases constrained-random SV stimulus rarely reaches: subnormal
+ * operands and results, rounding ties, near-overflow results, catastrophic
+ * cancellation and NaN/Inf/zero operands (signalling NaNs included). Each
+ * entry is drawn from one corner class, picked by a configurable weight.
+ * The same seed, weights and calls produce the same entries.
+ ******************************************************************************/
+
+#ifndef FP32_CORNER_H
+#define FP32_CORNER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Corner classes, selected per entry in proportion to their weights
+#define FP32_CORNER_RANDOM     0   // Random normal operands
+#define FP32_CORNER_SUBNORMAL  1   // Subnormal operands
+#define FP32_CORNER_TIE        2   // Exact result exactly halfway between two floats
+#define FP32_CORNER_OVERFLOW   3   // Result at the top of the finite range
+#define FP32_CORNER_UNDERFLOW  4   // Result at the normal/subnormal boundary
+#define FP32_CORNER_CANCEL     5   // Nearly equal magnitudes subtracted
+#define FP32_CORNER_SPECIAL    6   // Zeros, infinities, quiet and signalling NaNs
+#define FP32_CORNER_CLASSES    7
+
+// Words per entry in fp32_corner_fill(): a, b, c and a control word with
+// the rounding mode in bits [2:0] and the corner class in bits [15:8]
+#define FP32_CORNER_WORDS 4
+
+typedef struct fp32_corner fp32_corner_t;
+
+/**
+ * Create a generator
+ * @param seed - Same seed, same entries
+ * @return Generator with the default weights, or null when out of memory
+ */
+fp32_corner_t* fp32_corner_create(uint64_t seed);
+
+void fp32_corner_destroy(fp32_corner_t* gen);
+
+/**
+ * Set how often one corner class is drawn, relative to the others
+ * @param corner - FP32_CORNER_* class
+ * @param weight - 0 disables the class
+ * @return 0 on success, -1 for an unknown class or a negative weight
+ */
+int fp32_corner_set_weight(fp32_corner_t* gen, int corner, int weight);
+
+/**
+ * Generate count entries for one operation
+ * @param op      - FP32_BATCH_* operation (fp32_batch.h) the operands target
+ * @param rm_mask - Rounding modes to draw from, bit n for mode n (RNE..RMM);
+ *                  0 draws from all five
+ * @param entries - FP32_CORNER_WORDS words per entry
+ * @return 0 on success, -1 for an unknown op, an empty mode mask or all
+ *         weights zero
+ */
+int fp32_corner_generate(fp32_corner_t* gen, int op, int rm_mask, uint32_t* entries, size_t count);
+
+#endif // FP32_CORNER_H
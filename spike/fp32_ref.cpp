@@ -0,0 +1,771 @@
+/*******************************************************************************
+ * Native RV32F Reference Engine
+ *
+ * Integer-only soft-float for binary32, bit-compatible with Spike's
+ * Berkeley SoftFloat configuration for RISC-V. It is a drop-in golden model
+ * for operations that do not need architectural state, so the testbench can
+ * check results without constructing a sim_t.
+ *
+ * Compile (standalone DPI library):
+ *   g++ -O2 -shared -fPIC -o libfp32_ref.so fp32_ref.cpp
+ ******************************************************************************/
+
+#include "fp32_ref.h"
+
+//==============================================================================
+// Encoding Helpers
+//==============================================================================
+
+#define OPCODE_FMADD  0x43
+#define OPCODE_FMSUB  0x47
+#define OPCODE_FNMSUB 0x4B
+#define OPCODE_FNMADD 0x4F
+#define OPCODE_OP_FP  0x53
+
+static inline bool sign_of(uint32_t a) { return a >> 31; }
+static inline int exp_of(uint32_t a) { return (a >> 23) & 0xFF; }
+static inline uint32_t frac_of(uint32_t a) { return a & 0x007FFFFF; }
+
+static inline uint32_t pack(bool sign, int exp, uint32_t sig) {
+    // Addition (not OR) so a carry out of the significand bumps the exponent
+    return ((uint32_t)sign << 31) + ((uint32_t)exp << 23) + sig;
+}
+
+static inline bool is_nan(uint32_t a) {
+    return exp_of(a) == 0xFF && frac_of(a);
+}
+
+static inline bool is_snan(uint32_t a) {
+    return is_nan(a) && !(a & 0x00400000);
+}
+
+static inline int clz32(uint32_t a) {
+    return a ? __builtin_clz(a) : 32;
+}
+
+static inline uint32_t shift_right_jam32(uint32_t a, int dist) {
+    return (dist < 31) ? (a >> dist) | ((uint32_t)(a << (-dist & 31)) != 0)
+                       : (a != 0);
+}
+
+static inline uint64_t shift_right_jam64(uint64_t a, int dist) {
+    return (dist < 63) ? (a >> dist) | ((uint64_t)(a << (-dist & 63)) != 0)
+                       : (a != 0);
+}
+
+/**
+ * RISC-V NaN propagation: any NaN result is the canonical NaN, and
+ * signaling NaN operands raise invalid
+ */
+static uint32_t propagate_nan(uint32_t a, uint32_t b, uint32_t* flags) {
+    if (is_snan(a) || is_snan(b)) *flags |= FP32_FLAG_NV;
+    return FP32_CANONICAL_NAN;
+}
+
+static void normalize_subnormal(uint32_t frac, int* exp, uint32_t* sig) {
+    int shift = clz32(frac) - 8;
+    *exp = 1 - shift;
+    *sig = frac << shift;
+}
+
+//==============================================================================
+// Rounding
+//==============================================================================
+
+/**
+ * Round and pack a result
+ * @param exp - Biased exponent minus one
+ * @param sig - Significand with its leading one at bit 30 and seven
+ *              rounding bits below the LSB (bit 0 is sticky)
+ */
+static uint32_t round_pack(bool sign, int exp, uint32_t sig, int rm, uint32_t* flags) {
+    bool round_near_even = (rm == FP32_RM_RNE);
+    uint32_t round_increment = 0x40;
+    if (!round_near_even && rm != FP32_RM_RMM) {
+        round_increment = (rm == (sign ? FP32_RM_RDN : FP32_RM_RUP)) ? 0x7F : 0;
+    }
+    uint32_t round_bits = sig & 0x7F;
+
+    if ((unsigned)exp >= 0xFD) {
+        if (exp < 0) {
+            // RISC-V detects tininess after rounding
+            bool tiny = (exp < -1) || (sig + round_increment < 0x80000000u);
+            sig = shift_right_jam32(sig, -exp);
+            exp = 0;
+            round_bits = sig & 0x7F;
+            if (tiny && round_bits) *flags |= FP32_FLAG_UF;
+        } else if (exp > 0xFD || sig + round_increment >= 0x80000000u) {
+            *flags |= FP32_FLAG_OF | FP32_FLAG_NX;
+            return pack(sign, 0xFF, 0) - !round_increment;
+        }
+    }
+
+    sig = (sig + round_increment) >> 7;
+    if (round_bits) *flags |= FP32_FLAG_NX;
+    sig &= ~(uint32_t)(!(round_bits ^ 0x40) & round_near_even);
+    if (!sig) exp = 0;
+    return pack(sign, exp, sig);
+}
+
+static uint32_t norm_round_pack(bool sign, int exp, uint32_t sig, int rm, uint32_t* flags) {
+    int shift = clz32(sig) - 1;
+    exp -= shift;
+    if (shift >= 7 && (unsigned)exp < 0xFD) {
+        return pack(sign, sig ? exp : 0, sig << (shift - 7));
+    }
+    return round_pack(sign, exp, sig << shift, rm, flags);
+}
+
+//==============================================================================
+// Arithmetic
+//==============================================================================
+
+static uint32_t add_mags(uint32_t a, uint32_t b, int rm, uint32_t* flags) {
+    int exp_a = exp_of(a), exp_b = exp_of(b);
+    uint32_t sig_a = frac_of(a), sig_b = frac_of(b);
+    int exp_diff = exp_a - exp_b;
+    bool sign = sign_of(a);
+    int exp;
+    uint32_t sig;
+
+    if (!exp_diff) {
+        if (!exp_a) return a + sig_b;
+        if (exp_a == 0xFF) {
+            if (sig_a | sig_b) return propagate_nan(a, b, flags);
+            return a;
+        }
+        exp = exp_a;
+        sig = 0x01000000 + sig_a + sig_b;
+        if (!(sig & 1) && exp < 0xFE) return pack(sign, exp, sig >> 1);
+        sig <<= 6;
+    } else {
+        sig_a <<= 6;
+        sig_b <<= 6;
+        if (exp_diff < 0) {
+            if (exp_b == 0xFF) {
+                if (sig_b) return propagate_nan(a, b, flags);
+                return pack(sign, 0xFF, 0);
+            }
+            exp = exp_b;
+            sig_a += exp_a ? 0x20000000 : sig_a;
+            sig_a = shift_right_jam32(sig_a, -exp_diff);
+        } else {
+            if (exp_a == 0xFF) {
+                if (sig_a) return propagate_nan(a, b, flags);
+                return a;
+            }
+            exp = exp_a;
+            sig_b += exp_b ? 0x20000000 : sig_b;
+            sig_b = shift_right_jam32(sig_b, exp_diff);
+        }
+        sig = 0x20000000 + sig_a + sig_b;
+        if (sig < 0x40000000) {
+            --exp;
+            sig <<= 1;
+        }
+    }
+    return round_pack(sign, exp, sig, rm, flags);
+}
+
+static uint32_t sub_mags(uint32_t a, uint32_t b, int rm, uint32_t* flags) {
+    int exp_a = exp_of(a), exp_b = exp_of(b);
+    uint32_t sig_a = frac_of(a), sig_b = frac_of(b);
+    int exp_diff = exp_a - exp_b;
+    bool sign = sign_of(a);
+
+    if (!exp_diff) {
+        if (exp_a == 0xFF) {
+            if (sig_a | sig_b) return propagate_nan(a, b, flags);
+            *flags |= FP32_FLAG_NV;
+            return FP32_CANONICAL_NAN;
+        }
+        int32_t sig_diff = (int32_t)sig_a - (int32_t)sig_b;
+        if (!sig_diff) return pack(rm == FP32_RM_RDN, 0, 0);
+        if (exp_a) --exp_a;
+        if (sig_diff < 0) {
+            sign = !sign;
+            sig_diff = -sig_diff;
+        }
+        int shift = clz32((uint32_t)sig_diff) - 8;
+        int exp = exp_a - shift;
+        if (exp < 0) {
+            shift = exp_a;
+            exp = 0;
+        }
+        return pack(sign, exp, (uint32_t)sig_diff << shift);
+    }
+
+    uint32_t sig_x, sig_y;
+    int exp;
+    sig_a <<= 7;
+    sig_b <<= 7;
+    if (exp_diff < 0) {
+        sign = !sign;
+        if (exp_b == 0xFF) {
+            if (sig_b) return propagate_nan(a, b, flags);
+            return pack(sign, 0xFF, 0);
+        }
+        exp = exp_b - 1;
+        sig_x = sig_b | 0x40000000;
+        sig_y = sig_a + (exp_a ? 0x40000000 : sig_a);
+        exp_diff = -exp_diff;
+    } else {
+        if (exp_a == 0xFF) {
+            if (sig_a) return propagate_nan(a, b, flags);
+            return a;
+        }
+        exp = exp_a - 1;
+        sig_x = sig_a | 0x40000000;
+        sig_y = sig_b + (exp_b ? 0x40000000 : sig_b);
+    }
+    return norm_round_pack(sign, exp, sig_x - shift_right_jam32(sig_y, exp_diff), rm, flags);
+}
+
+uint32_t fp32_add(uint32_t a, uint32_t b, int rm, uint32_t* flags) {
+    return (sign_of(a) == sign_of(b)) ? add_mags(a, b, rm, flags)
+                                      : sub_mags(a, b, rm, flags);
+}
+
+uint32_t fp32_sub(uint32_t a, uint32_t b, int rm, uint32_t* flags) {
+    return fp32_add(a, b ^ 0x80000000u, rm, flags);
+}
+
+uint32_t fp32_mul(uint32_t a, uint32_t b, int rm, uint32_t* flags) {
+    int exp_a = exp_of(a), exp_b = exp_of(b);
+    uint32_t sig_a = frac_of(a), sig_b = frac_of(b);
+    bool sign = sign_of(a) ^ sign_of(b);
+
+    if (exp_a == 0xFF || exp_b == 0xFF) {
+        if (is_nan(a) || is_nan(b)) return propagate_nan(a, b, flags);
+        uint32_t other = (exp_a == 0xFF) ? (exp_b | sig_b) : (exp_a | sig_a);
+        if (!other) {
+            *flags |= FP32_FLAG_NV;
+            return FP32_CANONICAL_NAN;
+        }
+        return pack(sign, 0xFF, 0);
+    }
+    if (!exp_a) {
+        if (!sig_a) return pack(sign, 0, 0);
+        normalize_subnormal(sig_a, &exp_a, &sig_a);
+    }
+    if (!exp_b) {
+        if (!sig_b) return pack(sign, 0, 0);
+        normalize_subnormal(sig_b, &exp_b, &sig_b);
+    }
+
+    int exp = exp_a + exp_b - 0x7F;
+    uint64_t prod = (uint64_t)((sig_a | 0x00800000) << 7) * ((sig_b | 0x00800000) << 8);
+    uint32_t sig = (uint32_t)shift_right_jam64(prod, 32);
+    if (sig < 0x40000000) {
+        --exp;
+        sig <<= 1;
+    }
+    return round_pack(sign, exp, sig, rm, flags);
+}
+
+uint32_t fp32_div(uint32_t a, uint32_t b, int rm, uint32_t* flags) {
+    int exp_a = exp_of(a), exp_b = exp_of(b);
+    uint32_t sig_a = frac_of(a), sig_b = frac_of(b);
+    bool sign = sign_of(a) ^ sign_of(b);
+
+    if (exp_a == 0xFF) {
+        if (sig_a) return propagate_nan(a, b, flags);
+        if (exp_b == 0xFF) {
+            if (sig_b) return propagate_nan(a, b, flags);
+            *flags |= FP32_FLAG_NV;
+            return FP32_CANONICAL_NAN;
+        }
+        return pack(sign, 0xFF, 0);
+    }
+    if (exp_b == 0xFF) {
+        if (sig_b) return propagate_nan(a, b, flags);
+        return pack(sign, 0, 0);
+    }
+    if (!exp_b) {
+        if (!sig_b) {
+            if (!(exp_a | sig_a)) {
+                *flags |= FP32_FLAG_NV;
+                return FP32_CANONICAL_NAN;
+            }
+            *flags |= FP32_FLAG_DZ;
+            return pack(sign, 0xFF, 0);
+        }
+        normalize_subnormal(sig_b, &exp_b, &sig_b);
+    }
+    if (!exp_a) {
+        if (!sig_a) return pack(sign, 0, 0);
+        normalize_subnormal(sig_a, &exp_a, &sig_a);
+    }
+
+    int exp = exp_a - exp_b + 0x7E;
+    sig_a |= 0x00800000;
+    sig_b |= 0x00800000;
+    uint64_t dividend;
+    if (sig_a < sig_b) {
+        --exp;
+        dividend = (uint64_t)sig_a << 31;
+    } else {
+        dividend = (uint64_t)sig_a << 30;
+    }
+    uint32_t sig = (uint32_t)(dividend / sig_b);
+    if (!(sig & 0x3F)) sig |= ((uint64_t)sig_b * sig != dividend);
+    return round_pack(sign, exp, sig, rm, flags);
+}
+
+uint32_t fp32_sqrt(uint32_t a, int rm, uint32_t* flags) {
+    int exp_a = exp_of(a);
+    uint32_t sig_a = frac_of(a);
+    bool sign = sign_of(a);
+
+    if (exp_a == 0xFF) {
+        if (sig_a) return propagate_nan(a, 0, flags);
+        if (!sign) return a;
+        *flags |= FP32_FLAG_NV;
+        return FP32_CANONICAL_NAN;
+    }
+    if (sign) {
+        if (!(exp_a | sig_a)) return a;
+        *flags |= FP32_FLAG_NV;
+        return FP32_CANONICAL_NAN;
+    }
+    if (!exp_a) {
+        if (!sig_a) return a;
+        normalize_subnormal(sig_a, &exp_a, &sig_a);
+    }
+
+    // a = sig24 * 2^(e - 23); scale sig24 by 2^37 or 2^38 so that the
+    // remaining power of two is even and the root lands in [2^30, 2^31)
+    int e = exp_a - 0x7F;
+    int shift = (e & 1) ? 38 : 37;
+    uint64_t radicand = (uint64_t)(sig_a | 0x00800000) << shift;
+    uint64_t root = 1ull << 30;
+    for (uint64_t bit = 1ull << 29; bit; bit >>= 1) {
+        if ((root | bit) * (root | bit) <= radicand) root |= bit;
+    }
+    if (root * root != radicand) root |= 1;
+    return round_pack(false, (e - 23 - shift) / 2 + 156, (uint32_t)root, rm, flags);
+}
+
+/**
+ * Fused a*b + c with a single rounding. The exact product (48 bits) and the
+ * addend are aligned in a 128-bit accumulator; bits shifted out are jammed
+ * into a sticky bit.
+ */
+uint32_t fp32_fma(uint32_t a, uint32_t b, uint32_t c, int rm, uint32_t* flags) {
+    int exp_a = exp_of(a), exp_b = exp_of(b), exp_c = exp_of(c);
+    uint32_t sig_a = frac_of(a), sig_b = frac_of(b), sig_c = frac_of(c);
+    bool sign_prod = sign_of(a) ^ sign_of(b);
+    bool sign_c = sign_of(c);
+
+    if (is_nan(a) || is_nan(b)) {
+        if (is_snan(c)) *flags |= FP32_FLAG_NV;
+        return propagate_nan(a, b, flags);
+    }
+    if (exp_a == 0xFF || exp_b == 0xFF) {
+        uint32_t other = (exp_a == 0xFF) ? (exp_b | sig_b) : (exp_a | sig_a);
+        if (!other) {
+            *flags |= FP32_FLAG_NV;
+            return FP32_CANONICAL_NAN;
+        }
+        if (is_nan(c)) return propagate_nan(c, 0, flags);
+        if (exp_c == 0xFF && sign_c != sign_prod) {
+            *flags |= FP32_FLAG_NV;
+            return FP32_CANONICAL_NAN;
+        }
+        return pack(sign_prod, 0xFF, 0);
+    }
+    if (exp_c == 0xFF) {
+        if (sig_c) return propagate_nan(c, 0, flags);
+        return c;
+    }
+
+    bool zero_prod = !(exp_a | sig_a) || !(exp_b | sig_b);
+    bool zero_c = !(exp_c | sig_c);
+    if (zero_prod) {
+        if (!zero_c) return c;
+        if (sign_prod == sign_c) return pack(sign_c, 0, 0);
+        return pack(rm == FP32_RM_RDN, 0, 0);
+    }
+
+    // Exact operands as integer * 2^exponent
+    if (!exp_a) normalize_subnormal(sig_a, &exp_a, &sig_a);
+    if (!exp_b) normalize_subnormal(sig_b, &exp_b, &sig_b);
+    unsigned __int128 m_prod = (uint64_t)(sig_a | 0x00800000) * (sig_b | 0x00800000);
+    int e_prod = exp_a + exp_b - 300;
+    int len_prod = (m_prod >> 47) ? 48 : 47;
+    unsigned __int128 m_c = 0;
+    int e_c = e_prod;
+    int len_c = 0;
+    if (!zero_c) {
+        if (!exp_c) normalize_subnormal(sig_c, &exp_c, &sig_c);
+        m_c = sig_c | 0x00800000;
+        e_c = exp_c - 150;
+        len_c = 24;
+    }
+
+    // Put the operand with the larger magnitude bound at bit 120 and align
+    // the other to it; its leading one then lies at or below bit 120
+    bool prod_is_base = zero_c || e_prod + len_prod >= e_c + len_c;
+    unsigned __int128& m_base = prod_is_base ? m_prod : m_c;
+    unsigned __int128& m_other = prod_is_base ? m_c : m_prod;
+    int e_base = prod_is_base ? e_prod : e_c;
+    int e_other = prod_is_base ? e_c : e_prod;
+    int up = 120 - (prod_is_base ? len_prod : len_c);
+    m_base <<= up;
+    e_base -= up;
+    int dist = e_base - e_other;
+    if (dist <= 0) {
+        m_other <<= -dist;
+    } else if (dist < 127) {
+        bool sticky = (m_other & (((unsigned __int128)1 << dist) - 1)) != 0;
+        m_other = (m_other >> dist) | sticky;
+    } else {
+        m_other = (m_other != 0);
+    }
+
+    unsigned __int128 m;
+    bool sign;
+    if (sign_prod == sign_c) {
+        m = m_prod + m_c;
+        sign = sign_prod;
+    } else if (m_prod >= m_c) {
+        m = m_prod - m_c;
+        sign = sign_prod;
+    } else {
+        m = m_c - m_prod;
+        sign = sign_c;
+    }
+    if (!m) return pack(rm == FP32_RM_RDN, 0, 0);
+
+    int top = 127;
+    while (!((m >> top) & 1)) --top;
+    int exp = e_base + top - 30 + 156;
+    uint32_t sig;
+    if (top > 30) {
+        int drop = top - 30;
+        bool sticky = (m & (((unsigned __int128)1 << drop) - 1)) != 0;
+        sig = (uint32_t)(m >> drop) | sticky;
+    } else {
+        sig = (uint32_t)m << (30 - top);
+    }
+    return round_pack(sign, exp, sig, rm, flags);
+}
+
+//==============================================================================
+// Sign Injection, Min/Max, Compare, Classify
+//==============================================================================
+
+uint32_t fp32_sgnj(uint32_t a, uint32_t b) {
+    return (a & 0x7FFFFFFFu) | (b & 0x80000000u);
+}
+
+uint32_t fp32_sgnjn(uint32_t a, uint32_t b) {
+    return (a & 0x7FFFFFFFu) | (~b & 0x80000000u);
+}
+
+uint32_t fp32_sgnjx(uint32_t a, uint32_t b) {
+    return a ^ (b & 0x80000000u);
+}
+
+static bool lt_quiet(uint32_t a, uint32_t b) {
+    bool sign_a = sign_of(a), sign_b = sign_of(b);
+    if (sign_a != sign_b) return sign_a && ((a | b) & 0x7FFFFFFFu);
+    return (a != b) && (sign_a ^ (a < b));
+}
+
+/**
+ * RISC-V 2.2 minNum/maxNum: a single NaN operand yields the other operand,
+ * two NaNs yield the canonical NaN, and -0.0 orders below +0.0
+ */
+static uint32_t min_max(uint32_t a, uint32_t b, bool is_max, uint32_t* flags) {
+    if (is_snan(a) || is_snan(b)) *flags |= FP32_FLAG_NV;
+    if (is_nan(a) && is_nan(b)) return FP32_CANONICAL_NAN;
+    if (is_nan(a)) return b;
+    if (is_nan(b)) return a;
+    bool a_less = lt_quiet(a, b) || (a == 0x80000000u && b == 0);
+    return (a_less != is_max) ? a : b;
+}
+
+uint32_t fp32_min(uint32_t a, uint32_t b, uint32_t* flags) {
+    return min_max(a, b, false, flags);
+}
+
+uint32_t fp32_max(uint32_t a, uint32_t b, uint32_t* flags) {
+    return min_max(a, b, true, flags);
+}
+
+uint32_t fp32_eq(uint32_t a, uint32_t b, uint32_t* flags) {
+    if (is_nan(a) || is_nan(b)) {
+        if (is_snan(a) || is_snan(b)) *flags |= FP32_FLAG_NV;
+        return 0;
+    }
+    return (a == b) || !((a | b) & 0x7FFFFFFFu);
+}
+
+uint32_t fp32_lt(uint32_t a, uint32_t b, uint32_t* flags) {
+    if (is_nan(a) || is_nan(b)) {
+        *flags |= FP32_FLAG_NV;
+        return 0;
+    }
+    return lt_quiet(a, b);
+}
+
+uint32_t fp32_le(uint32_t a, uint32_t b, uint32_t* flags) {
+    if (is_nan(a) || is_nan(b)) {
+        *flags |= FP32_FLAG_NV;
+        return 0;
+    }
+    return (a == b) || !((a | b) & 0x7FFFFFFFu) || lt_quiet(a, b);
+}
+
+uint32_t fp32_classify(uint32_t a) {
+    bool sign = sign_of(a);
+    int exp = exp_of(a);
+    uint32_t frac = frac_of(a);
+
+    if (exp == 0xFF) {
+        if (!frac) return sign ? (1u << 0) : (1u << 7);
+        return (frac & 0x00400000) ? (1u << 9) : (1u << 8);
+    }
+    if (!exp) {
+        if (!frac) return sign ? (1u << 3) : (1u << 4);
+        return sign ? (1u << 2) : (1u << 5);
+    }
+    return sign ? (1u << 1) : (1u << 6);
+}
+
+//==============================================================================
+// Conversions
+//==============================================================================
+
+/**
+ * Round |a| to an integer magnitude
+ * @param overflow - Set when the magnitude cannot fit in 33 bits
+ * @param inexact  - Set when rounding discarded a non-zero fraction
+ */
+static uint64_t round_to_int(uint32_t a, int rm, bool* overflow, bool* inexact) {
+    bool sign = sign_of(a);
+    int exp = exp_of(a);
+    uint64_t sig = frac_of(a) | (exp ? 0x00800000 : 0);
+    int shift = exp - 150;
+
+    *overflow = false;
+    *inexact = false;
+    if (shift >= 0) {
+        if (shift > 9) {
+            *overflow = true;
+            return 0;
+        }
+        return sig << shift;
+    }
+
+    // Keep a half bit and a sticky bit below the integer LSB
+    uint64_t mag = (-shift < 40) ? sig >> -shift : 0;
+    uint64_t rest = (-shift < 40) ? sig & ((1ull << -shift) - 1) : sig;
+    uint64_t half = (-shift < 40) ? 1ull << (-shift - 1) : 0;
+    bool round_half = half && (rest & half);
+    bool sticky = half ? (rest & (half - 1)) != 0 : rest != 0;
+    if (!rest) return mag;
+
+    *inexact = true;
+    bool increment = false;
+    switch (rm) {
+        case FP32_RM_RNE: increment = round_half && (sticky || (mag & 1)); break;
+        case FP32_RM_RMM: increment = round_half; break;
+        case FP32_RM_RDN: increment = sign; break;
+        case FP32_RM_RUP: increment = !sign; break;
+        default: break;
+    }
+    return mag + increment;
+}
+
+uint32_t fp32_to_i32(uint32_t a, int rm, uint32_t* flags) {
+    bool sign = sign_of(a);
+    if (is_nan(a)) {
+        *flags |= FP32_FLAG_NV;
+        return 0x7FFFFFFFu;
+    }
+    bool overflow, inexact;
+    uint64_t mag = round_to_int(a, rm, &overflow, &inexact);
+    if (overflow || mag > (sign ? 0x80000000ull : 0x7FFFFFFFull)) {
+        *flags |= FP32_FLAG_NV;
+        return sign ? 0x80000000u : 0x7FFFFFFFu;
+    }
+    if (inexact) *flags |= FP32_FLAG_NX;
+    return sign ? (uint32_t)(-(int64_t)mag) : (uint32_t)mag;
+}
+
+uint32_t fp32_to_u32(uint32_t a, int rm, uint32_t* flags) {
+    bool sign = sign_of(a);
+    if (is_nan(a)) {
+        *flags |= FP32_FLAG_NV;
+        return 0xFFFFFFFFu;
+    }
+    bool overflow, inexact;
+    uint64_t mag = round_to_int(a, rm, &overflow, &inexact);
+    if (sign && (overflow || mag)) {
+        *flags |= FP32_FLAG_NV;
+        return 0;
+    }
+    if (overflow || mag > 0xFFFFFFFFull) {
+        *flags |= FP32_FLAG_NV;
+        return 0xFFFFFFFFu;
+    }
+    if (inexact) *flags |= FP32_FLAG_NX;
+    return (uint32_t)mag;
+}
+
+uint32_t fp32_from_i32(uint32_t a, int rm, uint32_t* flags) {
+    bool sign = a >> 31;
+    if (!(a & 0x7FFFFFFFu)) return sign ? 0xCF000000u : 0;
+    uint32_t mag = sign ? -a : a;
+    return norm_round_pack(sign, 0x9C, mag, rm, flags);
+}
+
+uint32_t fp32_from_u32(uint32_t a, int rm, uint32_t* flags) {
+    if (!a) return 0;
+    if (a & 0x80000000u) {
+        return round_pack(false, 0x9D, (a >> 1) | (a & 1), rm, flags);
+    }
+    return norm_round_pack(false, 0x9C, a, rm, flags);
+}
+
+//==============================================================================
+// Instruction Evaluation
+//==============================================================================
+
+int fp32_execute(uint32_t opcode, uint32_t funct7, uint32_t funct3, uint32_t rs2,
+                 uint32_t a, uint32_t b, uint32_t c, uint32_t frm,
+                 uint32_t* result, uint32_t* flags) {
+    *result = 0;
+    *flags = 0;
+
+    // Only the single-precision format is implemented
+    if ((funct7 & 0x3) != 0) return -1;
+
+    int rm = (funct3 == FP32_RM_DYN) ? (int)frm : (int)funct3;
+    bool rm_valid = rm <= FP32_RM_RMM;
+
+    switch (opcode & 0x7F) {
+        case OPCODE_FMADD:
+            if (!rm_valid) return -1;
+            *result = fp32_fma(a, b, c, rm, flags);
+            return 0;
+        case OPCODE_FMSUB:
+            if (!rm_valid) return -1;
+            *result = fp32_fma(a, b, c ^ 0x80000000u, rm, flags);
+            return 0;
+        case OPCODE_FNMSUB:
+            if (!rm_valid) return -1;
+            *result = fp32_fma(a ^ 0x80000000u, b, c, rm, flags);
+            return 0;
+        case OPCODE_FNMADD:
+            if (!rm_valid) return -1;
+            *result = fp32_fma(a ^ 0x80000000u, b, c ^ 0x80000000u, rm, flags);
+            return 0;
+        case OPCODE_OP_FP:
+            break;
+        default:
+            return -1;
+    }
+
+    switch (funct7 >> 2) {
+        case 0x00:  // FADD.S
+            if (!rm_valid) return -1;
+            *result = fp32_add(a, b, rm, flags);
+            return 0;
+        case 0x01:  // FSUB.S
+            if (!rm_valid) return -1;
+            *result = fp32_sub(a, b, rm, flags);
+            return 0;
+        case 0x02:  // FMUL.S
+            if (!rm_valid) return -1;
+            *result = fp32_mul(a, b, rm, flags);
+            return 0;
+        case 0x03:  // FDIV.S
+            if (!rm_valid) return -1;
+            *result = fp32_div(a, b, rm, flags);
+            return 0;
+        case 0x0B:  // FSQRT.S
+            if (!rm_valid || rs2 != 0) return -1;
+            *result = fp32_sqrt(a, rm, flags);
+            return 0;
+        case 0x04:  // FSGNJ[N|X].S
+            switch (funct3) {
+                case 0: *result = fp32_sgnj(a, b); return 0;
+                case 1: *result = fp32_sgnjn(a, b); return 0;
+                case 2: *result = fp32_sgnjx(a, b); return 0;
+                default: return -1;
+            }
+        case 0x05:  // FMIN.S / FMAX.S
+            switch (funct3) {
+                case 0: *result = fp32_min(a, b, flags); return 0;
+                case 1: *result = fp32_max(a, b, flags); return 0;
+                default: return -1;
+            }
+        case 0x14:  // FLE.S / FLT.S / FEQ.S
+            switch (funct3) {
+                case 0: *result = fp32_le(a, b, flags); return 0;
+                case 1: *result = fp32_lt(a, b, flags); return 0;
+                case 2: *result = fp32_eq(a, b, flags); return 0;
+                default: return -1;
+            }
+        case 0x18:  // FCVT.W[U].S
+            if (!rm_valid) return -1;
+            switch (rs2) {
+                case 0: *result = fp32_to_i32(a, rm, flags); return 0;
+                case 1: *result = fp32_to_u32(a, rm, flags); return 0;
+                default: return -1;
+            }
+        case 0x1A:  // FCVT.S.W[U]
+            if (!rm_valid) return -1;
+            switch (rs2) {
+                case 0: *result = fp32_from_i32(a, rm, flags); return 0;
+                case 1: *result = fp32_from_u32(a, rm, flags); return 0;
+                default: return -1;
+            }
+        case 0x1C:  // FMV.X.W / FCLASS.S
+            if (rs2 != 0) return -1;
+            switch (funct3) {
+                case 0: *result = a; return 0;
+                case 1: *result = fp32_classify(a); return 0;
+                default: return -1;
+            }
+        case 0x1E:  // FMV.W.X
+            if (rs2 != 0 || funct3 != 0) return -1;
+            *result = a;
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+//==============================================================================
+// DPI Interface
+//==============================================================================
+
+extern "C" {
+
+/**
+ * Evaluate one RV32F instruction without Spike
+ * @param instruction - 32-bit encoding; opcode, funct7, funct3 and rs2 are
+ *                      taken from it
+ * @param op1, op2, op3 - Values of rs1, rs2 and rs3
+ * @param frm - Dynamic rounding mode (fcsr.frm)
+ * @param result - Result bits
+ * @param fflags - Exception flags raised
+ * @return 0 on success, -1 for an illegal encoding or rounding mode
+ */
+int fp32_ref_execute(int instruction, int op1, int op2, int op3, int frm,
+                     int* result, int* fflags) {
+    uint32_t insn = (uint32_t)instruction;
+    uint32_t res, flags;
+    int status = fp32_execute(insn & 0x7F, insn >> 25, (insn >> 12) & 0x7,
+                              (insn >> 20) & 0x1F, (uint32_t)op1, (uint32_t)op2,
+                              (uint32_t)op3, (uint32_t)frm & 0x7, &res, &flags);
+    *result = (int)res;
+    *fflags = (int)flags;
+    return status;
+}
+
+} // extern "C"
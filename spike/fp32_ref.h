@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * Native RV32F Reference Engine
+ *
+ * Bit-accurate single-precision arithmetic following the RISC-V F extension:
+ * IEEE-754 rounding in all five RISC-V modes, tininess detected after
+ * rounding, canonical NaN results and RISC-V fflags. No Spike instance is
+ * needed, so it can be called per operation at negligible cost.
+ ******************************************************************************/
+
+#ifndef FP32_REF_H
+#define FP32_REF_H
+
+#include <cstdint>
+
+// fflags bits (fcsr[4:0])
+#define FP32_FLAG_NX 0x01u   // Inexact
+#define FP32_FLAG_UF 0x02u   // Underflow
+#define FP32_FLAG_OF 0x04u   // Overflow
+#define FP32_FLAG_DZ 0x08u   // Divide by zero
+#define FP32_FLAG_NV 0x10u   // Invalid operation
+
+// Rounding modes (instruction rm / frm encoding)
+#define FP32_RM_RNE 0
+#define FP32_RM_RTZ 1
+#define FP32_RM_RDN 2
+#define FP32_RM_RUP 3
+#define FP32_RM_RMM 4
+#define FP32_RM_DYN 7
+
+#define FP32_CANONICAL_NAN 0x7FC00000u
+
+// Arithmetic; every function ORs the exceptions it raises into *flags
+uint32_t fp32_add(uint32_t a, uint32_t b, int rm, uint32_t* flags);
+uint32_t fp32_sub(uint32_t a, uint32_t b, int rm, uint32_t* flags);
+uint32_t fp32_mul(uint32_t a, uint32_t b, int rm, uint32_t* flags);
+uint32_t fp32_div(uint32_t a, uint32_t b, int rm, uint32_t* flags);
+uint32_t fp32_sqrt(uint32_t a, int rm, uint32_t* flags);
+uint32_t fp32_fma(uint32_t a, uint32_t b, uint32_t c, int rm, uint32_t* flags);  // a*b + c
+
+// Sign injection, min/max, comparison and classification
+uint32_t fp32_sgnj(uint32_t a, uint32_t b);
+uint32_t fp32_sgnjn(uint32_t a, uint32_t b);
+uint32_t fp32_sgnjx(uint32_t a, uint32_t b);
+uint32_t fp32_min(uint32_t a, uint32_t b, uint32_t* flags);
+uint32_t fp32_max(uint32_t a, uint32_t b, uint32_t* flags);
+uint32_t fp32_eq(uint32_t a, uint32_t b, uint32_t* flags);
+uint32_t fp32_lt(uint32_t a, uint32_t b, uint32_t* flags);
+uint32_t fp32_le(uint32_t a, uint32_t b, uint32_t* flags);
+uint32_t fp32_classify(uint32_t a);
+
+// Conversions
+uint32_t fp32_to_i32(uint32_t a, int rm, uint32_t* flags);
+uint32_t fp32_to_u32(uint32_t a, int rm, uint32_t* flags);
+uint32_t fp32_from_i32(uint32_t a, int rm, uint32_t* flags);
+uint32_t fp32_from_u32(uint32_t a, int rm, uint32_t* flags);
+
+/**
+ * Evaluate one RV32F computational instruction from its fields
+ * @param opcode - Major opcode (OP-FP or one of the four fused opcodes)
+ * @param funct7 - instruction[31:25]; for fused ops only fmt ([1:0]) is used
+ * @param funct3 - instruction[14:12] (rm, or the operation selector)
+ * @param rs2    - instruction[24:20] (selects the FCVT variant)
+ * @param a, b, c - Values of rs1, rs2 and rs3 (rs1 is an integer for
+ *                  FCVT.S.W[U] and FMV.W.X)
+ * @param frm    - Dynamic rounding mode, used when funct3 is 7
+ * @param result - Result bits (FP or integer, depending on the operation)
+ * @param flags  - fflags raised
+ * @return 0 on success, -1 for an illegal encoding or rounding mode
+ */
+int fp32_execute(uint32_t opcode, uint32_t funct7, uint32_t funct3, uint32_t rs2,
+                 uint32_t a, uint32_t b, uint32_t c, uint32_t frm,
+                 uint32_t* result, uint32_t* flags);
+
+#endif // FP32_REF_H
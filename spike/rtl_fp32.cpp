@@ -0,0 +1,460 @@
+/*******************************************************************************
+ * Bit-Accurate Models of the RTL FP32 Units
+ *
+ * One function per unit in rtl/. Each follows the register transfers the
+ * unit's FSM performs for one operation, state by state, keeping every
+ * intermediate at its RTL width (masks below stand for truncation to a
+ * logic [N-1:0]). Values a state reads before the previous state's
+ * register update are taken from before the update, as in the RTL.
+ *
+ * Multi-cycle sub-units (mul_2cycle, divider64, sqrt) are evaluated to
+ * completion. fpu_div takes divider64's valid_o, which is its ready
+ * output, so in the core it can read the quotient before the division has
+ * run; the model gives it the finished quotient so the datapath can be
+ * checked on its own.
+ *
+ * Compile (with the reference engine, for rtl_fp32_sweep and
+ *          rtl_fp32_exhaustive):
+ *   g++ -O2 -c rtl_fp32.cpp
+ ******************************************************************************/
+
+#include "rtl_fp32.h"
+#include "fp32_ref.h"
+
+static inline uint32_t sign_of(uint32_t a) { return a >> 31; }
+static inline uint32_t exp_of(uint32_t a) { return (a >> 23) & 0xFF; }
+static inline uint32_t frac_of(uint32_t a) { return a & 0x007FFFFF; }
+
+//==============================================================================
+// fpu_add_sub
+//==============================================================================
+
+/**
+ * fpu_add_sub: operands aligned in 32-bit {1, frac, 8'b0} registers,
+ * 33-bit add/subtract, leading-zero normalisation after a subtraction and
+ * rounding on the low 8 bits
+ * @param sub - add0_sub1 (flips the sign of b)
+ * @param frm - Rounding mode input; encodings above RMM do not round
+ */
+uint32_t rtl_fp32_add_sub(uint32_t a, uint32_t b, int sub, int frm, uint32_t* flags) {
+    uint32_t eA = exp_of(a);
+    uint32_t eB = exp_of(b);
+    uint32_t sA = sign_of(a);
+    uint32_t sB = sign_of(b) ^ (sub ? 1 : 0);
+    uint32_t mA = 0x80000000u | (frac_of(a) << 8);
+    uint32_t mB = 0x80000000u | (frac_of(b) << 8);
+    uint32_t eR_combout, sR;
+
+    if (eA > eB) {
+        eR_combout = eA;
+        sR = sA;
+    } else {
+        eR_combout = eB;
+        sR = (eA == eB && mA > mB) ? sA : sB;
+    }
+
+    // abs_exp_diff takes the 8-bit difference as signed
+    uint32_t exp_diff = (eA - eB) & 0xFF;
+    uint32_t abs_exp_diff = (exp_diff & 0x80) ? (-exp_diff & 0xFF) : exp_diff;
+    uint32_t mB_shifted = (abs_exp_diff < 32) ? mB >> abs_exp_diff : 0;
+    uint32_t mA_shifted = (abs_exp_diff < 32) ? mA >> abs_exp_diff : 0;
+
+    // {cout, mR} = 33-bit sum or difference
+    uint64_t sum;
+    if (sA ^ sB) {
+        sum = (eA > eB) ? (uint64_t)mA - mB_shifted : (uint64_t)mB - mA_shifted;
+    } else {
+        sum = (eA > eB) ? (uint64_t)mA + mB_shifted : (uint64_t)mB + mA_shifted;
+    }
+    uint32_t cout = (sum >> 32) & 1;
+    uint32_t mR = (uint32_t)sum;
+    if ((sA ^ sB) && cout) mR = ~mR + 1;
+
+    uint32_t mR_final, eR;
+    if (sA ^ sB) {
+        // zero_count is 5 bits: a zero difference counts 32 and wraps to 0
+        uint32_t zero_count = (mR ? __builtin_clz(mR) : 32) & 0x1F;
+        mR_final = mR << zero_count;
+        eR = (eR_combout - zero_count) & 0xFF;
+    } else if (cout) {
+        mR_final = mR >> 1;
+        eR = (eR_combout + 1) & 0xFF;
+    } else {
+        mR_final = mR;
+        eR = eR_combout;
+    }
+
+    uint32_t guard = (mR_final >> 7) & 1;
+    uint32_t round = (mR_final >> 6) & 1;
+    uint32_t sticky = (mR_final & 0x3F) != 0;
+    uint32_t round_up;
+    switch (frm) {
+        case 0:  round_up = guard & (round | sticky | (mR_final & 1)); break;  // RNE
+        case 2:  round_up = sR & (guard | round | sticky); break;              // RDN
+        case 3:  round_up = !sR && (guard | round | sticky); break;            // RUP
+        case 4:  round_up = guard & (round | sticky); break;                   // RMM
+        default: round_up = 0; break;                                           // RTZ
+    }
+
+    uint32_t mantissa_rounded = ((mR_final >> 8) + round_up) & 0xFFFFFF;
+    if (mR_final & 0xFF) *flags |= FP32_FLAG_NX;
+    return (sR << 31) | (eR << 23) | (mantissa_rounded & 0x7FFFFF);
+}
+
+//==============================================================================
+// fpu_mul
+//==============================================================================
+
+/**
+ * fpu_mul: 24x24-bit significand product from mul_2cycle, then one
+ * NORMALIZE state that shifts the product and, in the same cycle, rounds
+ * the product as it was before the shift
+ * @param frm - Rounding mode input; encodings above RMM do not round
+ */
+uint32_t rtl_fp32_mul(uint32_t a, uint32_t b, int frm, uint32_t* flags) {
+    uint32_t sR = sign_of(a) ^ sign_of(b);
+    uint64_t mA = 0x800000u | frac_of(a);
+    uint64_t mB = 0x800000u | frac_of(b);
+    uint32_t eR = (exp_of(a) + exp_of(b) - 127) & 0x1FF;
+    uint64_t mR_full = (mA * mB) & 0xFFFFFFFFFFFFull;
+
+    // Rounding reads mR_full before NORMALIZE updates it
+    uint32_t guard = (mR_full >> 22) & 1;
+    uint32_t round_bit = (mR_full >> 21) & 1;
+    uint32_t sticky = (mR_full & 0x1FFFFF) != 0;
+    uint32_t round_up;
+    switch (frm) {
+        case 0:  round_up = guard && (round_bit || sticky || ((mR_full >> 23) & 1)); break;
+        case 2:  round_up = sR && guard && (round_bit || sticky); break;
+        case 3:  round_up = !sR && guard && (round_bit || sticky); break;
+        case 4:  round_up = guard && (round_bit || sticky); break;
+        default: round_up = 0; break;
+    }
+    uint32_t mR_rounded = (uint32_t)(((mR_full >> 23) + round_up) & 0xFFFFFF);
+
+    // NORMALIZE register updates; the rounding overflow branch assigns
+    // eR_reg last, so it wins over the normalisation shift
+    uint32_t eR_reg;
+    if ((mR_full >> 47) & 1) {
+        mR_full >>= 1;
+        eR_reg = (eR + 1) & 0x1FF;
+    } else {
+        uint32_t zero_count = 0;
+        for (int i = 46; i >= 0; i--) {
+            if ((mR_full >> i) & 1) {
+                zero_count = 46 - i;
+                break;
+            }
+        }
+        mR_full = (mR_full << zero_count) & 0xFFFFFFFFFFFFull;
+        eR_reg = (eR - zero_count) & 0x1FF;
+    }
+
+    uint32_t mR;
+    if (((mR_rounded >> 23) & 1) && round_up) {
+        mR = 0;
+        eR_reg = (eR + 1) & 0x1FF;
+    } else {
+        mR = mR_rounded;
+    }
+
+    // flag_nx is registered in DONE from the normalised product's sticky bits
+    if (mR_full & 0x1FFFFF) *flags |= FP32_FLAG_NX;
+    return (sR << 31) | ((eR_reg & 0xFF) << 23) | (mR & 0x7FFFFF);
+}
+
+//==============================================================================
+// fpu_div
+//==============================================================================
+
+/**
+ * fpu_div: special cases in PREPARE, Q1.63 significands through divider64,
+ * then NORM and ROUND
+ * @param state - Registers carried over from the previous operation on
+ *                the same unit; zero them for a unit fresh out of reset
+ * @param frm - Rounding mode input; encodings above RMM do not round
+ */
+uint32_t rtl_fp32_div(rtl_fp32_div_state_t* state, uint32_t a, uint32_t b, int frm, uint32_t* flags) {
+    uint32_t ea = exp_of(a), eb = exp_of(b);
+    uint32_t ma = frac_of(a), mb = frac_of(b);
+    uint64_t ma_full = (ea == 0) ? ma : (0x800000u | ma);
+    uint64_t mb_full = (eb == 0) ? mb : (0x800000u | mb);
+    bool a_zero = (ea == 0) && (ma == 0), b_zero = (eb == 0) && (mb == 0);
+    bool a_inf = (ea == 255) && (ma == 0), b_inf = (eb == 255) && (mb == 0);
+    bool a_nan = (ea == 255) && (ma != 0), b_nan = (eb == 255) && (mb != 0);
+
+    // PREPARE: special results use s before this operation's sign lands in it
+    uint32_t s = state->s;
+    state->s = sign_of(a) ^ sign_of(b);
+    if (a_nan || b_nan || (a_zero && b_zero) || (a_inf && b_inf)) return 0x7FFFFFFFu;
+    if (a_zero || b_inf) return s << 31;
+    if (b_zero || a_inf) return (s << 31) | 0x7F800000u;
+
+    s = state->s;
+    uint64_t quotient = (ma_full << 39) / (mb_full << 39);
+    uint32_t e = (ea - eb + 127) & 0x1FF;
+    uint32_t m = state->m;
+
+    // NORM: m keeps its old value if the quotient has no leading one
+    if ((quotient >> 63) & 1) {
+        m = (uint32_t)(quotient >> 39) & 0x1FFFFFF;
+    } else if ((quotient >> 62) & 1) {
+        m = (uint32_t)(quotient >> 38) & 0x1FFFFFF;
+        e = (e - 1) & 0x1FF;
+    } else if ((quotient >> 61) & 1) {
+        m = (uint32_t)(quotient >> 37) & 0x1FFFFFF;
+        e = (e - 2) & 0x1FF;
+    } else {
+        for (int i = 60; i >= 0; i--) {
+            if ((quotient >> i) & 1) {
+                m = 0;
+                e = (e - (63 - i)) & 0x1FF;
+                break;
+            }
+        }
+    }
+
+    // ROUND
+    uint32_t guard = m & 1;
+    uint32_t sticky;
+    if ((quotient >> 63) & 1) sticky = (quotient & ((1ull << 39) - 1)) != 0;
+    else if ((quotient >> 62) & 1) sticky = (quotient & ((1ull << 38) - 1)) != 0;
+    else if ((quotient >> 61) & 1) sticky = (quotient & ((1ull << 37) - 1)) != 0;
+    else sticky = (quotient & ((1ull << 25) - 1)) != 0;
+    uint32_t tie = guard & !sticky & ((m >> 1) & 1);
+    uint32_t round_up;
+    switch (frm) {
+        case 0:  round_up = guard & (sticky | tie); break;
+        case 2:  round_up = s & (guard | sticky); break;
+        case 3:  round_up = !s && (guard | sticky); break;
+        case 4:  round_up = guard; break;
+        default: round_up = 0; break;
+    }
+    if (guard | sticky) *flags |= FP32_FLAG_NX;
+
+    // y is built from m and e before ROUND's own updates to them
+    uint32_t y;
+    if ((e & 0x100) || (e & 0xFF) >= 255) {
+        if (frm == 2) y = 0xFF800000u;
+        else if (frm == 3) y = 0x7F800000u;
+        else y = (s << 31) | 0x7F800000u;
+    } else if ((e & 0xFF) == 0) {
+        y = (s << 31) | (((m >> 1) & 0x7FFFFF) >> 1);
+    } else {
+        y = (s << 31) | ((e & 0xFF) << 23) | ((m >> 1) & 0x7FFFFF);
+    }
+
+    // The shift is assigned after the round-up increment, so it wins
+    if ((m >> 24) & 1) m >>= 1;
+    else m = ((((m >> 1) + round_up) & 0xFFFFFF) << 1) | (m & 1);
+    state->m = m;
+    return y;
+}
+
+//==============================================================================
+// floating_sqrt
+//==============================================================================
+
+/**
+ * sqrt #(WIDTH=24, FBITS=23): digit-by-digit fixed-point root, one result
+ * bit per iteration
+ */
+static uint32_t rtl_isqrt24(uint32_t rad) {
+    const int iterations = (24 + 23) >> 1;
+    uint32_t ac = rad >> 22;                    // 26 bits
+    uint32_t x = (rad << 2) & 0xFFFFFF;         // 24 bits
+    uint32_t q = 0;                             // 24 bits
+
+    for (int i = 0; i < iterations; i++) {
+        uint32_t test_res = (ac - ((q << 2) | 1)) & 0x3FFFFFF;
+        uint32_t ac_next;
+        if (!((test_res >> 25) & 1)) {
+            ac_next = ((test_res & 0xFFFFFF) << 2) | (x >> 22);
+            q = ((q << 1) | 1) & 0xFFFFFF;
+        } else {
+            ac_next = ((ac & 0xFFFFFF) << 2) | (x >> 22);
+            q = (q << 1) & 0xFFFFFF;
+        }
+        ac = ac_next;
+        x = (x << 2) & 0xFFFFFF;
+    }
+    return q;
+}
+
+/**
+ * floating_sqrt: exponent halved in PROCESS, significand root from sqrt,
+ * leading-zero normalisation with the exponent clamped to 254. The unit
+ * has no frm input and ties flag_nx low.
+ */
+uint32_t rtl_fp32_sqrt(uint32_t a, uint32_t* flags) {
+    (void)flags;
+    uint32_t exp = exp_of(a);
+    uint32_t mant = exp ? (0x800000u | frac_of(a)) : frac_of(a);
+    uint32_t unbiased_exp = (exp - 126) & 0x1FF;
+    uint32_t r_mant;
+
+    if (unbiased_exp & 1) {
+        unbiased_exp = ((unbiased_exp + 1) >> 1) & 0x1FF;
+        r_mant = mant >> 1;
+    } else {
+        unbiased_exp >>= 1;
+        r_mant = mant;
+    }
+    uint32_t r_exp = (unbiased_exp + 127) & 0x1FF;
+
+    uint32_t root = rtl_isqrt24(r_mant);
+    uint32_t zero_count = root ? __builtin_clz(root) - 8 : 24;
+    uint32_t sqrt_result_out = (root << zero_count) & 0xFFFFFF;
+    uint32_t r_exp_next = (r_exp - zero_count) & 0x1FF;
+    if ((r_exp_next & 0x100) || r_exp_next > 254) r_exp_next = 254;
+
+    return (sign_of(a) << 31) | ((r_exp_next & 0xFF) << 23) | (sqrt_result_out & 0x7FFFFF);
+}
+
+//==============================================================================
+// fpu_fma
+//==============================================================================
+
+/**
+ * fpu_fma: the fpu_mul result, negated for FNMSUB/FNMADD, goes through
+ * fpu_add_sub with c; both round with frm. flag_nx at FINISH is the
+ * adder's alone.
+ * @param opcode - RTL_FMA_* (ALUsel[2:1])
+ */
+uint32_t rtl_fp32_fma(uint32_t a, uint32_t b, uint32_t c, int opcode, int frm, uint32_t* flags) {
+    uint32_t mul_flags = 0;
+    uint32_t product = rtl_fp32_mul(a, b, frm, &mul_flags);
+
+    if (opcode == RTL_FMA_FNMSUB || opcode == RTL_FMA_FNMADD) product ^= 0x80000000u;
+    int sub = (opcode == RTL_FMA_FMSUB || opcode == RTL_FMA_FNMADD);
+    return rtl_fp32_add_sub(product, c, sub, frm, flags);
+}
+
+//==============================================================================
+// fpu_class
+//==============================================================================
+
+/**
+ * fpu_class: one-hot fclass mask from the exponent and fraction fields.
+ * A set fraction MSB selects bit 8, so quiet NaNs land on the signalling
+ * NaN bit and vice versa.
+ */
+uint32_t rtl_fp32_class(uint32_t a) {
+    uint32_t sign = sign_of(a);
+    uint32_t exp = exp_of(a);
+    uint32_t frac = frac_of(a);
+
+    if (exp == 0xFF) {
+        if (!frac) return 1u << (sign ? 0 : 7);
+        return 1u << ((frac >> 22) ? 8 : 9);
+    }
+    if (exp == 0) return 1u << (frac ? (sign ? 2 : 5) : (sign ? 3 : 4));
+    return 1u << (sign ? 1 : 6);
+}
+
+//==============================================================================
+// float_to_fixed
+//==============================================================================
+
+/**
+ * float_to_fixed: 24-bit significand shifted to the binary point, guard/
+ * round/sticky from the bits shifted out, then the sign applied. E is a
+ * 9-bit unsigned exp - 127, so the E >= 31 overflow test also rejects
+ * every input below 1.0 (zeros and subnormals included), and the
+ * $signed(E) < 0 branch is unreachable. The unit's invalid output is
+ * reported as FP32_FLAG_NV; int_out is 0 whenever it is set.
+ * @param is_unsigned - ~ALUsel[0] (fcvt.wu.s)
+ * @param frm - Rounding mode input; encodings above RMM truncate
+ */
+uint32_t rtl_fp32_to_int(uint32_t a, int is_unsigned, int frm, uint32_t* flags) {
+    uint32_t sign = sign_of(a);
+    uint32_t exp = exp_of(a);
+    uint32_t E = (exp - 127) & 0x1FF;
+    uint32_t mantissa = exp ? (0x800000u | frac_of(a)) : frac_of(a);
+
+    if (exp == 0xFF || E >= 31) {
+        *flags |= FP32_FLAG_NV;
+        return 0;
+    }
+
+    uint32_t shifted, guard = 0, round = 0, sticky = 0;
+    if (E >= 23) {
+        shifted = mantissa << (E - 23);
+    } else {
+        // shift_amount (1..23) is an initialised integer inside always_comb;
+        // it is taken as recomputed on every evaluation, as synthesis does
+        uint32_t shift_amount = 23 - E;
+        shifted = mantissa >> shift_amount;
+        guard = (mantissa >> (shift_amount - 1)) & 1;
+        round = shift_amount > 1 ? (mantissa >> (shift_amount - 2)) & 1 : 0;
+        sticky = shift_amount > 2 && (mantissa & ((1u << (shift_amount - 2)) - 1)) != 0;
+    }
+
+    uint32_t round_up;
+    switch (frm & 7) {
+        case FP32_RM_RNE: round_up = guard && (round || sticky || ((shifted & 1) && !sign)); break;
+        case FP32_RM_RDN: round_up = sign && (guard || round || sticky); break;
+        case FP32_RM_RUP: round_up = !sign && (guard || round || sticky); break;
+        case FP32_RM_RMM: round_up = guard; break;
+        default:          round_up = 0; break;
+    }
+    uint32_t pre_round = shifted + round_up;
+
+    if (is_unsigned) {
+        if (sign) {
+            *flags |= FP32_FLAG_NV;
+            return 0;
+        }
+        return pre_round;
+    }
+    return sign ? ~pre_round + 1 : pre_round;
+}
+
+//==============================================================================
+// fixedp2floatp_q32
+//==============================================================================
+
+/**
+ * fixedp2floatp_q32: magnitude normalised by its leading-zero count, top
+ * 24 bits kept with guard/round/sticky below. RNE takes mantissa_full[8]
+ * as the tie-breaking LSB, and any rounding increment that leaves bit 23
+ * set (all of them but the carry out of 24'hFFFFFF) shifts the significand
+ * right and bumps the exponent. f32_invalid, reported as FP32_FLAG_NV, is
+ * only raised for rounding modes above RMM; the exponent cannot overflow.
+ * @param is_signed - ALUsel[1] (fcvt.s.w)
+ */
+uint32_t rtl_fp32_from_int(uint32_t a, int is_signed, int frm, uint32_t* flags) {
+    uint32_t sign_bit = is_signed ? sign_of(a) : 0;
+    uint32_t pos = sign_bit ? ~a + 1 : a;
+
+    if (!pos) return 0;
+
+    uint32_t zero_count = __builtin_clz(pos);
+    uint32_t pre_mantissa = pos << zero_count;
+    uint32_t mantissa_full = pre_mantissa >> 8;
+    uint32_t guard = (pre_mantissa >> 7) & 1;
+    uint32_t round = (pre_mantissa >> 6) & 1;
+    uint32_t sticky = (pre_mantissa & 0x3F) != 0;
+    uint32_t exponent = 31 - zero_count + 127;
+
+    uint32_t round_up;
+    switch (frm & 7) {
+        case FP32_RM_RNE: round_up = guard && (round || sticky || ((mantissa_full >> 8) & 1)); break;
+        case FP32_RM_RTZ: round_up = 0; break;
+        case FP32_RM_RDN: round_up = sign_bit && (guard || round || sticky); break;
+        case FP32_RM_RUP: round_up = !sign_bit && (guard || round || sticky); break;
+        case FP32_RM_RMM: round_up = guard && (round || sticky); break;
+        default:
+            round_up = 0;
+            *flags |= FP32_FLAG_NV;
+            break;
+    }
+
+    uint32_t rounded_mantissa = (mantissa_full + round_up) & 0xFFFFFF;
+    if (((rounded_mantissa >> 23) & 1) && round_up) {
+        rounded_mantissa >>= 1;
+        exponent++;
+    }
+
+    return (sign_bit << 31) | ((exponent & 0xFF) << 23) | (rounded_mantissa & 0x7FFFFF);
+}
@@ -0,0 +1,48 @@
+/*******************************************************************************
+ * Bit-Accurate Models of the RTL FP32 Units
+ *
+ * Cycle-free C++ equivalents of fpu_add_sub, fpu_mul, fpu_div,
+ * floating_sqrt and fpu_fma, and of the combinational fpu_class,
+ * float_to_fixed and fixedp2floatp_q32: each function returns the result
+ * the unit presents, computed with the unit's own field widths, guard/
+ * round/sticky selection, normalisation and frm decoding. They model the
+ * RTL as written, not IEEE-754; compare them against fp32_ref.h to find
+ * where the RTL departs from the standard without simulating the core.
+ *
+ * The arithmetic units only produce an inexact flag, reported as
+ * FP32_FLAG_NX; the conversion units' invalid outputs (left unconnected
+ * in fpu_alu) are reported as FP32_FLAG_NV.
+ ******************************************************************************/
+
+#ifndef RTL_FP32_H
+#define RTL_FP32_H
+
+#include <cstdint>
+
+// fpu_fma opcode input (ALUsel[2:1])
+#define RTL_FMA_FMADD  0   //  a*b + c
+#define RTL_FMA_FMSUB  1   //  a*b - c
+#define RTL_FMA_FNMSUB 2   // -a*b + c
+#define RTL_FMA_FNMADD 3   // -a*b - c
+
+// fpu_div registers that keep their value from one operation to the next
+typedef struct {
+    uint32_t m;     // 25-bit mantissa register, only loaded when the quotient has a leading one
+    uint32_t s;     // Sign register, read by the special-case results before it is updated
+} rtl_fp32_div_state_t;
+
+// The arithmetic functions OR FP32_FLAG_NX into *flags when the unit's nx output is set
+uint32_t rtl_fp32_add_sub(uint32_t a, uint32_t b, int sub, int frm, uint32_t* flags);
+uint32_t rtl_fp32_mul(uint32_t a, uint32_t b, int frm, uint32_t* flags);
+uint32_t rtl_fp32_div(rtl_fp32_div_state_t* state, uint32_t a, uint32_t b, int frm, uint32_t* flags);
+uint32_t rtl_fp32_sqrt(uint32_t a, uint32_t* flags);
+uint32_t rtl_fp32_fma(uint32_t a, uint32_t b, uint32_t c, int opcode, int frm, uint32_t* flags);
+
+// fclass.s mask; fpu_class has no flags
+uint32_t rtl_fp32_class(uint32_t a);
+
+// fcvt.w[u].s and fcvt.s.w[u]; these OR FP32_FLAG_NV into *flags when invalid is set
+uint32_t rtl_fp32_to_int(uint32_t a, int is_unsigned, int frm, uint32_t* flags);
+uint32_t rtl_fp32_from_int(uint32_t a, int is_signed, int frm, uint32_t* flags);
+
+#endif // RTL_FP32_H
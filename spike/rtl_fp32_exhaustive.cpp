@@ -0,0 +1,515 @@
+/*******************************************************************************
+ * Exhaustive RTL FP32 Unary Sweep
+ *
+ * Runs every 32-bit input through the single-operand units modelled in
+ * rtl_fp32.cpp (floating_sqrt, fpu_class, float_to_fixed and
+ * fixedp2floatp_q32) and through the reference engine, once per rounding
+ * mode, and compares result bits and the one flag each unit produces.
+ *
+ * The input space is cut into 64K-input blocks. Each worker starts on its
+ * own contiguous run of blocks and, once that is drained, steals the upper
+ * half of the largest run left, so slow regions (the sqrt model's loop,
+ * soft-float NaN handling) do not leave cores idle at the end. A block is
+ * evaluated for every selected check before moving on, so inputs are
+ * generated once and stay in cache. fsqrt.s references come from
+ * fp32_batch_eval (AVX2); mismatch detection compares eight lanes at a time.
+ *
+ * One JSON object per operation and rounding mode goes to stdout:
+ *
+ *   {"op":"fcvt.w.s","rm":"rne","inputs":4294967296,"result_mismatches":1065353216,
+ *    "flag":"nv","flag_mismatches":1065353216,"ranges":"00000000-3f7fffff,80000000-bf7fffff"}
+ *
+ * "ranges" lists the inputs that failed, rounded out to 2^23-input slices
+ * (one sign/exponent value for FP inputs) and merged when adjacent. It is
+ * followed by a summary line with the run time; the lowest failing inputs
+ * of each check go to stderr.
+ *
+ * Usage: rtl_fp32_exhaustive [-o ops] [-r modes] [-f first] [-l last] [-j threads] [-e examples]
+ *   -o  Comma-separated subset of sqrt,class,cvt.w.s,cvt.wu.s,cvt.s.w,cvt.s.wu
+ *   -r  Rounding modes as digits (default 01234; fclass.s ignores them)
+ *   -f  First input, hex (default 0)
+ *   -l  Last input, hex (default ffffffff)
+ *   -j  Worker threads (default: all host cores)
+ *   -e  Failing inputs printed per operation and mode (default 5)
+ *
+ * Compile (from spike/, with bench/svdpi.h for fp32_batch.cpp):
+ *   g++ -O2 -std=c++17 -o rtl_fp32_exhaustive rtl_fp32_exhaustive.cpp rtl_fp32.cpp \
+ *       fp32_ref.cpp fp32_batch.cpp -Ibench -pthread
+ ******************************************************************************/
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include <immintrin.h>
+
+#include "rtl_fp32.h"
+#include "fp32_ref.h"
+#include "fp32_batch.h"
+
+#define EX_BLOCK_BITS 16
+#define EX_BLOCK (1u << EX_BLOCK_BITS)     // Inputs per block
+#define EX_RANGE_BITS 23                    // Granularity of the "ranges" report
+#define EX_RANGES (1u << (32 - EX_RANGE_BITS))
+
+// Operations
+#define EX_SQRT     0
+#define EX_CLASS    1
+#define EX_CVT_W_S  2
+#define EX_CVT_WU_S 3
+#define EX_CVT_S_W  4
+#define EX_CVT_S_WU 5
+
+typedef struct {
+    const char* name;           // -o name
+    const char* mnemonic;
+    int kind;                   // EX_*
+    uint8_t flag;               // The flag the unit produces (FP32_FLAG_*), 0 for none
+    const char* flag_name;
+    bool rounds;                // Result depends on the rounding mode
+} ex_op_t;
+
+static const ex_op_t k_ops[] = {
+    {"sqrt",     "fsqrt.s",   EX_SQRT,     FP32_FLAG_NX, "nx",   true},
+    {"class",    "fclass.s",  EX_CLASS,    0,            "none", false},
+    {"cvt.w.s",  "fcvt.w.s",  EX_CVT_W_S,  FP32_FLAG_NV, "nv",   true},
+    {"cvt.wu.s", "fcvt.wu.s", EX_CVT_WU_S, FP32_FLAG_NV, "nv",   true},
+    {"cvt.s.w",  "fcvt.s.w",  EX_CVT_S_W,  FP32_FLAG_NV, "nv",   true},
+    {"cvt.s.wu", "fcvt.s.wu", EX_CVT_S_WU, FP32_FLAG_NV, "nv",   true},
+};
+
+static const char* const k_rm_names[] = {"rne", "rtz", "rdn", "rup", "rmm"};
+
+// One operation in one rounding mode
+typedef struct {
+    int op;                     // Index into k_ops
+    int rm;                     // FP32_RM_*, or -1 when the operation does not round
+} ex_check_t;
+
+typedef struct {
+    std::vector<int> ops;
+    std::vector<int> modes;
+    uint64_t first;
+    uint64_t last;
+    int threads;
+    int examples;
+} ex_config_t;
+
+// Totals for one check, kept per worker and merged at the end
+typedef struct {
+    uint64_t result_mismatches;
+    uint64_t flag_mismatches;
+    std::vector<uint64_t> ranges;       // Failing inputs per 2^EX_RANGE_BITS slice
+    std::vector<uint32_t> examples;     // Lowest failing inputs, ascending
+} ex_tally_t;
+
+//==============================================================================
+// Work Stealing
+//==============================================================================
+
+// A worker's run of blocks [next, end)
+typedef struct {
+    std::mutex lock;
+    uint64_t next;
+    uint64_t end;
+} ex_queue_t;
+
+/**
+ * Claim the next block, from the worker's own run or else by stealing the
+ * upper half of the largest run another worker has left
+ * @return false once every run is empty
+ */
+static bool claim_block(std::vector<ex_queue_t>& queues, int self, uint64_t* block) {
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> guard(queues[self].lock);
+            if (queues[self].next < queues[self].end) {
+                *block = queues[self].next++;
+                return true;
+            }
+        }
+
+        int victim = -1;
+        uint64_t most = 0;
+        for (int t = 0; t < (int)queues.size(); t++) {
+            if (t == self) continue;
+            std::lock_guard<std::mutex> guard(queues[t].lock);
+            if (queues[t].end - queues[t].next > most) {
+                most = queues[t].end - queues[t].next;
+                victim = t;
+            }
+        }
+        if (victim < 0) return false;
+
+        uint64_t start, end;
+        {
+            std::lock_guard<std::mutex> guard(queues[victim].lock);
+            uint64_t left = queues[victim].end - queues[victim].next;
+            if (left == 0) continue;        // Drained meanwhile; look again
+            end = queues[victim].end;
+            start = end - (left + 1) / 2;
+            queues[victim].end = start;
+        }
+        std::lock_guard<std::mutex> guard(queues[self].lock);
+        queues[self].next = start;
+        queues[self].end = end;
+    }
+}
+
+//==============================================================================
+// Evaluation
+//==============================================================================
+
+static uint32_t eval_model(int kind, int rm, uint32_t a, uint32_t* flags) {
+    switch (kind) {
+        case EX_SQRT:     return rtl_fp32_sqrt(a, flags);
+        case EX_CLASS:    return rtl_fp32_class(a);
+        case EX_CVT_W_S:  return rtl_fp32_to_int(a, 0, rm, flags);
+        case EX_CVT_WU_S: return rtl_fp32_to_int(a, 1, rm, flags);
+        case EX_CVT_S_W:  return rtl_fp32_from_int(a, 1, rm, flags);
+        default:          return rtl_fp32_from_int(a, 0, rm, flags);
+    }
+}
+
+static uint32_t eval_reference(int kind, int rm, uint32_t a, uint32_t* flags) {
+    switch (kind) {
+        case EX_SQRT:     return fp32_sqrt(a, rm, flags);
+        case EX_CLASS:    return fp32_classify(a);
+        case EX_CVT_W_S:  return fp32_to_i32(a, rm, flags);
+        case EX_CVT_WU_S: return fp32_to_u32(a, rm, flags);
+        case EX_CVT_S_W:  return fp32_from_i32(a, rm, flags);
+        default:          return fp32_from_u32(a, rm, flags);
+    }
+}
+
+/**
+ * Mismatch bitmaps for one block, one bit per lane
+ * @param flag - Flag bit compared alongside the result, 0 for none
+ */
+__attribute__((target("avx2")))
+static void compare_vector(const uint32_t* model, const uint32_t* ref, const uint8_t* model_flags,
+                           const uint8_t* ref_flags, uint8_t flag, size_t n,
+                           uint64_t* result_bad, uint64_t* flag_bad) {
+    const __m256i flag_mask = _mm256_set1_epi8((char)flag);
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (size_t i = 0; i < n; i += 64) {
+        uint64_t r = 0, f = 0;
+        for (int j = 0; j < 64; j += 8) {
+            __m256i vm = _mm256_loadu_si256((const __m256i*)(model + i + j));
+            __m256i vr = _mm256_loadu_si256((const __m256i*)(ref + i + j));
+            __m256i eq = _mm256_cmpeq_epi32(vm, vr);
+            r |= (uint64_t)(~(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(eq)) & 0xFF) << j;
+        }
+        for (int j = 0; j < 64; j += 32) {
+            __m256i fm = _mm256_loadu_si256((const __m256i*)(model_flags + i + j));
+            __m256i fr = _mm256_loadu_si256((const __m256i*)(ref_flags + i + j));
+            __m256i diff = _mm256_and_si256(_mm256_xor_si256(fm, fr), flag_mask);
+            uint32_t same = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(diff, zero));
+            f |= (uint64_t)~same << j;
+        }
+        result_bad[i / 64] = r;
+        flag_bad[i / 64] = f;
+    }
+}
+
+static void compare_scalar(const uint32_t* model, const uint32_t* ref, const uint8_t* model_flags,
+                           const uint8_t* ref_flags, uint8_t flag, size_t n,
+                           uint64_t* result_bad, uint64_t* flag_bad) {
+    for (size_t i = 0; i < n; i += 64) {
+        uint64_t r = 0, f = 0;
+        for (int j = 0; j < 64; j++) {
+            r |= (uint64_t)(model[i + j] != ref[i + j]) << j;
+            f |= (uint64_t)(((model_flags[i + j] ^ ref_flags[i + j]) & flag) != 0) << j;
+        }
+        result_bad[i / 64] = r;
+        flag_bad[i / 64] = f;
+    }
+}
+
+// Per-worker buffers for one block
+typedef struct {
+    std::vector<uint32_t> input, model, ref;
+    std::vector<uint8_t> model_flags, ref_flags;
+    std::vector<uint64_t> result_bad, flag_bad;
+} ex_buffers_t;
+
+/**
+ * Run every check over inputs [base, base + n); n is a multiple of 64
+ * except at the end of a custom -l range, where the tail lanes are masked
+ */
+static void sweep_block(const ex_config_t& config, const std::vector<ex_check_t>& checks,
+                        uint64_t base, size_t n, ex_buffers_t& buf, std::vector<ex_tally_t>& tallies) {
+    static const bool have_avx2 = __builtin_cpu_supports("avx2");
+    size_t lanes = (n + 63) & ~(size_t)63;
+    uint64_t live_tail = (n % 64) ? (1ull << (n % 64)) - 1 : ~0ull;
+    int model_cached = -1;      // Op whose model results (rounding-independent) are in buf.model
+
+    for (size_t i = 0; i < lanes; i++) buf.input[i] = (uint32_t)(base + std::min(i, n - 1));
+
+    for (size_t c = 0; c < checks.size(); c++) {
+        const ex_op_t& op = k_ops[checks[c].op];
+        int rm = checks[c].rm < 0 ? FP32_RM_RNE : checks[c].rm;
+        const uint32_t* in = buf.input.data();
+
+        if (op.kind == EX_SQRT) {
+            // floating_sqrt has no frm input: one model pass serves every mode
+            if (model_cached != checks[c].op) {
+                for (size_t i = 0; i < lanes; i++) {
+                    uint32_t flags = 0;
+                    buf.model[i] = rtl_fp32_sqrt(in[i], &flags);
+                    buf.model_flags[i] = (uint8_t)flags;
+                }
+                model_cached = checks[c].op;
+            }
+            fp32_batch_eval(FP32_BATCH_SQRT, rm, in, nullptr, nullptr, buf.ref.data(),
+                            buf.ref_flags.data(), lanes);
+        } else {
+            for (size_t i = 0; i < lanes; i++) {
+                uint32_t model_flags = 0, ref_flags = 0;
+                buf.model[i] = eval_model(op.kind, rm, in[i], &model_flags);
+                buf.ref[i] = eval_reference(op.kind, rm, in[i], &ref_flags);
+                buf.model_flags[i] = (uint8_t)model_flags;
+                buf.ref_flags[i] = (uint8_t)ref_flags;
+            }
+            model_cached = -1;
+        }
+
+        if (have_avx2) {
+            compare_vector(buf.model.data(), buf.ref.data(), buf.model_flags.data(),
+                           buf.ref_flags.data(), op.flag, lanes, buf.result_bad.data(), buf.flag_bad.data());
+        } else {
+            compare_scalar(buf.model.data(), buf.ref.data(), buf.model_flags.data(),
+                           buf.ref_flags.data(), op.flag, lanes, buf.result_bad.data(), buf.flag_bad.data());
+        }
+
+        ex_tally_t& tally = tallies[c];
+        size_t words = lanes / 64;
+        buf.result_bad[words - 1] &= live_tail;
+        buf.flag_bad[words - 1] &= live_tail;
+
+        uint64_t failed = 0;
+        for (size_t w = 0; w < words; w++) {
+            uint64_t bad = buf.result_bad[w] | buf.flag_bad[w];
+            tally.result_mismatches += __builtin_popcountll(buf.result_bad[w]);
+            tally.flag_mismatches += __builtin_popcountll(buf.flag_bad[w]);
+            failed += __builtin_popcountll(bad);
+
+            // Lanes arrive in ascending order, so only the first few can
+            // displace a stored example
+            while (bad && (int)tally.examples.size() < config.examples) {
+                tally.examples.push_back((uint32_t)(base + w * 64 + __builtin_ctzll(bad)));
+                bad &= bad - 1;
+            }
+            if (bad && config.examples > 0 && base + w * 64 < tally.examples.back()) {
+                for (; bad; bad &= bad - 1) {
+                    uint32_t input = (uint32_t)(base + w * 64 + __builtin_ctzll(bad));
+                    if (input >= tally.examples.back()) break;
+                    tally.examples.back() = input;
+                    std::sort(tally.examples.begin(), tally.examples.end());
+                }
+            }
+        }
+        // A block never straddles a range slice
+        tally.ranges[base >> EX_RANGE_BITS] += failed;
+    }
+}
+
+//==============================================================================
+// Main
+//==============================================================================
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s [-o ops] [-r modes] [-f first] [-l last] [-j threads] [-e examples]\n",
+            argv0);
+}
+
+/**
+ * Parse a comma-separated list of operation names
+ * @return false if a name is unknown
+ */
+static bool parse_ops(const char* list, std::vector<int>& ops) {
+    std::string s(list);
+    size_t start = 0;
+
+    ops.clear();
+    while (start <= s.size()) {
+        size_t end = s.find(',', start);
+        if (end == std::string::npos) end = s.size();
+        std::string name = s.substr(start, end - start);
+        int found = -1;
+        for (int i = 0; i < (int)(sizeof(k_ops) / sizeof(k_ops[0])); i++) {
+            if (name == k_ops[i].name) found = i;
+        }
+        if (found < 0) return false;
+        ops.push_back(found);
+        start = end + 1;
+    }
+    return true;
+}
+
+/**
+ * Failing slices as merged hex input ranges, e.g. "00000000-3f7fffff,ff800000-ffffffff"
+ */
+static std::string format_ranges(const std::vector<uint64_t>& ranges) {
+    std::string out;
+    char text[32];
+
+    for (uint32_t s = 0; s < EX_RANGES; s++) {
+        if (!ranges[s]) continue;
+        uint32_t e = s;
+        while (e + 1 < EX_RANGES && ranges[e + 1]) e++;
+        snprintf(text, sizeof(text), "%s%08x-%08x", out.empty() ? "" : ",",
+                 s << EX_RANGE_BITS, ((e + 1) << EX_RANGE_BITS) - 1);
+        out += text;
+        s = e;
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    ex_config_t config;
+    config.first = 0;
+    config.last = 0xFFFFFFFFull;
+    config.threads = (int)std::thread::hardware_concurrency();
+    config.examples = 5;
+    for (int i = 0; i < (int)(sizeof(k_ops) / sizeof(k_ops[0])); i++) config.ops.push_back(i);
+    for (int rm = FP32_RM_RNE; rm <= FP32_RM_RMM; rm++) config.modes.push_back(rm);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:r:f:l:j:e:h")) != -1) {
+        switch (opt) {
+            case 'o':
+                if (!parse_ops(optarg, config.ops)) {
+                    fprintf(stderr, "Unknown operation in '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'r':
+                config.modes.clear();
+                for (const char* p = optarg; *p; p++) {
+                    if (*p < '0' || *p > '4') {
+                        fprintf(stderr, "Rounding modes are digits 0-4\n");
+                        return 2;
+                    }
+                    config.modes.push_back(*p - '0');
+                }
+                break;
+            case 'f':
+                config.first = strtoull(optarg, nullptr, 16) & 0xFFFFFFFFull;
+                break;
+            case 'l':
+                config.last = strtoull(optarg, nullptr, 16) & 0xFFFFFFFFull;
+                break;
+            case 'j':
+                config.threads = atoi(optarg);
+                break;
+            case 'e':
+                config.examples = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (config.threads < 1) config.threads = 1;
+    if (config.examples < 0) config.examples = 0;
+    if (config.last < config.first || config.modes.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<ex_check_t> checks;
+    for (int op_index : config.ops) {
+        if (!k_ops[op_index].rounds) {
+            checks.push_back({op_index, -1});
+            continue;
+        }
+        for (int rm : config.modes) checks.push_back({op_index, rm});
+    }
+
+    // Blocks are aligned to EX_BLOCK; the first and last may be partial
+    uint64_t first_block = config.first >> EX_BLOCK_BITS;
+    uint64_t blocks = (config.last >> EX_BLOCK_BITS) - first_block + 1;
+    int threads = (int)std::min<uint64_t>(config.threads, blocks);
+    std::vector<ex_queue_t> queues(threads);
+    for (int t = 0; t < threads; t++) {
+        queues[t].next = blocks * t / threads;
+        queues[t].end = blocks * (t + 1) / threads;
+    }
+
+    ex_tally_t empty = {0, 0, std::vector<uint64_t>(EX_RANGES, 0), {}};
+    std::vector<ex_tally_t> totals(checks.size(), empty);
+    std::mutex totals_lock;
+
+    auto worker = [&](int self) {
+        ex_buffers_t buf;
+        buf.input.resize(EX_BLOCK);
+        buf.model.resize(EX_BLOCK);
+        buf.ref.resize(EX_BLOCK);
+        buf.model_flags.resize(EX_BLOCK);
+        buf.ref_flags.resize(EX_BLOCK);
+        buf.result_bad.resize(EX_BLOCK / 64);
+        buf.flag_bad.resize(EX_BLOCK / 64);
+        std::vector<ex_tally_t> tallies(checks.size(), empty);
+
+        for (uint64_t block; claim_block(queues, self, &block);) {
+            uint64_t base = (first_block + block) << EX_BLOCK_BITS;
+            uint64_t lo = std::max(base, config.first);
+            uint64_t hi = std::min(base + EX_BLOCK - 1, config.last);
+            sweep_block(config, checks, lo, (size_t)(hi - lo + 1), buf, tallies);
+        }
+
+        std::lock_guard<std::mutex> guard(totals_lock);
+        for (size_t c = 0; c < checks.size(); c++) {
+            ex_tally_t& total = totals[c];
+            total.result_mismatches += tallies[c].result_mismatches;
+            total.flag_mismatches += tallies[c].flag_mismatches;
+            for (uint32_t s = 0; s < EX_RANGES; s++) total.ranges[s] += tallies[c].ranges[s];
+            total.examples.insert(total.examples.end(), tallies[c].examples.begin(),
+                                  tallies[c].examples.end());
+            std::sort(total.examples.begin(), total.examples.end());
+            if ((int)total.examples.size() > config.examples) total.examples.resize(config.examples);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) pool.emplace_back(worker, t);
+    for (auto& thread : pool) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t inputs = config.last - config.first + 1;
+    uint64_t failures = 0;
+    for (size_t c = 0; c < checks.size(); c++) {
+        const ex_op_t& op = k_ops[checks[c].op];
+        int rm = checks[c].rm;
+        const ex_tally_t& total = totals[c];
+
+        printf("{\"op\":\"%s\",\"rm\":\"%s\",\"inputs\":%llu,\"result_mismatches\":%llu,"
+               "\"flag\":\"%s\",\"flag_mismatches\":%llu,\"ranges\":\"%s\"}\n",
+               op.mnemonic, rm < 0 ? "none" : k_rm_names[rm], (unsigned long long)inputs,
+               (unsigned long long)total.result_mismatches, op.flag_name,
+               (unsigned long long)total.flag_mismatches, format_ranges(total.ranges).c_str());
+        failures += total.result_mismatches + total.flag_mismatches;
+
+        for (uint32_t a : total.examples) {
+            uint32_t model_flags = 0, ref_flags = 0;
+            uint32_t model = eval_model(op.kind, rm < 0 ? FP32_RM_RNE : rm, a, &model_flags);
+            uint32_t ref = eval_reference(op.kind, rm < 0 ? FP32_RM_RNE : rm, a, &ref_flags);
+            fprintf(stderr, "%s %s a=0x%08x: rtl 0x%08x %s=%u, reference 0x%08x %s=%u\n",
+                    op.mnemonic, rm < 0 ? "none" : k_rm_names[rm], a, model, op.flag_name,
+                    (model_flags & op.flag) ? 1 : 0, ref, op.flag_name, (ref_flags & op.flag) ? 1 : 0);
+        }
+    }
+    printf("{\"inputs\":%llu,\"checks\":%zu,\"threads\":%d,\"seconds\":%.1f}\n",
+           (unsigned long long)inputs, checks.size(), threads, seconds);
+    return failures ? 1 : 0;
+}
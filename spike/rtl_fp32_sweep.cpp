@@ -0,0 +1,323 @@
+/*******************************************************************************
+ * RTL FP32 Unit Sweep
+ *
+ * Pushes random and edge-case operands through the unit models in
+ * rtl_fp32.cpp and compares the result bits and the inexact flag with the
+ * reference engine (fp32_batch_eval, bit-identical to fp32_ref). Blocks of
+ * operands are spread over all host cores; operands depend only on the
+ * seed and the block number, so a run reproduces with any thread count.
+ *
+ * One JSON object per operation and rounding mode goes to stdout:
+ *
+ *   {"op":"fadd.s","rm":"rne","count":100000000,"result_mismatches":812,
+ *    "nx_mismatches":0,"ns_per_op":1.92}
+ *
+ * and the first failing operands of each to stderr.
+ *
+ * Usage: rtl_fp32_sweep [-n count] [-o ops] [-r modes] [-j threads] [-s seed] [-e examples]
+ *   -n  Operations per operation and rounding mode (default 1e8)
+ *   -o  Comma-separated subset of add,sub,mul,div,sqrt,fmadd,fmsub,fnmsub,fnmadd
+ *   -r  Rounding modes as digits (default 01234)
+ *   -j  Worker threads (default: all host cores)
+ *   -s  Random seed (default 1)
+ *   -e  Failing operands printed per operation and mode (default 5)
+ *
+ * Compile (from spike/, with bench/svdpi.h for fp32_batch.cpp):
+ *   g++ -O2 -std=c++17 -o rtl_fp32_sweep rtl_fp32_sweep.cpp rtl_fp32.cpp \
+ *       fp32_ref.cpp fp32_batch.cpp -Ibench -pthread
+ ******************************************************************************/
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+
+#include "rtl_fp32.h"
+#include "fp32_ref.h"
+#include "fp32_batch.h"
+
+#define SWEEP_BLOCK 4096        // Operands per work item
+
+typedef struct {
+    const char* name;           // -o name
+    const char* mnemonic;
+    int batch_op;               // FP32_BATCH_*
+    int operands;
+} sweep_op_t;
+
+static const sweep_op_t k_ops[] = {
+    {"add",    "fadd.s",   FP32_BATCH_ADD,    2},
+    {"sub",    "fsub.s",   FP32_BATCH_SUB,    2},
+    {"mul",    "fmul.s",   FP32_BATCH_MUL,    2},
+    {"div",    "fdiv.s",   FP32_BATCH_DIV,    2},
+    {"sqrt",   "fsqrt.s",  FP32_BATCH_SQRT,   1},
+    {"fmadd",  "fmadd.s",  FP32_BATCH_FMADD,  3},
+    {"fmsub",  "fmsub.s",  FP32_BATCH_FMSUB,  3},
+    {"fnmsub", "fnmsub.s", FP32_BATCH_FNMSUB, 3},
+    {"fnmadd", "fnmadd.s", FP32_BATCH_FNMADD, 3},
+};
+
+static const char* const k_rm_names[] = {"rne", "rtz", "rdn", "rup", "rmm"};
+
+typedef struct {
+    uint64_t count;
+    std::vector<int> ops;       // Indices into k_ops
+    std::vector<int> modes;
+    int threads;
+    uint64_t seed;
+    int examples;
+} sweep_config_t;
+
+// Totals for one operation and rounding mode
+typedef struct {
+    std::atomic<uint64_t> result_mismatches{0};
+    std::atomic<uint64_t> nx_mismatches{0};
+    std::atomic<int> printed{0};
+    std::mutex print_lock;
+} sweep_totals_t;
+
+//==============================================================================
+// Operand Generation
+//==============================================================================
+
+// splitmix64: cheap to seed per block, so blocks are independent of threads
+typedef struct {
+    uint64_t state;
+} sweep_rng_t;
+
+static inline uint64_t next_u64(sweep_rng_t* rng) {
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/**
+ * One operand: IEEE special classes and the boundaries of the normal range
+ * about a third of the time, otherwise a random normal number
+ */
+static uint32_t random_operand(sweep_rng_t* rng) {
+    uint64_t r = next_u64(rng);
+    uint32_t sign = (uint32_t)(r >> 63) << 31;
+    uint32_t frac = (uint32_t)(r >> 8) & 0x7FFFFF;
+
+    switch (r & 15) {
+        case 0:  return sign;                                           // +-0
+        case 1:  return sign | frac;                                    // Subnormal
+        case 2:  return sign | 0x7F800000u;                             // +-Inf
+        case 3:  return sign | 0x7F800000u | frac | ((r >> 4) & 1);     // NaN
+        case 4:  return sign | (((r >> 4) & 1) ? 0x7F000000u : 0x00800000u) | frac;  // Extreme exponents
+        case 5:  return sign | ((126 + (uint32_t)((r >> 32) % 3)) << 23) | (frac & 0x7F0000);  // Few bits near 1.0
+        default: return sign | ((1 + (uint32_t)((r >> 32) % 254)) << 23) | frac;
+    }
+}
+
+/**
+ * A second operand close to the first a quarter of the time: same or
+ * nearby exponent and a few flipped low bits, for cancellation, alignment
+ * and rounding ties
+ */
+static uint32_t related_operand(sweep_rng_t* rng, uint32_t a) {
+    uint64_t r = next_u64(rng);
+    if ((r & 3) != 0) return random_operand(rng);
+
+    int exp = (int)((a >> 23) & 0xFF) - (int)((r >> 2) % 27);
+    if (exp < 1) exp = 1;
+    uint32_t flip = (uint32_t)(r >> 16) & ((1u << ((r >> 8) % 24)) - 1);
+    uint32_t sign = ((r >> 40) & 1) << 31;
+    return (a & 0x80000000u) ^ sign ^ (((uint32_t)exp << 23) | ((a ^ flip) & 0x7FFFFF));
+}
+
+//==============================================================================
+// Sweep
+//==============================================================================
+
+static uint32_t eval_model(const sweep_op_t& op, int rm, rtl_fp32_div_state_t* div_state,
+                           uint32_t a, uint32_t b, uint32_t c, uint32_t* flags) {
+    switch (op.batch_op) {
+        case FP32_BATCH_ADD:    return rtl_fp32_add_sub(a, b, 0, rm, flags);
+        case FP32_BATCH_SUB:    return rtl_fp32_add_sub(a, b, 1, rm, flags);
+        case FP32_BATCH_MUL:    return rtl_fp32_mul(a, b, rm, flags);
+        case FP32_BATCH_DIV:    return rtl_fp32_div(div_state, a, b, rm, flags);
+        case FP32_BATCH_SQRT:   return rtl_fp32_sqrt(a, flags);
+        case FP32_BATCH_FMADD:  return rtl_fp32_fma(a, b, c, RTL_FMA_FMADD, rm, flags);
+        case FP32_BATCH_FMSUB:  return rtl_fp32_fma(a, b, c, RTL_FMA_FMSUB, rm, flags);
+        case FP32_BATCH_FNMSUB: return rtl_fp32_fma(a, b, c, RTL_FMA_FNMSUB, rm, flags);
+        default:                return rtl_fp32_fma(a, b, c, RTL_FMA_FNMADD, rm, flags);
+    }
+}
+
+/**
+ * Sweep one operation and rounding mode
+ * @param job - Index of the (operation, mode) pair, mixed into the seed
+ */
+static void sweep(const sweep_config_t& config, const sweep_op_t& op, int rm, uint64_t job,
+                  sweep_totals_t& totals) {
+    uint64_t blocks = (config.count + SWEEP_BLOCK - 1) / SWEEP_BLOCK;
+    std::atomic<uint64_t> next_block{0};
+
+    auto worker = [&]() {
+        std::vector<uint32_t> a(SWEEP_BLOCK), b(SWEEP_BLOCK), c(SWEEP_BLOCK), ref(SWEEP_BLOCK);
+        std::vector<uint8_t> ref_flags(SWEEP_BLOCK);
+        uint64_t result_mismatches = 0, nx_mismatches = 0;
+
+        for (uint64_t block; (block = next_block.fetch_add(1)) < blocks;) {
+            // The divider reads registers the previous division left, so
+            // each block starts from reset whichever worker claims it
+            rtl_fp32_div_state_t div_state = {0, 0};
+            sweep_rng_t rng = {config.seed ^ (job << 56) ^ (block * 0xD1B54A32D192ED03ull)};
+            size_t n = (size_t)std::min<uint64_t>(SWEEP_BLOCK, config.count - block * SWEEP_BLOCK);
+
+            for (size_t i = 0; i < n; i++) {
+                a[i] = random_operand(&rng);
+                b[i] = related_operand(&rng, a[i]);
+                c[i] = related_operand(&rng, a[i]);
+            }
+            fp32_batch_eval(op.batch_op, rm, a.data(), b.data(), c.data(), ref.data(), ref_flags.data(), n);
+
+            for (size_t i = 0; i < n; i++) {
+                uint32_t flags = 0;
+                uint32_t result = eval_model(op, rm, &div_state, a[i], b[i], c[i], &flags);
+                bool result_bad = result != ref[i];
+                bool nx_bad = (flags & FP32_FLAG_NX) != (ref_flags[i] & FP32_FLAG_NX);
+                if (!result_bad && !nx_bad) continue;
+
+                result_mismatches += result_bad;
+                nx_mismatches += nx_bad;
+                if (totals.printed.load(std::memory_order_relaxed) >= config.examples) continue;
+
+                std::lock_guard<std::mutex> guard(totals.print_lock);
+                if (totals.printed >= config.examples) continue;
+                totals.printed++;
+                fprintf(stderr, "%s %s a=0x%08x", op.mnemonic, k_rm_names[rm], a[i]);
+                if (op.operands > 1) fprintf(stderr, " b=0x%08x", b[i]);
+                if (op.operands > 2) fprintf(stderr, " c=0x%08x", c[i]);
+                fprintf(stderr, ": rtl 0x%08x nx=%u, reference 0x%08x nx=%u\n",
+                        result, (flags & FP32_FLAG_NX) ? 1 : 0, ref[i],
+                        (ref_flags[i] & FP32_FLAG_NX) ? 1 : 0);
+            }
+        }
+
+        totals.result_mismatches += result_mismatches;
+        totals.nx_mismatches += nx_mismatches;
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < config.threads; t++) pool.emplace_back(worker);
+    for (auto& thread : pool) thread.join();
+}
+
+//==============================================================================
+// Main
+//==============================================================================
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s [-n count] [-o ops] [-r modes] [-j threads] [-s seed] [-e examples]\n",
+            argv0);
+}
+
+/**
+ * Parse a comma-separated list of operation names
+ * @return false if a name is unknown
+ */
+static bool parse_ops(const char* list, std::vector<int>& ops) {
+    std::string s(list);
+    size_t start = 0;
+
+    ops.clear();
+    while (start <= s.size()) {
+        size_t end = s.find(',', start);
+        if (end == std::string::npos) end = s.size();
+        std::string name = s.substr(start, end - start);
+        int found = -1;
+        for (int i = 0; i < (int)(sizeof(k_ops) / sizeof(k_ops[0])); i++) {
+            if (name == k_ops[i].name) found = i;
+        }
+        if (found < 0) return false;
+        ops.push_back(found);
+        start = end + 1;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    sweep_config_t config;
+    config.count = 100000000;
+    config.threads = (int)std::thread::hardware_concurrency();
+    config.seed = 1;
+    config.examples = 5;
+    for (int i = 0; i < (int)(sizeof(k_ops) / sizeof(k_ops[0])); i++) config.ops.push_back(i);
+    for (int rm = FP32_RM_RNE; rm <= FP32_RM_RMM; rm++) config.modes.push_back(rm);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:o:r:j:s:e:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                config.count = (uint64_t)strtod(optarg, nullptr);
+                break;
+            case 'o':
+                if (!parse_ops(optarg, config.ops)) {
+                    fprintf(stderr, "Unknown operation in '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'r':
+                config.modes.clear();
+                for (const char* p = optarg; *p; p++) {
+                    if (*p < '0' || *p > '4') {
+                        fprintf(stderr, "Rounding modes are digits 0-4\n");
+                        return 2;
+                    }
+                    config.modes.push_back(*p - '0');
+                }
+                break;
+            case 'j':
+                config.threads = atoi(optarg);
+                break;
+            case 's':
+                config.seed = strtoull(optarg, nullptr, 0);
+                break;
+            case 'e':
+                config.examples = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (config.threads < 1) config.threads = 1;
+
+    uint64_t failures = 0;
+    for (int op_index : config.ops) {
+        const sweep_op_t& op = k_ops[op_index];
+
+        // Rounding does not reach floating_sqrt, so one mode covers it
+        std::vector<int> modes = config.modes;
+        if (op.batch_op == FP32_BATCH_SQRT && modes.size() > 1) modes.resize(1);
+
+        for (int rm : modes) {
+            sweep_totals_t totals;
+            auto start = std::chrono::steady_clock::now();
+            sweep(config, op, rm, (uint64_t)(op_index * 8 + rm), totals);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            printf("{\"op\":\"%s\",\"rm\":\"%s\",\"count\":%llu,\"result_mismatches\":%llu,"
+                   "\"nx_mismatches\":%llu,\"ns_per_op\":%.2f}\n",
+                   op.mnemonic, k_rm_names[rm], (unsigned long long)config.count,
+                   (unsigned long long)totals.result_mismatches.load(),
+                   (unsigned long long)totals.nx_mismatches.load(),
+                   config.count ? seconds * 1e9 / config.count : 0.0);
+            fflush(stdout);
+            failures += totals.result_mismatches + totals.nx_mismatches;
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,192 @@
+/*******************************************************************************
+ * Spike FP Coverage Merge
+ *
+ * ORs the coverage bitmaps written by spike_coverage_write() (one per run,
+ * spike_coverage.h format) and prints the combined report in the form
+ * top_core_coverage prints its covergroups:
+ *
+ *   === Coverage Report ===
+ *   FP Operand Class Coverage: 91.67%
+ *   FP Result Class Coverage: 80.11%
+ *   FP Rounding x Flags Coverage: 42.86%
+ *   FP Operand Pair Coverage: 37.93%
+ *   Spike FP Coverage: 52.43%
+ *
+ * The last line is over every reachable bin. Runs and instructions sampled
+ * are summed into the merged file, so merges can themselves be merged.
+ *
+ * Usage: spike_cov_merge [-o merged] [-u] [-j] file...
+ *   -o  Write the merged bitmap here
+ *   -u  List the reachable bins no run hit (to stderr with -j)
+ *   -j  Print the report as one JSON object instead
+ *
+ * Exit status: 0 merged, 2 usage or file error.
+ *
+ * Compile: g++ -O2 -o spike_cov_merge spike_cov_merge.cpp
+ ******************************************************************************/
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include "spike_coverage.h"
+
+static const char* const k_class_names[SPIKE_COV_CLASSES] = {
+    "-inf", "-normal", "-subnormal", "-zero", "+zero", "+subnormal", "+normal", "+inf", "snan", "qnan"
+};
+
+static const char* const k_rm_names[SPIKE_COV_MODES] = {"rne", "rtz", "rdn", "rup", "rmm"};
+
+static const char* const k_flag_names[6] = {"nx", "uf", "of", "dz", "nv", "none"};
+
+static const char* const k_source_names[3] = {"rs1", "rs2", "rs3"};
+
+/**
+ * OR one coverage file into the merged bitmap
+ * @return false if the file cannot be read or is not a coverage bitmap
+ *         of this layout
+ */
+static bool merge_file(const char* path, spike_cov_header_t* merged, uint64_t* bins) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+
+    spike_cov_header_t header;
+    uint64_t words[SPIKE_COV_WORDS];
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, SPIKE_COV_MAGIC, sizeof(header.magic)) == 0 &&
+              header.version == SPIKE_COV_VERSION && header.bins == SPIKE_COV_BINS &&
+              fread(words, sizeof(uint64_t), SPIKE_COV_WORDS, file) == SPIKE_COV_WORDS;
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "%s is not a version %u coverage file with %u bins\n", path,
+                SPIKE_COV_VERSION, (unsigned)SPIKE_COV_BINS);
+        return false;
+    }
+
+    for (int i = 0; i < SPIKE_COV_WORDS; i++) bins[i] |= words[i];
+    merged->samples += header.samples;
+    merged->runs += header.runs;
+    return true;
+}
+
+/**
+ * Readable name of one bin, e.g. "fdiv.s rup dz" or "fadd.s pair qnan x -inf"
+ */
+static std::string bin_name(uint32_t bin) {
+    const spike_cov_op_t& op = k_spike_cov_ops[bin / SPIKE_COV_BINS_PER_OP];
+    uint32_t offset = bin % SPIKE_COV_BINS_PER_OP;
+    char text[96];
+
+    if (offset < SPIKE_COV_BIN_RESULT) {
+        snprintf(text, sizeof(text), "%s %s %s", op.mnemonic, k_source_names[offset / SPIKE_COV_CLASSES],
+                 k_class_names[offset % SPIKE_COV_CLASSES]);
+    } else if (offset < SPIKE_COV_BIN_ROUNDING) {
+        snprintf(text, sizeof(text), "%s result %s", op.mnemonic, k_class_names[offset - SPIKE_COV_BIN_RESULT]);
+    } else if (offset < SPIKE_COV_BIN_PAIR) {
+        offset -= SPIKE_COV_BIN_ROUNDING;
+        snprintf(text, sizeof(text), "%s %s %s", op.mnemonic, k_rm_names[offset / 6], k_flag_names[offset % 6]);
+    } else {
+        offset -= SPIKE_COV_BIN_PAIR;
+        snprintf(text, sizeof(text), "%s pair %s x %s", op.mnemonic, k_class_names[offset / SPIKE_COV_CLASSES],
+                 k_class_names[offset % SPIKE_COV_CLASSES]);
+    }
+    return text;
+}
+
+static double percent(int hit, int reachable) {
+    return reachable ? 100.0 * hit / reachable : 0.0;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s [-o merged] [-u] [-j] file...\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    const char* output = nullptr;
+    bool uncovered = false;
+    bool json = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:ujh")) != -1) {
+        switch (opt) {
+            case 'o': output = optarg; break;
+            case 'u': uncovered = true; break;
+            case 'j': json = true; break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    spike_cov_header_t merged = {};
+    memcpy(merged.magic, SPIKE_COV_MAGIC, sizeof(merged.magic));
+    merged.version = SPIKE_COV_VERSION;
+    merged.bins = SPIKE_COV_BINS;
+    uint64_t bins[SPIKE_COV_WORDS] = {};
+
+    for (int i = optind; i < argc; i++) {
+        if (!merge_file(argv[i], &merged, bins)) return 2;
+    }
+
+    if (output != nullptr) {
+        FILE* file = fopen(output, "wb");
+        bool ok = file != nullptr && fwrite(&merged, sizeof(merged), 1, file) == 1 &&
+                  fwrite(bins, sizeof(uint64_t), SPIKE_COV_WORDS, file) == SPIKE_COV_WORDS;
+        if (file != nullptr) ok = (fclose(file) == 0) && ok;
+        if (!ok) {
+            fprintf(stderr, "Cannot write %s\n", output);
+            return 2;
+        }
+    }
+
+    int hit[SPIKE_COV_GROUPS] = {}, reachable[SPIKE_COV_GROUPS] = {};
+    int total_hit = 0, total_reachable = 0;
+    std::vector<uint32_t> missing;
+    for (uint32_t bin = 0; bin < SPIKE_COV_BINS; bin++) {
+        int group = spike_cov_bin_group(bin);
+        if (group < 0) continue;
+        bool covered = (bins[bin / 64] >> (bin % 64)) & 1;
+        reachable[group]++;
+        hit[group] += covered;
+        if (!covered) missing.push_back(bin);
+    }
+    for (int g = 0; g < SPIKE_COV_GROUPS; g++) {
+        total_hit += hit[g];
+        total_reachable += reachable[g];
+    }
+
+    if (json) {
+        printf("{\"runs\":%u,\"samples\":%llu", merged.runs, (unsigned long long)merged.samples);
+        for (int g = 0; g < SPIKE_COV_GROUPS; g++) {
+            printf(",\"%s\":{\"hit\":%d,\"bins\":%d,\"percent\":%.2f}", k_spike_cov_group_names[g],
+                   hit[g], reachable[g], percent(hit[g], reachable[g]));
+        }
+        printf(",\"total\":{\"hit\":%d,\"bins\":%d,\"percent\":%.2f}}\n", total_hit, total_reachable,
+               percent(total_hit, total_reachable));
+    } else {
+        printf("=== Coverage Report ===\n");
+        for (int g = 0; g < SPIKE_COV_GROUPS; g++) {
+            printf("%s Coverage: %.2f%%\n", k_spike_cov_group_names[g], percent(hit[g], reachable[g]));
+        }
+        printf("Spike FP Coverage: %.2f%%\n", percent(total_hit, total_reachable));
+        printf("(%u runs, %llu instructions sampled, %d of %d bins)\n", merged.runs,
+               (unsigned long long)merged.samples, total_hit, total_reachable);
+    }
+
+    if (uncovered) {
+        // Keep stdout a single JSON object in -j mode
+        FILE* list = json ? stderr : stdout;
+        for (uint32_t bin : missing) fprintf(list, "uncovered: %s\n", bin_name(bin).c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*******************************************************************************
+ * Spike FP Functional Coverage
+ *
+ * Bin layout and file format of the coverage bitmaps collected on the
+ * commit path of spike_wrapper.cpp (spike_coverage_enable()) and merged by
+ * spike_cov_merge. Every RV32F instruction has the same block of bins:
+ *
+ *   operand class     fclass of each FP source register (rs1, rs2, rs3)
+ *   result class      fclass of the FP value written (flw included)
+ *   rounding x flags  effective rounding mode crossed with each fflag
+ *                     raised, or with none raised
+ *   operand pair      fclass(rs1) x fclass(rs2)
+ *
+ * Bins an instruction cannot hit (no rs3, an integer result, a flag it
+ * never raises) stay in the layout but are excluded from the percentages
+ * by spike_cov_bin_group(). Bitmaps from parallel runs merge by OR.
+ *
+ * A file is one header followed by SPIKE_COV_WORDS 64-bit words, bin i in
+ * bit (i % 64) of word (i / 64), host byte order.
+ ******************************************************************************/
+
+#ifndef SPIKE_COVERAGE_H
+#define SPIKE_COVERAGE_H
+
+#include <cstdint>
+
+#define SPIKE_COV_MAGIC   "SPKCOVER"
+#define SPIKE_COV_VERSION 1u
+
+// Instructions, in bin block order
+enum {
+    SPIKE_COV_FADD, SPIKE_COV_FSUB, SPIKE_COV_FMUL, SPIKE_COV_FDIV, SPIKE_COV_FSQRT,
+    SPIKE_COV_FSGNJ, SPIKE_COV_FSGNJN, SPIKE_COV_FSGNJX, SPIKE_COV_FMIN, SPIKE_COV_FMAX,
+    SPIKE_COV_FCVT_W_S, SPIKE_COV_FCVT_WU_S, SPIKE_COV_FMV_X_W,
+    SPIKE_COV_FEQ, SPIKE_COV_FLT, SPIKE_COV_FLE, SPIKE_COV_FCLASS,
+    SPIKE_COV_FCVT_S_W, SPIKE_COV_FCVT_S_WU, SPIKE_COV_FMV_W_X,
+    SPIKE_COV_FMADD, SPIKE_COV_FMSUB, SPIKE_COV_FNMSUB, SPIKE_COV_FNMADD,
+    SPIKE_COV_FLW, SPIKE_COV_FSW,
+    SPIKE_COV_OPS
+};
+
+// Value classes: the fclass.s result bit (0 -inf ... 8 sNaN, 9 qNaN)
+#define SPIKE_COV_CLASSES 10
+
+// Rounding modes crossed with flags: RNE..RMM; DYN is resolved from frm
+#define SPIKE_COV_MODES 5
+#define SPIKE_COV_FLAG_NONE 5           // Flag column for "nothing raised"
+
+// Bin offsets within one instruction's block
+#define SPIKE_COV_BIN_OPERAND   0       // + source * SPIKE_COV_CLASSES + class
+#define SPIKE_COV_BIN_RESULT    30      // + class
+#define SPIKE_COV_BIN_ROUNDING  40      // + rm * 6 + flag bit (or SPIKE_COV_FLAG_NONE)
+#define SPIKE_COV_BIN_PAIR      70      // + class(rs1) * SPIKE_COV_CLASSES + class(rs2)
+#define SPIKE_COV_BINS_PER_OP   170
+
+#define SPIKE_COV_BINS  (SPIKE_COV_OPS * SPIKE_COV_BINS_PER_OP)
+#define SPIKE_COV_WORDS ((SPIKE_COV_BINS + 63) / 64)
+
+// Coverpoints reported as percentages, in spike_coverage_counts() order
+#define SPIKE_COV_GROUP_OPERAND  0
+#define SPIKE_COV_GROUP_RESULT   1
+#define SPIKE_COV_GROUP_ROUNDING 2
+#define SPIKE_COV_GROUP_PAIR     3
+#define SPIKE_COV_GROUPS         4
+
+static const char* const k_spike_cov_group_names[SPIKE_COV_GROUPS] = {
+    "FP Operand Class", "FP Result Class", "FP Rounding x Flags", "FP Operand Pair"
+};
+
+// What each instruction can reach
+typedef struct {
+    const char* mnemonic;
+    uint8_t sources;            // FP source registers: bit 0 rs1, bit 1 rs2, bit 2 rs3
+    uint16_t results;           // Result classes it can produce; 0 for an integer result
+    uint8_t flags;              // fflags it can raise, when it takes a rounding mode
+    bool rounds;                // Has an rm field
+} spike_cov_op_t;
+
+static const spike_cov_op_t k_spike_cov_ops[SPIKE_COV_OPS] = {
+    {"fadd.s",    3, 0x2FF, 0x15, true},     // Tiny sums are exact: no UF
+    {"fsub.s",    3, 0x2FF, 0x15, true},
+    {"fmul.s",    3, 0x2FF, 0x17, true},
+    {"fdiv.s",    3, 0x2FF, 0x1F, true},
+    {"fsqrt.s",   1, 0x2D8, 0x11, true},     // -0, +0, +normal, +inf, qNaN
+    {"fsgnj.s",   3, 0x3FF, 0,    false},
+    {"fsgnjn.s",  3, 0x3FF, 0,    false},
+    {"fsgnjx.s",  3, 0x3FF, 0,    false},
+    {"fmin.s",    3, 0x2FF, 0,    false},
+    {"fmax.s",    3, 0x2FF, 0,    false},
+    {"fcvt.w.s",  1, 0,     0x11, true},
+    {"fcvt.wu.s", 1, 0,     0x11, true},
+    {"fmv.x.w",   1, 0,     0,    false},
+    {"feq.s",     3, 0,     0,    false},
+    {"flt.s",     3, 0,     0,    false},
+    {"fle.s",     3, 0,     0,    false},
+    {"fclass.s",  1, 0,     0,    false},
+    {"fcvt.s.w",  0, 0x052, 0x01, true},     // -normal, +0, +normal
+    {"fcvt.s.wu", 0, 0x050, 0x01, true},
+    {"fmv.w.x",   0, 0x3FF, 0,    false},
+    {"fmadd.s",   7, 0x2FF, 0x17, true},
+    {"fmsub.s",   7, 0x2FF, 0x17, true},
+    {"fnmsub.s",  7, 0x2FF, 0x17, true},
+    {"fnmadd.s",  7, 0x2FF, 0x17, true},
+    {"flw",       0, 0x3FF, 0,    false},
+    {"fsw",       2, 0,     0,    false},
+};
+
+typedef struct {
+    char magic[8];              // SPIKE_COV_MAGIC, not NUL terminated
+    uint32_t version;           // SPIKE_COV_VERSION
+    uint32_t bins;              // SPIKE_COV_BINS
+    uint64_t samples;           // Instructions sampled, summed by a merge
+    uint32_t runs;              // Bitmaps merged into this one
+    uint32_t reserved;
+} spike_cov_header_t;
+
+static_assert(sizeof(spike_cov_header_t) == 32, "coverage header layout");
+
+/**
+ * fclass.s bit index of a single-precision value
+ */
+static inline int spike_cov_class(uint32_t v) {
+    uint32_t sign = v >> 31;
+    uint32_t exp = (v >> 23) & 0xFF;
+    uint32_t frac = v & 0x7FFFFF;
+
+    if (exp == 0xFF) {
+        if (frac == 0) return sign ? 0 : 7;
+        return (frac >> 22) ? 9 : 8;
+    }
+    if (exp == 0) return frac ? (sign ? 2 : 5) : (sign ? 3 : 4);
+    return sign ? 1 : 6;
+}
+
+/**
+ * Coverpoint a bin is reported under
+ * @return SPIKE_COV_GROUP_*, or -1 for a bin the instruction cannot hit
+ */
+static inline int spike_cov_bin_group(uint32_t bin) {
+    const spike_cov_op_t& op = k_spike_cov_ops[bin / SPIKE_COV_BINS_PER_OP];
+    uint32_t offset = bin % SPIKE_COV_BINS_PER_OP;
+
+    if (offset < SPIKE_COV_BIN_RESULT) {
+        return (op.sources >> (offset / SPIKE_COV_CLASSES)) & 1 ? SPIKE_COV_GROUP_OPERAND : -1;
+    }
+    if (offset < SPIKE_COV_BIN_ROUNDING) {
+        return (op.results >> (offset - SPIKE_COV_BIN_RESULT)) & 1 ? SPIKE_COV_GROUP_RESULT : -1;
+    }
+    if (offset < SPIKE_COV_BIN_PAIR) {
+        uint32_t flag = (offset - SPIKE_COV_BIN_ROUNDING) % 6;
+        if (!op.rounds) return -1;
+        return (flag == SPIKE_COV_FLAG_NONE || ((op.flags >> flag) & 1)) ? SPIKE_COV_GROUP_ROUNDING : -1;
+    }
+    return (op.sources & 3) == 3 ? SPIKE_COV_GROUP_PAIR : -1;
+}
+
+#endif // SPIKE_COVERAGE_H
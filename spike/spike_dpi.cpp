@@ -3,30 +3,194 @@
 //==============================================================================
 // Import Spike C++ functions via SystemVerilog DPI-C
 
-// Spike initialization and control
-import "DPI-C" function void spike_init(input string isa_string);
-import "DPI-C" function void spike_reset();
-import "DPI-C" function void spike_close();
+// Per-instruction commit record (layout shared with spike_wrapper.cpp,
+// fields declared last-to-first so pc lands in word 0)
+typedef struct packed {
+    bit [31:0] mem_op;      // [1:0] 0 none, 1 load, 2 store; [7:4] size in bytes
+    bit [31:0] mem_data;    // Data loaded or stored
+    bit [31:0] mem_addr;    // Data memory address accessed
+    bit [31:0] fcsr_delta;  // [4:0] fflags newly set, [7:5] frm bits changed
+    bit [31:0] fcsr;        // FCSR after the instruction retires
+    bit [31:0] value;       // Value written to the destination register
+    bit [31:0] rd;          // [4:0] index, [5] FP register file, [8] valid
+    bit [31:0] pc;          // PC after the instruction retires
+} spike_commit_t;
+
+// Exception raised by an instruction (spike_trap_t in spike_wrapper.cpp,
+// epc in word 0)
+typedef struct packed {
+    bit [31:0] cause;       // Exception code (mcause)
+    bit [31:0] tval;        // Faulting address or instruction bits (mtval)
+    bit [31:0] epc;         // PC of the instruction that trapped (mepc)
+} spike_trap_t;
+
+// Exception codes reported in spike_trap_t.cause
+localparam int SPIKE_CAUSE_ILLEGAL_INSTRUCTION = 2;
+localparam int SPIKE_CAUSE_MISALIGNED_LOAD     = 4;
+localparam int SPIKE_CAUSE_LOAD_ACCESS         = 5;
+localparam int SPIKE_CAUSE_MISALIGNED_STORE    = 6;
+localparam int SPIKE_CAUSE_STORE_ACCESS        = 7;
+
+// Memory map entry for spike_init_mem() (base in word 0)
+typedef struct packed {
+    bit [31:0] size;
+    bit [31:0] base;
+} spike_mem_region_t;
+
+typedef spike_mem_region_t spike_mem_map_t[$];
+
+// Architectural state word layout (spike_arch_state_t in spike_wrapper.cpp)
+localparam int SPIKE_STATE_XREG  = 0;
+localparam int SPIKE_STATE_FREG  = 32;
+localparam int SPIKE_STATE_PC    = 64;
+localparam int SPIKE_STATE_FCSR  = 65;
+localparam int SPIKE_ARCH_STATE_WORDS = 66;
+
+// spike_check_commit() field mask and result bits
+localparam int SPIKE_CHECK_PC     = 'h01;
+localparam int SPIKE_CHECK_RD     = 'h02;
+localparam int SPIKE_CHECK_FREG   = 'h04;
+localparam int SPIKE_CHECK_XREG   = 'h08;
+localparam int SPIKE_CHECK_FFLAGS = 'h10;
+
+// spike_get_check_stats() word layout (spike_check_stats_t)
+localparam int SPIKE_STAT_CHECKS      = 0;
+localparam int SPIKE_STAT_PASSED      = 1;
+localparam int SPIKE_STAT_PC          = 2;
+localparam int SPIKE_STAT_RD          = 3;
+localparam int SPIKE_STAT_FREG        = 4;
+localparam int SPIKE_STAT_XREG        = 5;
+localparam int SPIKE_STAT_FFLAGS      = 6;
+localparam int SPIKE_STAT_MAX_ULP     = 7;
+localparam int SPIKE_CHECK_STATS_WORDS = 8;
+
+// Status codes (SPIKE_OK / SPIKE_ERR_* in spike_wrapper.cpp). Calls that
+// return int give one of these on failure; spike_get_last_error() also
+// reports failures of calls that return a value.
+localparam int SPIKE_OK                  = 0;
+localparam int SPIKE_TRAPPED             = 1;   // spike_execute_trap(): exception taken
+localparam int SPIKE_ERR_NOT_INITIALIZED = -1;
+localparam int SPIKE_ERR_ARGUMENT        = -2;
+localparam int SPIKE_ERR_STATE           = -3;
+localparam int SPIKE_ERR_EXECUTION       = -4;
+localparam int SPIKE_ERR_IO              = -5;
+localparam int SPIKE_ERR_BUSY            = -6;
+localparam int SPIKE_ERR_CONFIG          = -7;
+localparam int SPIKE_ERR_LIMIT           = -8;   // spike_run_until(): max_steps reached
+
+// Wrapper diagnostic log levels for spike_set_log_level()
+localparam int SPIKE_LOG_DEBUG = 0;
+localparam int SPIKE_LOG_INFO  = 1;
+localparam int SPIKE_LOG_WARN  = 2;
+localparam int SPIKE_LOG_ERROR = 3;
+localparam int SPIKE_LOG_OFF   = 4;
+
+// Diagnostics and error reporting (process wide; a null handle asks for
+// failures that had no instance, such as spike_init())
+import "DPI-C" function int spike_set_log_level(input int level);
+import "DPI-C" function int spike_get_last_error(input chandle ctx);
+import "DPI-C" function string spike_error_string(input int code);
+
+// Spike initialization and control. spike_init() returns a handle to an
+// independent instance; every other call takes that handle first.
+import "DPI-C" function chandle spike_init(input string isa_string);
+import "DPI-C" function chandle spike_init_mem(input string isa_string, input spike_mem_region_t regions[]);
+import "DPI-C" function int spike_reset(input chandle ctx);
+import "DPI-C" function void spike_close(input chandle ctx);
+
+// Checkpoint/restore of hart state and memory (copy-on-write pages)
+import "DPI-C" function int spike_checkpoint(input chandle ctx);
+import "DPI-C" function int spike_restore(input chandle ctx);
 
 // Register file access
-import "DPI-C" function int spike_read_freg(input int reg_num);
-import "DPI-C" function void spike_write_freg(input int reg_num, input int value);
-import "DPI-C" function int spike_read_xreg(input int reg_num);
-import "DPI-C" function void spike_write_xreg(input int reg_num, input int value);
+import "DPI-C" function int spike_read_freg(input chandle ctx, input int reg_num);
+import "DPI-C" function int spike_write_freg(input chandle ctx, input int reg_num, input int value);
+import "DPI-C" function int spike_read_xreg(input chandle ctx, input int reg_num);
+import "DPI-C" function int spike_write_xreg(input chandle ctx, input int reg_num, input int value);
+
+// Whole-state transfer, one DPI call per direction
+import "DPI-C" function int spike_get_arch_state(input chandle ctx, output int state[]);
+import "DPI-C" function int spike_set_arch_state(input chandle ctx, input int state[],
+                                                 input bit [SPIKE_ARCH_STATE_WORDS-1:0] dirty);
 
 // PC and CSR access
-import "DPI-C" function int spike_read_pc();
-import "DPI-C" function void spike_write_pc(input int pc_value);
-import "DPI-C" function int spike_read_csr(input int csr_addr);
-import "DPI-C" function void spike_write_csr(input int csr_addr, input int value);
+import "DPI-C" function int spike_read_pc(input chandle ctx);
+import "DPI-C" function int spike_write_pc(input chandle ctx, input int pc_value);
+import "DPI-C" function int spike_read_csr(input chandle ctx, input int csr_addr);
+import "DPI-C" function int spike_write_csr(input chandle ctx, input int csr_addr, input int value);
 
 // Instruction execution
-import "DPI-C" function int spike_execute_instruction(input int instruction);
-import "DPI-C" function int spike_step_one();
+import "DPI-C" function int spike_execute_instruction(input chandle ctx, input int instruction);
+import "DPI-C" function int spike_execute_commit(input chandle ctx, input int instruction, output spike_commit_t commit);
+import "DPI-C" function int spike_execute_trap(input chandle ctx, input int instruction,
+                                               output spike_commit_t commit, output spike_trap_t trap);
+import "DPI-C" function int spike_step_one(input chandle ctx);
+import "DPI-C" function int spike_set_direct_inject(input chandle ctx, input int enable);
+import "DPI-C" function int spike_execute_batch(input chandle ctx, input int instructions[], output spike_commit_t results[]);
+
+// Asynchronous execution on a worker thread
+import "DPI-C" function int spike_set_async(input chandle ctx, input int enable);
+import "DPI-C" function int spike_submit(input chandle ctx, input int instruction);
+import "DPI-C" function int spike_poll_result(input chandle ctx, input int ticket, output spike_commit_t commit);
+
+// Binary commit trace (compare offline with spike_trace_diff)
+import "DPI-C" function int spike_trace_open(input chandle ctx, input string path);
+import "DPI-C" function int spike_trace_close(input chandle ctx);
+
+// Precomputed replay: results generated offline by spike_replay_gen
+import "DPI-C" function int spike_replay_open(input chandle ctx, input string path);
+import "DPI-C" function int spike_replay_close(input chandle ctx);
+
+// Commit checking in C++: only failures come back with a formatted report
+import "DPI-C" function int spike_set_check_config(input chandle ctx, input int check_mask,
+                                                   input int ulp_tolerance);
+import "DPI-C" function int spike_check_commit(input chandle ctx, input spike_commit_t commit,
+                                               input int dut_pc, input int dut_rd,
+                                               input int dut_value, input int dut_fflags,
+                                               output string report);
+import "DPI-C" function int spike_get_check_stats(input chandle ctx, output int stats[]);
+
+// Per entry point call counts and latency (SPIKE_CALL_STATS_WORDS longints
+// per entry point: calls, total ns, max ns, p50 ns, p90 ns, p99 ns)
+localparam int SPIKE_CALL_STATS_WORDS = 6;
+localparam int SPIKE_MAX_ENTRY_POINTS = 64;
+import "DPI-C" function int spike_get_stats(input chandle ctx, output longint stats[]);
+import "DPI-C" function string spike_get_stat_name(input int index);
 
 // Memory access
-import "DPI-C" function int spike_read_mem(input int addr);
-import "DPI-C" function void spike_write_mem(input int addr, input int data);
+import "DPI-C" function int spike_read_mem(input chandle ctx, input int addr);
+import "DPI-C" function int spike_write_mem(input chandle ctx, input int addr, input int data);
+import "DPI-C" function int spike_read_mem_block(input chandle ctx, input int addr, output int data[]);
+import "DPI-C" function int spike_write_mem_block(input chandle ctx, input int addr, input int data[]);
+
+// Memory digests: XXH64 per 4KB page, combined in address order. Cached
+// page hashes make repeated digests of Spike memory cost O(dirty pages);
+// spike_image_digest() computes the same digest over a word array.
+localparam int SPIKE_DIGEST_PAGE = 4096;
+import "DPI-C" function int spike_mem_digest(input chandle ctx, input int addr, input int size,
+                                            output longint digest);
+import "DPI-C" function int spike_mem_page_hashes(input chandle ctx, input int addr, input int size,
+                                                 output longint hashes[]);
+import "DPI-C" function int spike_image_digest(input int addr, input int words[], output longint digest);
+
+// Whole programs: load an ELF and run it natively in Spike until a stop
+// condition. target is a PC, an instruction count, or the tohost address
+// (0 for the loaded program's tohost symbol); max_steps 0 is unlimited.
+localparam int SPIKE_RUN_PC      = 0;
+localparam int SPIKE_RUN_INSTRET = 1;
+localparam int SPIKE_RUN_TOHOST  = 2;
+import "DPI-C" function int spike_load_elf(input chandle ctx, input string path);
+import "DPI-C" function longint spike_elf_symbol(input chandle ctx, input string name);
+import "DPI-C" function int spike_run_until(input chandle ctx, input int mode, input longint target,
+                                           input longint max_steps, output longint retired);
+
+// FP functional coverage sampled on Spike's commit path as bitmaps
+// (spike_coverage.h). spike_coverage_counts() fills covered then reachable
+// bins per coverpoint; spike_cov_merge ORs the files of parallel runs.
+localparam int SPIKE_COV_GROUPS = 4;
+import "DPI-C" function int spike_coverage_enable(input chandle ctx, input int enable);
+import "DPI-C" function int spike_coverage_write(input chandle ctx, input string path);
+import "DPI-C" function int spike_coverage_counts(input chandle ctx, output int counts[]);
 
 //==============================================================================
 // Spike Reference Model Class
@@ -40,7 +204,22 @@ class spike_reference_model extends uvm_component;
     //===========================================
     bit enabled = 1;
     bit verbose = 0;
+    bit direct_inject = 0;         // Execute from Spike's decode cache (SPIKE_DIRECT_INJECT builds only)
+    bit async_mode = 0;            // Step Spike on a worker thread (submit/poll)
     string isa_string = "RV32IF";  // RV32I with F extension
+    string trace_file = "";        // Record every Spike commit here when set
+    string replay_file = "";       // Take results from this precomputed file when set
+    string stimulus_file = "";     // Write each reset segment's instructions here for spike_replay_gen
+    int log_level = -1;            // SPIKE_LOG_*; -1 keeps the wrapper's default
+    bit coverage = 0;              // Sample FP functional coverage on Spike's commit path
+    string coverage_file = "";     // Write the coverage bitmap here at the end of the run
+    
+    // Memory map; empty selects Spike's default 128MB at 0x8000_0000.
+    // The first region's base is the reset PC.
+    spike_mem_map_t mem_map;
+    
+    // Handle of this model's Spike instance
+    chandle ctx;
     
     // Register file shadow copies
     logic [31:0] spike_xregs[32];   // Integer registers
@@ -48,9 +227,25 @@ class spike_reference_model extends uvm_component;
     logic [31:0] spike_pc;
     logic [31:0] spike_fcsr;
     
+    // Commit record of the most recently executed instruction, and the
+    // exception it raised when last_trapped is set
+    spike_commit_t last_commit;
+    spike_trap_t   last_trap;
+    bit            last_trapped = 0;
+    
+    // Commit records prefetched by execute_batch(), consumed in order
+    spike_commit_t batch_results[$];
+    logic [31:0]   batch_instructions[$];
+    
+    // Instructions Spike ran since the last reset_spike(), and the
+    // segments already written, for the "spike_stimulus" config
+    logic [31:0] stimulus_instructions[$];
+    int          stimulus_segments = 0;
+    
     // Statistics
     int instructions_executed = 0;
     int fp_instructions = 0;
+    int traps_taken = 0;
     
     //===========================================
     // Constructor
@@ -69,10 +264,58 @@ class spike_reference_model extends uvm_component;
         void'(uvm_config_db#(bit)::get(this, "", "spike_enabled", enabled));
         void'(uvm_config_db#(bit)::get(this, "", "spike_verbose", verbose));
         void'(uvm_config_db#(string)::get(this, "", "isa_string", isa_string));
+        void'(uvm_config_db#(bit)::get(this, "", "spike_direct_inject", direct_inject));
+        void'(uvm_config_db#(bit)::get(this, "", "spike_async", async_mode));
+        void'(uvm_config_db#(spike_mem_map_t)::get(this, "", "spike_mem_map", mem_map));
+        void'(uvm_config_db#(string)::get(this, "", "spike_trace", trace_file));
+        void'(uvm_config_db#(string)::get(this, "", "spike_replay", replay_file));
+        void'(uvm_config_db#(string)::get(this, "", "spike_stimulus", stimulus_file));
+        void'(uvm_config_db#(int)::get(this, "", "spike_log_level", log_level));
+        void'(uvm_config_db#(bit)::get(this, "", "spike_coverage", coverage));
+        void'(uvm_config_db#(string)::get(this, "", "spike_coverage_file", coverage_file));
         
         if (enabled) begin
+            // The log level applies from initialization on
+            if (log_level >= 0) begin
+                void'(spike_set_log_level(log_level));
+            end else if (verbose) begin
+                void'(spike_set_log_level(SPIKE_LOG_DEBUG));
+            end
+            
             // Initialize Spike
-            spike_init(isa_string);
+            if (mem_map.size() > 0) begin
+                spike_mem_region_t regions[] = new[mem_map.size()];
+                foreach (mem_map[i]) regions[i] = mem_map[i];
+                ctx = spike_init_mem(isa_string, regions);
+            end else begin
+                ctx = spike_init(isa_string);
+            end
+            if (ctx == null) begin
+                `uvm_fatal(get_type_name(), $sformatf("Spike failed to initialize with ISA: %s (%s)",
+                                                      isa_string, spike_error_string(spike_get_last_error(null))))
+            end
+            if (spike_set_direct_inject(ctx, direct_inject) != SPIKE_OK) begin
+                `uvm_error(get_type_name(), "Cannot select Spike execution mode")
+            end
+            if (trace_file != "" && spike_trace_open(ctx, trace_file) != 0) begin
+                `uvm_error(get_type_name(), $sformatf("Cannot record Spike trace to %s", trace_file))
+            end
+            if (replay_file != "") begin
+                int results = spike_replay_open(ctx, replay_file);
+                if (results < 0) begin
+                    `uvm_fatal(get_type_name(), $sformatf("Cannot replay Spike results from %s", replay_file))
+                end
+                `uvm_info(get_type_name(),
+                         $sformatf("Replaying %0d precomputed Spike results from %s", results, replay_file),
+                         UVM_LOW)
+            end
+            if ((coverage || coverage_file != "") && spike_coverage_enable(ctx, 1) != SPIKE_OK) begin
+                `uvm_error(get_type_name(), "Cannot enable Spike FP coverage")
+            end
+            if (async_mode && spike_set_async(ctx, 1) != 0) begin
+                `uvm_warning(get_type_name(), "Spike worker thread unavailable, running synchronously")
+                async_mode = 0;
+            end
             `uvm_info(get_type_name(), 
                      $sformatf("Spike initialized with ISA: %s", isa_string), 
                      UVM_LOW)
@@ -83,45 +326,318 @@ class spike_reference_model extends uvm_component;
     // Reset Spike State
     //===========================================
     virtual function void reset_spike();
+        int state[SPIKE_ARCH_STATE_WORDS];
+        
         if (!enabled) return;
         
-        spike_reset();
+        flush_stimulus();
+        if (spike_reset(ctx) != SPIKE_OK) begin
+            `uvm_error(get_type_name(), "Failed to reset Spike")
+        end
+        batch_results.delete();
+        batch_instructions.delete();
         
         // Initialize registers to known state
         for (int i = 0; i < 32; i++) begin
-            spike_write_xreg(i, i);  // x0=0, x1=1, etc.
-            spike_write_freg(i, $shortrealtobits(real'(i) + 0.5));
+            spike_xregs[i] = i;  // x0=0, x1=1, etc.
+            spike_fregs[i] = $shortrealtobits(real'(i) + 0.5);
+            state[SPIKE_STATE_XREG + i] = spike_xregs[i];
+            state[SPIKE_STATE_FREG + i] = spike_fregs[i];
         end
         
-        // Set initial PC
-        spike_write_pc(32'h8000_0000);
-        spike_pc = 32'h8000_0000;
+        // Set initial PC and clear FCSR
+        spike_pc = (mem_map.size() > 0) ? mem_map[0].base : 32'h8000_0000;
+        spike_fcsr = 32'h0;
+        state[SPIKE_STATE_PC] = spike_pc;
+        state[SPIKE_STATE_FCSR] = spike_fcsr;
         
-        // Clear FCSR
-        spike_write_csr(32'h003, 32'h0);  // fcsr address = 0x003
+        if (spike_set_arch_state(ctx, state, '1) < 0) begin
+            `uvm_error(get_type_name(), "Failed to write initial state to Spike")
+        end
         
         `uvm_info(get_type_name(), "Spike reset completed", UVM_MEDIUM)
     endfunction
     
+    //===========================================
+    // Write Stimulus for Offline Result Generation
+    //===========================================
+    // Appends one segment to a spike_replay_gen stimulus file: the state
+    // reset_spike() sets up, then the instructions. The "spike_stimulus"
+    // config calls this at every reset_spike() and at the end of the run;
+    // generate the results offline from that file, and later runs of the
+    // same seed can replay them through the "spike_replay" config.
+    virtual function void write_stimulus(input string path, input logic [31:0] instructions[$],
+                                         input bit append = 1);
+        int fd = $fopen(path, append ? "a" : "w");
+        
+        if (fd == 0) begin
+            `uvm_error(get_type_name(), $sformatf("Cannot write stimulus %s", path))
+            return;
+        end
+        if (mem_map.size() > 0) begin
+            `uvm_warning(get_type_name(), "spike_replay_gen uses the default memory map")
+        end
+        
+        $fdisplay(fd, "reset");
+        for (int i = 1; i < 32; i++) $fdisplay(fd, "x%0d %08h", i, i);
+        for (int i = 0; i < 32; i++) $fdisplay(fd, "f%0d %08h", i, $shortrealtobits(real'(i) + 0.5));
+        $fdisplay(fd, "pc 80000000");
+        $fdisplay(fd, "fcsr 0");
+        foreach (instructions[i]) $fdisplay(fd, "%08h", instructions[i]);
+        $fclose(fd);
+    endfunction
+    
+    //===========================================
+    // Record Stimulus for the "spike_stimulus" Config
+    //===========================================
+    virtual function void record_stimulus(input logic [31:0] instruction);
+        if (stimulus_file != "") stimulus_instructions.push_back(instruction);
+    endfunction
+    
+    // Writes the instructions run since the last reset_spike() as one
+    // segment; the first segment of the run truncates the file.
+    virtual function void flush_stimulus();
+        if (stimulus_file == "" || stimulus_instructions.size() == 0) return;
+        
+        write_stimulus(stimulus_file, stimulus_instructions, stimulus_segments > 0);
+        stimulus_segments++;
+        stimulus_instructions.delete();
+    endfunction
+    
+    //===========================================
+    // Checkpoint Spike State
+    //===========================================
+    virtual function void checkpoint();
+        if (!enabled) return;
+        
+        if (spike_checkpoint(ctx) != 0) begin
+            `uvm_error(get_type_name(), "Failed to checkpoint Spike state")
+        end
+    endfunction
+    
+    //===========================================
+    // Restore Spike State from the Checkpoint
+    //===========================================
+    // Costs only the memory pages written since checkpoint(); the
+    // checkpoint stays valid so many tests can be forked from it.
+    virtual function void restore();
+        int pages;
+        
+        if (!enabled) return;
+        
+        pages = spike_restore(ctx);
+        if (pages < 0) begin
+            `uvm_error(get_type_name(), "Failed to restore Spike checkpoint")
+            return;
+        end
+        
+        batch_results.delete();
+        batch_instructions.delete();
+        update_shadow_registers();
+        
+        `uvm_info(get_type_name(),
+                 $sformatf("Spike restored from checkpoint (%0d pages rolled back)", pages),
+                 UVM_MEDIUM)
+    endfunction
+    
+    //===========================================
+    // Load an ELF Program
+    //===========================================
+    // Leaves the PC at the program's entry point.
+    virtual function bit load_program(input string path);
+        int segments;
+        
+        if (!enabled) return 0;
+        
+        segments = spike_load_elf(ctx, path);
+        if (segments < 0) begin
+            `uvm_error(get_type_name(), $sformatf("Failed to load %s: %s", path,
+                       spike_error_string(segments)))
+            return 0;
+        end
+        
+        batch_results.delete();
+        batch_instructions.delete();
+        update_shadow_registers();
+        
+        `uvm_info(get_type_name(), $sformatf("Loaded %s (%0d segments), entry 0x%08h",
+                 path, segments, spike_pc), UVM_MEDIUM)
+        return 1;
+    endfunction
+    
+    //===========================================
+    // Run Natively Until a Stop Condition
+    //===========================================
+    // Spike executes whole chunks of the program per DPI call. Returns
+    // SPIKE_OK when the condition was met, SPIKE_ERR_LIMIT if max_steps
+    // ran out first. For SPIKE_RUN_TOHOST, tohost_value() gives the
+    // program's result afterwards.
+    virtual function int run_until(input int mode, input longint target, input longint max_steps = 0);
+        longint retired;
+        int status;
+        
+        if (!enabled) return SPIKE_ERR_NOT_INITIALIZED;
+        
+        status = spike_run_until(ctx, mode, target, max_steps, retired);
+        instructions_executed += int'(retired);
+        update_shadow_registers();
+        
+        if (status < 0 && status != SPIKE_ERR_LIMIT) begin
+            `uvm_error(get_type_name(), $sformatf("Spike run failed after %0d instructions: %s",
+                       retired, spike_error_string(status)))
+        end
+        return status;
+    endfunction
+    
+    //===========================================
+    // Read the Loaded Program's tohost Word
+    //===========================================
+    // riscv-tests convention: 1 is a pass, (n << 1) | 1 failed test n.
+    virtual function int tohost_value();
+        longint addr;
+        
+        if (!enabled) return 0;
+        
+        addr = spike_elf_symbol(ctx, "tohost");
+        if (addr < 0) begin
+            `uvm_error(get_type_name(), "Loaded program has no tohost symbol")
+            return 0;
+        end
+        return spike_read_mem(ctx, int'(addr));
+    endfunction
+    
+    //===========================================
+    // Preload a Memory Image
+    //===========================================
+    // One DPI call for the whole image, e.g. the DUT's dmem contents.
+    virtual function void load_memory(input int addr, input int words[]);
+        int written;
+        
+        if (!enabled) return;
+        
+        written = spike_write_mem_block(ctx, addr, words);
+        if (written < 0) begin
+            `uvm_error(get_type_name(), $sformatf("Failed to load %0d words at 0x%08h: %s",
+                       words.size(), addr, spike_error_string(written)))
+        end
+    endfunction
+    
+    //===========================================
+    // Dump a Memory Range
+    //===========================================
+    // Fills words with count words from addr, for comparison against the
+    // DUT's final memory.
+    virtual function bit dump_memory(input int addr, input int count, output int words[]);
+        int read;
+        
+        words = new[count];
+        if (!enabled) return 0;
+        
+        read = spike_read_mem_block(ctx, addr, words);
+        if (read < 0) begin
+            `uvm_error(get_type_name(), $sformatf("Failed to dump %0d words at 0x%08h: %s",
+                       count, addr, spike_error_string(read)))
+            return 0;
+        end
+        return 1;
+    endfunction
+    
+    //===========================================
+    // Compare Memory Against an Expected Image
+    //===========================================
+    // Compares digests first, so a matching check costs one call over
+    // the DUT image plus Spike's dirty pages; only a mismatch reads the
+    // range back to report the differing words. Returns 1 on a match.
+    virtual function bit compare_memory(input int addr, input int words[], input int max_reports = 10);
+        longint spike_digest;
+        longint image_digest;
+        int spike_words[];
+        int reported = 0;
+        int status;
+        
+        if (!enabled) return 1;
+        
+        status = spike_mem_digest(ctx, addr, words.size() * 4, spike_digest);
+        if (status != SPIKE_OK) begin
+            `uvm_error(get_type_name(), $sformatf("Failed to digest memory at 0x%08h: %s",
+                       addr, spike_error_string(status)))
+            return 0;
+        end
+        void'(spike_image_digest(addr, words, image_digest));
+        if (spike_digest == image_digest) return 1;
+        
+        if (!dump_memory(addr, words.size(), spike_words)) return 0;
+        foreach (words[i]) begin
+            if (words[i] != spike_words[i] && reported < max_reports) begin
+                `uvm_error(get_type_name(), $sformatf("Memory mismatch at 0x%08h: expected 0x%08h, Spike 0x%08h",
+                           addr + i * 4, words[i], spike_words[i]))
+                reported++;
+            end
+        end
+        return 0;
+    endfunction
+    
     //===========================================
     // Execute Single Instruction in Spike
     //===========================================
     virtual function void execute_instruction(input logic [31:0] instruction);
+        spike_commit_t commit;
         int status;
         
         if (!enabled) return;
         
-        // Execute instruction in Spike
-        status = spike_execute_instruction(instruction);
+        // Use the prefetched result when the stimulus was batched ahead
+        if (batch_results.size() > 0) begin
+            if (batch_instructions[0] == instruction) begin
+                void'(batch_instructions.pop_front());
+                apply_commit(batch_results.pop_front());
+                last_trapped = 0;
+                return;
+            end
+            
+            `uvm_error(get_type_name(),
+                      $sformatf("Instruction 0x%08h does not match prefetched 0x%08h, dropping %0d batched results",
+                               instruction, batch_instructions[0], batch_results.size()))
+            
+            // Spike already ran the dropped instructions. Their register
+            // effects are undone from the shadow copies, which stop at the
+            // last consumed result; their stores cannot be.
+            foreach (batch_results[i]) begin
+                if (batch_results[i].mem_op[1:0] == 2) begin
+                    `uvm_fatal(get_type_name(),
+                              $sformatf("Dropped batched store to 0x%08h already reached Spike memory",
+                                       batch_results[i].mem_addr))
+                end
+            end
+            batch_results.delete();
+            batch_instructions.delete();
+            push_shadow_state();
+        end
+        
+        record_stimulus(instruction);
         
-        if (status != 0) begin
+        // Execute instruction in Spike; the commit record carries
+        // everything the shadow copies need. A trap is an outcome, not a
+        // failure: the PC moves to the handler and the cause is kept.
+        status = spike_execute_trap(ctx, instruction, commit, last_trap);
+        last_trapped = (status == SPIKE_TRAPPED);
+        
+        if (last_trapped) begin
+            traps_taken++;
+            apply_commit(commit);
+            `uvm_info(get_type_name(),
+                     $sformatf("Instruction 0x%08h trapped: cause %0d, tval 0x%08h, epc 0x%08h",
+                              instruction, last_trap.cause, last_trap.tval, last_trap.epc),
+                     UVM_MEDIUM)
+        end else if (status != SPIKE_OK) begin
             `uvm_error(get_type_name(), 
-                      $sformatf("Spike execution failed for instruction 0x%08h", instruction))
+                      $sformatf("Spike execution failed for instruction 0x%08h: %s",
+                               instruction, spike_error_string(status)))
+            update_shadow_registers();
+        end else begin
+            apply_commit(commit);
         end
         
-        // Update shadow registers
-        update_shadow_registers();
-        
         instructions_executed++;
         
         if (verbose) begin
@@ -132,18 +648,121 @@ class spike_reference_model extends uvm_component;
         end
     endfunction
     
+    //===========================================
+    // Execute Known Stimulus Ahead in One DPI Call
+    //===========================================
+    virtual function int execute_batch(input logic [31:0] instructions[$]);
+        int insns[];
+        spike_commit_t results[];
+        int executed;
+        
+        if (!enabled || instructions.size() == 0) return 0;
+        
+        insns = new[instructions.size()];
+        results = new[instructions.size()];
+        foreach (instructions[i]) insns[i] = instructions[i];
+        
+        executed = spike_execute_batch(ctx, insns, results);
+        
+        if (executed != instructions.size()) begin
+            `uvm_error(get_type_name(),
+                      $sformatf("Spike batch stopped after %0d of %0d instructions: %s",
+                               executed, instructions.size(),
+                               spike_error_string(spike_get_last_error(ctx))))
+        end
+        
+        for (int i = 0; i < executed; i++) begin
+            batch_instructions.push_back(instructions[i]);
+            batch_results.push_back(results[i]);
+            record_stimulus(instructions[i]);
+        end
+        
+        instructions_executed += (executed > 0) ? executed : 0;
+        return executed;
+    endfunction
+    
+    //===========================================
+    // Queue an Instruction for the Worker Thread
+    //===========================================
+    // Returns a ticket for poll_result(), SPIKE_ERR_BUSY when the queue is
+    // full (poll some results and retry) or another negative SPIKE_ERR_*
+    // code. Results must be polled in submission order for the shadow
+    // copies to follow Spike.
+    virtual function int submit_instruction(input logic [31:0] instruction);
+        int ticket;
+        
+        if (!enabled || !async_mode) return SPIKE_ERR_STATE;
+        
+        ticket = spike_submit(ctx, instruction);
+        if (ticket < 0 && ticket != SPIKE_ERR_BUSY) begin
+            `uvm_error(get_type_name(),
+                      $sformatf("Failed to queue instruction 0x%08h for Spike: %s",
+                               instruction, spike_error_string(ticket)))
+        end else if (ticket >= 0) begin
+            record_stimulus(instruction);
+            instructions_executed++;
+        end
+        return ticket;
+    endfunction
+    
+    //===========================================
+    // Collect a Submitted Instruction's Result
+    //===========================================
+    // Returns 1 and applies the commit record when ready, 0 while the
+    // worker is still behind, a negative SPIKE_ERR_* code on failure.
+    // With wait set it does not return 0.
+    virtual function int poll_result(input int ticket, output spike_commit_t commit,
+                                     input bit wait = 0);
+        int status;
+        
+        do begin
+            status = spike_poll_result(ctx, ticket, commit);
+        end while (wait && status == 0);
+        
+        if (status > 0) begin
+            apply_commit(commit);
+        end else if (status < 0) begin
+            `uvm_error(get_type_name(),
+                      $sformatf("Spike execution failed for async ticket %0d: %s",
+                               ticket, spike_error_string(status)))
+            update_shadow_registers();
+        end
+        return status;
+    endfunction
+    
+    //===========================================
+    // Apply a Commit Record to the Shadow Copies
+    //===========================================
+    virtual function void apply_commit(input spike_commit_t commit);
+        if (commit.rd[8]) begin
+            if (commit.rd[5]) spike_fregs[commit.rd[4:0]] = commit.value;
+            else              spike_xregs[commit.rd[4:0]] = commit.value;
+        end
+        
+        spike_pc = commit.pc;
+        spike_fcsr = commit.fcsr;
+        last_commit = commit;
+    endfunction
+    
     //===========================================
     // Update Shadow Register Copies
     //===========================================
     virtual function void update_shadow_registers();
-        // Read back all registers from Spike
+        int state[SPIKE_ARCH_STATE_WORDS];
+        
+        // Read back all registers from Spike in one call
+        if (spike_get_arch_state(ctx, state) != 0) begin
+            `uvm_error(get_type_name(), "Failed to read architectural state from Spike")
+            return;
+        end
+        
         for (int i = 0; i < 32; i++) begin
-            spike_xregs[i] = spike_read_xreg(i);
-            spike_fregs[i] = spike_read_freg(i);
+            spike_xregs[i] = state[SPIKE_STATE_XREG + i];
+            spike_fregs[i] = state[SPIKE_STATE_FREG + i];
         end
         
-        spike_pc = spike_read_pc();
-        spike_fcsr = spike_read_csr(32'h003);  // fcsr
+        spike_pc = state[SPIKE_STATE_PC];
+        spike_fcsr = state[SPIKE_STATE_FCSR];
     endfunction
     
     //===========================================
@@ -173,6 +792,23 @@ class spike_reference_model extends uvm_component;
         return spike_pc;
     endfunction
     
+    //===========================================
+    // Get Commit Record of the Last Instruction
+    //===========================================
+    virtual function spike_commit_t get_last_commit();
+        return last_commit;
+    endfunction
+    
+    //===========================================
+    // Get the Exception Raised by the Last Instruction
+    //===========================================
+    // Returns 1 and the trap record if the last execute_instruction()
+    // trapped, 0 if it retired.
+    virtual function bit get_last_trap(output spike_trap_t trap);
+        trap = last_trap;
+        return last_trapped;
+    endfunction
+    
     //===========================================
     // Get Expected FCSR
     //===========================================
@@ -180,6 +816,24 @@ class spike_reference_model extends uvm_component;
         return spike_fcsr;
     endfunction
     
+    //===========================================
+    // Write the Shadow Copies Back to Spike
+    //===========================================
+    virtual function void push_shadow_state();
+        int state[SPIKE_ARCH_STATE_WORDS];
+        
+        for (int i = 0; i < 32; i++) begin
+            state[SPIKE_STATE_XREG + i] = spike_xregs[i];
+            state[SPIKE_STATE_FREG + i] = spike_fregs[i];
+        end
+        state[SPIKE_STATE_PC] = spike_pc;
+        state[SPIKE_STATE_FCSR] = spike_fcsr;
+        
+        if (spike_set_arch_state(ctx, state, '1) < 0) begin
+            `uvm_error(get_type_name(), "Failed to write shadow state back to Spike")
+        end
+    endfunction
+    
     //===========================================
     // Synchronize Spike with DUT State
     //===========================================
@@ -188,18 +842,106 @@ class spike_reference_model extends uvm_component;
         input logic [31:0] fregs[32],
         input logic [31:0] pc
     );
+        int state[SPIKE_ARCH_STATE_WORDS];
+        bit [SPIKE_ARCH_STATE_WORDS-1:0] dirty = '0;
+        
         if (!enabled) return;
         
-        // Write DUT state to Spike
+        // Prefetched results ran ahead of the shadow copies, so the
+        // shadows no longer describe Spike: rewrite everything
+        if (batch_results.size() > 0) begin
+            batch_results.delete();
+            batch_instructions.delete();
+            dirty = '1;
+        end
+        
+        // Only registers that differ from the shadow copies are sent
         for (int i = 0; i < 32; i++) begin
-            spike_write_xreg(i, xregs[i]);
-            spike_write_freg(i, fregs[i]);
+            state[SPIKE_STATE_XREG + i] = xregs[i];
+            state[SPIKE_STATE_FREG + i] = fregs[i];
+            if (xregs[i] !== spike_xregs[i]) dirty[SPIKE_STATE_XREG + i] = 1'b1;
+            if (fregs[i] !== spike_fregs[i]) dirty[SPIKE_STATE_FREG + i] = 1'b1;
         end
-        spike_write_pc(pc);
+        state[SPIKE_STATE_PC] = pc;
+        if (pc !== spike_pc) dirty[SPIKE_STATE_PC] = 1'b1;
         
-        update_shadow_registers();
+        // The DUT does not report FCSR; only rewritten on a full resync
+        state[SPIKE_STATE_FCSR] = spike_fcsr;
+        
+        if (dirty != '0 && spike_set_arch_state(ctx, state, dirty) < 0) begin
+            `uvm_error(get_type_name(), "Failed to write DUT state to Spike")
+        end
+        
+        spike_xregs = xregs;
+        spike_fregs = fregs;
+        spike_pc = pc;
+        
+        `uvm_info(get_type_name(),
+                 $sformatf("Spike synchronized with DUT state (%0d registers written)", $countones(dirty)),
+                 UVM_HIGH)
+    endfunction
+    
+    //===========================================
+    // Report Time Spent in the Golden Model
+    //===========================================
+    // The full per entry point table is printed by spike_close(); this
+    // summarizes it and lists the entry points by time at UVM_HIGH.
+    virtual function void report_call_stats();
+        longint stats[SPIKE_MAX_ENTRY_POINTS * SPIKE_CALL_STATS_WORDS];
+        longint total_calls = 0;
+        longint total_ns = 0;
+        int count = spike_get_stats(ctx, stats);
+        
+        if (count > SPIKE_MAX_ENTRY_POINTS) count = SPIKE_MAX_ENTRY_POINTS;
+        for (int i = 0; i < count; i++) begin
+            int base = i * SPIKE_CALL_STATS_WORDS;
+            if (stats[base] == 0) continue;
+            total_calls += stats[base];
+            total_ns += stats[base + 1];
+            `uvm_info(get_type_name(),
+                     $sformatf("%-26s %10d calls %10.3f ms  p50 %0d ns  p99 %0d ns",
+                              spike_get_stat_name(i), stats[base], stats[base + 1] / 1.0e6,
+                              stats[base + 3], stats[base + 5]),
+                     UVM_HIGH)
+        end
+        
+        `uvm_info(get_type_name(),
+                 $sformatf("Spike DPI: %0d calls, %.3f ms in the golden model (%.0f ns per instruction)",
+                          total_calls, total_ns / 1.0e6,
+                          (instructions_executed > 0) ? real'(total_ns) / instructions_executed : 0.0),
+                 UVM_LOW)
+    endfunction
+    
+    //===========================================
+    // Report FP Coverage Sampled in Spike
+    //===========================================
+    // Same layout as top_core_coverage's report, from the C++ bitmaps
+    virtual function void report_coverage();
+        string names[SPIKE_COV_GROUPS] = '{"FP Operand Class", "FP Result Class",
+                                           "FP Rounding x Flags", "FP Operand Pair"};
+        int counts[2 * SPIKE_COV_GROUPS];
+        int hit = 0;
+        int reachable = 0;
+        int samples = spike_coverage_counts(ctx, counts);
+        
+        if (samples < 0) return;
+        `uvm_info(get_type_name(), "=== Coverage Report ===", UVM_LOW)
+        for (int g = 0; g < SPIKE_COV_GROUPS; g++) begin
+            hit += counts[2 * g];
+            reachable += counts[2 * g + 1];
+            `uvm_info(get_type_name(),
+                     $sformatf("%s Coverage: %.2f%%", names[g],
+                              (counts[2 * g + 1] > 0) ? 100.0 * counts[2 * g] / counts[2 * g + 1] : 0.0),
+                     UVM_LOW)
+        end
+        `uvm_info(get_type_name(),
+                 $sformatf("Spike FP Coverage: %.2f%% (%0d of %0d bins, %0d instructions sampled)",
+                          (reachable > 0) ? 100.0 * hit / reachable : 0.0, hit, reachable, samples),
+                 UVM_LOW)
         
-        `uvm_info(get_type_name(), "Spike synchronized with DUT state", UVM_HIGH)
+        if (coverage_file != "" && spike_coverage_write(ctx, coverage_file) < 0) begin
+            `uvm_error(get_type_name(), $sformatf("Cannot write Spike coverage to %s", coverage_file))
+        end
     endfunction
     
     //===========================================
@@ -209,10 +951,29 @@ class spike_reference_model extends uvm_component;
         super.final_phase(phase);
         
         if (enabled) begin
-            spike_close();
+            if (trace_file != "") begin
+                `uvm_info(get_type_name(),
+                         $sformatf("Spike trace %s: %0d commits", trace_file, spike_trace_close(ctx)),
+                         UVM_LOW)
+            end
+            if (replay_file != "") begin
+                `uvm_info(get_type_name(),
+                         $sformatf("Spike replay %s: %0d results used", replay_file, spike_replay_close(ctx)),
+                         UVM_LOW)
+            end
+            if (stimulus_file != "") begin
+                flush_stimulus();
+                `uvm_info(get_type_name(),
+                         $sformatf("Spike stimulus %s: %0d segments", stimulus_file, stimulus_segments),
+                         UVM_LOW)
+            end
+            if (coverage || coverage_file != "") report_coverage();
+            report_call_stats();
+            spike_close(ctx);
+            ctx = null;
             `uvm_info(get_type_name(),
-                     $sformatf("Spike executed %0d instructions (%0d FP)",
-                              instructions_executed, fp_instructions),
+                     $sformatf("Spike executed %0d instructions (%0d FP, %0d trapped)",
+                              instructions_executed, fp_instructions, traps_taken),
                      UVM_LOW)
         end
     endfunction
@@ -252,8 +1013,14 @@ class top_core_scoreboard_spike extends uvm_scoreboard;
     bit enable_spike = 1;
     bit check_pc = 1;
     bit check_registers = 1;
-    bit check_fcsr = 0;  // Optional, may not be visible in your DUT outputs
-    real fp_tolerance = 0.00001;
+    bit check_fcsr = 0;  // fflags newly set in the DUT fcsr (monitor) against Spike
+    int ulp_tolerance = 0;  // Allowed FP result distance in ULPs; 0 compares bits exactly
+    string dut_trace = "";  // Text dump of DUT commits for spike_trace_diff
+    int dut_trace_fd = 0;
+    
+    // Transactions waiting for the Spike worker thread (async mode)
+    fpu_packet pending_items[$];
+    int pending_tickets[$];
     
     //===========================================
     // Constructor
@@ -271,7 +1038,18 @@ class top_core_scoreboard_spike extends uvm_scoreboard;
         
         // Get configuration
         void'(uvm_config_db#(bit)::get(this, "", "enable_spike", enable_spike));
-        void'(uvm_config_db#(real)::get(this, "", "fp_tolerance", fp_tolerance));
+        void'(uvm_config_db#(bit)::get(this, "", "check_fcsr", check_fcsr));
+        void'(uvm_config_db#(int)::get(this, "", "ulp_tolerance", ulp_tolerance));
+        void'(uvm_config_db#(string)::get(this, "", "dut_trace", dut_trace));
+        
+        if (dut_trace != "") begin
+            dut_trace_fd = $fopen(dut_trace, "w");
+            if (dut_trace_fd == 0) begin
+                `uvm_error(get_type_name(), $sformatf("Cannot open DUT trace %s", dut_trace))
+            end else begin
+                $fdisplay(dut_trace_fd, "# pc instruction rd value fflags mem_addr mem_data mem_op");
+            end
+        end
         
         // Create Spike model
         if (enable_spike) begin
@@ -288,10 +1066,39 @@ class top_core_scoreboard_spike extends uvm_scoreboard;
         if (enable_spike && spike_model != null) begin
             phase.raise_objection(this);
             spike_model.reset_spike();
+            configure_checker();
             phase.drop_objection(this);
         end
     endtask
     
+    //===========================================
+    // Configure the C++ Commit Checker
+    //===========================================
+    // The DUT only exposes FP results (dmem_dataOUT) and no destination
+    // index, so integer values and rd are not compared.
+    virtual function void configure_checker();
+        int mask = 0;
+        
+        if (check_pc)        mask |= SPIKE_CHECK_PC;
+        if (check_registers) mask |= SPIKE_CHECK_FREG;
+        if (check_fcsr)      mask |= SPIKE_CHECK_FFLAGS;
+        if (spike_set_check_config(spike_model.ctx, mask, ulp_tolerance) != SPIKE_OK) begin
+            `uvm_error(get_type_name(), "Cannot configure the Spike commit checker")
+        end
+    endfunction
+    
+    //===========================================
+    // Prefetch Golden Results for Known Stimulus
+    //===========================================
+    // Tests that know their instruction stream up front can hand it over
+    // here; Spike runs it in one DPI call and check_with_spike() then
+    // consumes the recorded results instead of stepping per instruction.
+    virtual function void prefetch_stimulus(input logic [31:0] instructions[$]);
+        if (enable_spike && spike_model != null) begin
+            void'(spike_model.execute_batch(instructions));
+        end
+    endfunction
+    
     //===========================================
     // Main Write Function
     //===========================================
@@ -305,8 +1112,14 @@ class top_core_scoreboard_spike extends uvm_scoreboard;
             fp_transactions++;
         end
         
+        if (dut_trace_fd != 0) begin
+            write_dut_trace(item);
+        end
+        
         // Execute in Spike and compare
-        if (enable_spike && spike_model != null) begin
+        if (enable_spike && spike_model != null && spike_model.async_mode) begin
+            submit_to_spike(item);
+        end else if (enable_spike && spike_model != null) begin
             check_with_spike(item);
         end else begin
             // Fallback to simple checking
@@ -315,71 +1128,106 @@ class top_core_scoreboard_spike extends uvm_scoreboard;
     endfunction
     
     //===========================================
-    // Check Transaction Against Spike
+    // Record the DUT Side of the Commit Trace
     //===========================================
-    virtual function void check_with_spike(fpu_packet item);
-        bit passed = 1;
-        string error_msg = "";
-        logic [31:0] spike_result, spike_pc_exp;
-        real dut_val, spike_val, error;
+    // One spike_trace_diff text line per transaction. Only the PC, the
+    // instruction, FP results and fflags are visible on the DUT ports;
+    // the rest is written as '-' so the diff tool skips it.
+    virtual function void write_dut_trace(fpu_packet item);
+        string value = "-";
+        string fflags = "-";
         
-        // Execute instruction in Spike
-        spike_model.execute_instruction(item.instruction);
-        
-        // Get expected values from Spike
-        spike_pc_exp = spike_model.get_expected_pc();
+        if (item.instr_category == INSTR_CAT_FLOAT && !$isunknown(item.dmem_dataOUT)) begin
+            value = $sformatf("%08h", item.dmem_dataOUT);
+        end
+        if (!$isunknown(item.fflags)) begin
+            fflags = $sformatf("%02h", item.fflags);
+        end
+        $fdisplay(dut_trace_fd, "%08h %08h - %s %s - - -",
+                  item.pc_curr, item.instruction, value, fflags);
+    endfunction
+    
+    //===========================================
+    // Queue Transaction for the Spike Worker
+    //===========================================
+    // Spike runs on its own thread while simulation continues; finished
+    // results are compared in order here and in check_phase().
+    virtual function void submit_to_spike(fpu_packet item);
+        int ticket = spike_model.submit_instruction(item.instruction);
         
-        //---------------------------------------
-        // Check 1: PC Progression
-        //---------------------------------------
-        if (check_pc && item.pc_curr != spike_pc_exp) begin
-            passed = 0;
-            error_msg = {error_msg, 
-                        $sformatf("\n  ✗ PC Mismatch:")};
-            error_msg = {error_msg,
-                        $sformatf("\n    Expected (Spike): 0x%08h", spike_pc_exp)};
-            error_msg = {error_msg,
-                        $sformatf("\n    Got (DUT):        0x%08h", item.pc_curr)};
-            pc_mismatches++;
+        if (ticket < 0) begin
+            // Queue full or worker unavailable: settle the backlog and
+            // check this one synchronously
+            collect_spike_results(1);
+            check_with_spike(item);
+            return;
         end
         
-        //---------------------------------------
-        // Check 2: FP Register Results
-        //---------------------------------------
-        if (item.instr_category == INSTR_CAT_FLOAT && check_registers) begin
-            // For FP operations that write to FP registers
-            if (item.opcode inside {OP_FP, OP_FMADD, OP_FMSUB, OP_FNMSUB, OP_FNMADD, OP_FLW}) begin
-                spike_result = spike_model.get_expected_freg(item.rd);
-                
-                // Convert to real for tolerance-based comparison
-                dut_val = $bitstoshortreal(item.dmem_dataOUT);  // Assuming result appears here
-                spike_val = $bitstoshortreal(spike_result);
-                error = $abs(dut_val - spike_val);
-                
-                // Check if values match within tolerance
-                if (error > fp_tolerance && !is_special_value(spike_result)) begin
-                    passed = 0;
-                    error_msg = {error_msg,
-                                $sformatf("\n  ✗ FP Register f%0d Mismatch for %s:", 
-                                         item.rd, item.get_instruction_name())};
-                    error_msg = {error_msg,
-                                $sformatf("\n    Expected (Spike): 0x%08h (%f)", 
-                                         spike_result, spike_val)};
-                    error_msg = {error_msg,
-                                $sformatf("\n    Got (DUT):        0x%08h (%f)", 
-                                         item.dmem_dataOUT, dut_val)};
-                    error_msg = {error_msg,
-                                $sformatf("\n    Error:            %e (tolerance: %e)", 
-                                         error, fp_tolerance)};
-                    freg_mismatches++;
-                end
+        pending_items.push_back(item);
+        pending_tickets.push_back(ticket);
+        collect_spike_results(0);
+    endfunction
+    
+    //===========================================
+    // Compare Finished Async Results
+    //===========================================
+    virtual function void collect_spike_results(bit wait);
+        spike_commit_t commit;
+        int status;
+        
+        while (pending_tickets.size() > 0) begin
+            status = spike_model.poll_result(pending_tickets[0], commit, wait);
+            if (status == 0) break;
+            
+            void'(pending_tickets.pop_front());
+            if (status > 0) begin
+                compare_commit(pending_items.pop_front(), commit);
+            end else begin
+                void'(pending_items.pop_front());
+                failed_transactions++;
+                spike_mismatches++;
             end
         end
+    endfunction
+    
+    //===========================================
+    // Check Phase - Drain the Async Backlog
+    //===========================================
+    virtual function void check_phase(uvm_phase phase);
+        super.check_phase(phase);
+        
+        if (enable_spike && spike_model != null) begin
+            collect_spike_results(1);
+        end
+    endfunction
+    
+    //===========================================
+    // Check Transaction Against Spike
+    //===========================================
+    virtual function void check_with_spike(fpu_packet item);
+        // Execute instruction in Spike
+        spike_model.execute_instruction(item.instruction);
+        compare_commit(item, spike_model.get_last_commit());
+    endfunction
+    
+    //===========================================
+    // Compare DUT Transaction with a Commit Record
+    //===========================================
+    virtual function void compare_commit(fpu_packet item, spike_commit_t commit);
+        string error_msg;
+        int status;
+        
+        // PC, FP result (NaN/Inf/signed zero aware, within ulp_tolerance)
+        // and fflags are compared in C++; unobserved DUT fields pass -1
+        status = spike_check_commit(spike_model.ctx, commit, item.pc_curr, -1,
+                                    item.dmem_dataOUT,  // Assuming result appears here
+                                    $isunknown(item.fflags) ? -1 : int'(item.fflags),
+                                    error_msg);
         
         //---------------------------------------
         // Update Statistics
         //---------------------------------------
-        if (passed) begin
+        if (status == 0) begin
             passed_transactions++;
             `uvm_info(get_type_name(),
                      $sformatf("✓ PASS [%0d]: %s (PC: 0x%08h)", 
@@ -418,14 +1266,15 @@ class top_core_scoreboard_spike extends uvm_scoreboard;
     endfunction
     
     //===========================================
-    // Helper: Check for Special FP Values
+    // Final Phase - Close the DUT Trace
     //===========================================
-    virtual function bit is_special_value(logic [31:0] fp_value);
-        logic [7:0] exp = fp_value[30:23];
-        logic [22:0] mantissa = fp_value[22:0];
+    virtual function void final_phase(uvm_phase phase);
+        super.final_phase(phase);
         
-        // Check for NaN or Infinity
-        return (exp == 8'hFF);
+        if (dut_trace_fd != 0) begin
+            $fclose(dut_trace_fd);
+            dut_trace_fd = 0;
+        end
     endfunction
     
     //===========================================
@@ -433,9 +1282,25 @@ class top_core_scoreboard_spike extends uvm_scoreboard;
     //===========================================
     virtual function void report_phase(uvm_phase phase);
         real pass_rate, spike_accuracy;
+        int stats[SPIKE_CHECK_STATS_WORDS];
         
         super.report_phase(phase);
         
+        // Mismatch categories are counted by the C++ checker
+        if (enable_spike && spike_model != null &&
+            spike_get_check_stats(spike_model.ctx, stats) == 0) begin
+            pc_mismatches   = stats[SPIKE_STAT_PC];
+            freg_mismatches = stats[SPIKE_STAT_FREG];
+            xreg_mismatches = stats[SPIKE_STAT_XREG];
+            fcsr_mismatches = stats[SPIKE_STAT_FFLAGS];
+            if (stats[SPIKE_STAT_MAX_ULP] > 0) begin
+                `uvm_info(get_type_name(),
+                         $sformatf("Largest accepted FP distance: %0d ULP (tolerance: %0d)",
+                                  stats[SPIKE_STAT_MAX_ULP], ulp_tolerance),
+                         UVM_LOW)
+            end
+        end
+        
         if (total_transactions > 0) begin
             pass_rate = 100.0 * passed_transactions / total_transactions;
         end else begin
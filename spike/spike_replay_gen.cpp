@@ -0,0 +1,61 @@
+/*******************************************************************************
+ * Spike Replay Results Generator
+ *
+ * Offline front end to spike_replay_generate(): runs a stimulus file
+ * through Spike on every host core and writes the results file that
+ * spike_replay_open() consumes at simulation time. A test run with the
+ * "spike_stimulus" config set writes the stimulus file.
+ *
+ * Usage: spike_replay_gen [-j threads] [-d] [-i isa] stimulus results
+ *   -j  Worker threads (default: all host cores)
+ *   -d  Generate with direct injection (library built with
+ *       -DSPIKE_DIRECT_INJECT); results are the same either way
+ *   -i  ISA string (default RV32IF)
+ *
+ * Compile (against the DPI library; the simulator's svdpi symbols it
+ * references are never called here):
+ *   g++ -O2 -o spike_replay_gen spike_replay_gen.cpp -L. -lspike_wrapper \
+ *       -Wl,--allow-shlib-undefined -Wl,-rpath,'$ORIGIN'
+ ******************************************************************************/
+
+#include <iostream>
+#include <cstdlib>
+#include <unistd.h>
+
+extern "C" int spike_replay_generate(const char* isa_string, const char* stimulus_path,
+                                     const char* results_path, int threads, int direct_inject);
+
+static void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [-j threads] [-d] [-i isa] stimulus results" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    const char* isa = "RV32IF";
+    int threads = 0;
+    int direct_inject = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:di:h")) != -1) {
+        switch (opt) {
+            case 'j':
+                threads = atoi(optarg);
+                break;
+            case 'd':
+                direct_inject = 1;
+                break;
+            case 'i':
+                isa = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    int results = spike_replay_generate(isa, argv[optind], argv[optind + 1], threads, direct_inject);
+    return (results < 0) ? 1 : 0;
+}
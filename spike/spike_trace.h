@@ -0,0 +1,52 @@
+/*******************************************************************************
+ * Spike Commit Trace Format
+ *
+ * Binary trace written by spike_trace_open() in spike_wrapper.cpp and read
+ * by spike_trace_diff. A file is one header followed by fixed-size records
+ * in execution order, host byte order. Records are only ever appended, so
+ * the record count is (file size - header) / record_size and a trace cut
+ * short by a crash is still readable up to its last whole record.
+ ******************************************************************************/
+
+#ifndef SPIKE_TRACE_H
+#define SPIKE_TRACE_H
+
+#include <cstdint>
+
+#define SPIKE_TRACE_MAGIC   "SPKTRACE"
+#define SPIKE_TRACE_VERSION 3u
+
+typedef struct {
+    char magic[8];              // SPIKE_TRACE_MAGIC, not NUL terminated
+    uint32_t version;           // SPIKE_TRACE_VERSION
+    uint32_t record_size;       // sizeof(spike_trace_record_t)
+    uint32_t reserved[4];
+} spike_trace_header_t;
+
+// One executed instruction. rd, value and the mem_ fields carry the same
+// meaning as in spike_commit_t; an instruction that raised an exception
+// wrote nothing, and its trap fields hold the trap CSRs it left behind.
+typedef struct {
+    uint32_t pc;                // PC after the instruction retires
+    uint32_t instruction;       // Encoding executed
+    uint32_t rd;                // [4:0] index, [5] FP register file, [8] valid
+    uint32_t value;             // Value written to the destination register
+    uint32_t fflags;            // fflags newly set (fcsr_delta[4:0]; frm changes are not kept)
+    uint32_t mem_addr;          // Data memory address accessed
+    uint32_t mem_data;          // Data loaded or stored
+    uint32_t mem_op;            // [1:0] 0 none, 1 load, 2 store; [7:4] size in bytes
+    uint32_t trap;              // SPIKE_TRACE_TRAP | mcause if it trapped, else 0
+    uint32_t tval;              // mtval of the trap
+    uint32_t epc;               // mepc of the trap
+    uint32_t operands;          // Digest of the source operands it read (operand_digest()
+                                // in spike_wrapper.cpp), checked by replay
+} spike_trace_record_t;
+
+#define SPIKE_TRACE_TRAP    (1u << 31)  // Only exceptions are recorded, so mcause bit 31 is free
+
+#define SPIKE_TRACE_FIELDS (sizeof(spike_trace_record_t) / sizeof(uint32_t))
+
+static_assert(sizeof(spike_trace_header_t) == 32, "trace header layout");
+static_assert(sizeof(spike_trace_record_t) == 48, "trace record layout");
+
+#endif // SPIKE_TRACE_H
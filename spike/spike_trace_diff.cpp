@@ -0,0 +1,427 @@
+/*******************************************************************************
+ * Spike Commit Trace Diff
+ *
+ * Finds the first executed instruction where two commit traces disagree and
+ * prints it with the records around it. Either input may be a binary trace
+ * recorded by spike_trace_open() (spike_trace.h, read through mmap) or a
+ * text dump from the DUT side with one record per line:
+ *
+ *   pc instruction rd value fflags mem_addr mem_data mem_op trap tval epc operands
+ *
+ * in hex. A field written as '-' or containing 'x' was not observed and is
+ * not compared for that record; missing trailing fields count as '-'.
+ * Blank lines and lines starting with '#' are skipped.
+ *
+ * Usage: spike_trace_diff [-c context] [-i field,...] expected actual
+ *   -c  Records of context shown around the divergence (default 5)
+ *   -i  Fields never compared (pc, instruction, rd, value, fflags,
+ *       mem_addr, mem_data, mem_op, trap, tval, epc, operands; mem for
+ *       the three mem_ fields)
+ *
+ * Exit status: 0 identical, 1 diverged, 2 usage or file error.
+ *
+ * Compile: g++ -O2 -o spike_trace_diff spike_trace_diff.cpp
+ ******************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "spike_trace.h"
+
+// Bit i of a field mask selects word i of spike_trace_record_t
+#define FIELD_ALL ((1u << SPIKE_TRACE_FIELDS) - 1)
+
+// Records compared per memcmp() on the unmasked path
+#define DIFF_CHUNK_RECORDS 65536u
+
+static const char* const k_field_names[SPIKE_TRACE_FIELDS] = {
+    "pc", "instruction", "rd", "value", "fflags", "mem_addr", "mem_data", "mem_op",
+    "trap", "tval", "epc", "operands"
+};
+
+// One input, either mapped from a binary trace or parsed from a text dump
+typedef struct {
+    std::string path;
+    const spike_trace_record_t* records = nullptr;
+    size_t count = 0;
+    void* map = nullptr;
+    size_t map_size = 0;
+    std::vector<spike_trace_record_t> parsed;
+    std::vector<uint16_t> observed;     // Per record field mask; empty if all observed
+} trace_input_t;
+
+//==============================================================================
+// Input Loading
+//==============================================================================
+
+/**
+ * Map a binary trace
+ * @return false on error (message already printed)
+ */
+static bool map_binary(trace_input_t& in, int fd, size_t size) {
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        std::cerr << "ERROR: Cannot map " << in.path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const spike_trace_header_t* header = (const spike_trace_header_t*)map;
+    if (header->version != SPIKE_TRACE_VERSION ||
+        header->record_size != sizeof(spike_trace_record_t)) {
+        std::cerr << "ERROR: " << in.path << " is trace version " << header->version
+                  << " with " << header->record_size << "-byte records; expected version "
+                  << SPIKE_TRACE_VERSION << " with " << sizeof(spike_trace_record_t) << std::endl;
+        munmap(map, size);
+        return false;
+    }
+
+    size_t body = size - sizeof(spike_trace_header_t);
+    if (body % sizeof(spike_trace_record_t) != 0) {
+        std::cerr << "WARNING: " << in.path << " ends in a partial record, ignored" << std::endl;
+    }
+
+    in.map = map;
+    in.map_size = size;
+    in.records = (const spike_trace_record_t*)((const char*)map + sizeof(spike_trace_header_t));
+    in.count = body / sizeof(spike_trace_record_t);
+    return true;
+}
+
+/**
+ * True for a text field the DUT did not observe: '-' or any X digit
+ */
+static bool is_unobserved(const std::string& token) {
+    size_t digits = (token.compare(0, 2, "0x") == 0) ? 2 : 0;
+    return token == "-" || token.find_first_of("xX", digits) != std::string::npos;
+}
+
+/**
+ * Parse a text dump
+ * @return false on error (message already printed)
+ */
+static bool parse_text(trace_input_t& in) {
+    std::ifstream file(in.path);
+    if (!file) {
+        std::cerr << "ERROR: Cannot open " << in.path << std::endl;
+        return false;
+    }
+
+    bool partial = false;
+    std::string line;
+    size_t line_no = 0;
+
+    while (std::getline(file, line)) {
+        line_no++;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+
+        std::istringstream tokens(line);
+        std::string token;
+        uint32_t words[SPIKE_TRACE_FIELDS] = {};
+        uint16_t observed = 0;
+        size_t field = 0;
+
+        while (tokens >> token) {
+            if (field == SPIKE_TRACE_FIELDS) {
+                std::cerr << "ERROR: " << in.path << ":" << line_no << ": more than "
+                          << SPIKE_TRACE_FIELDS << " fields" << std::endl;
+                return false;
+            }
+            if (!is_unobserved(token)) {
+                char* end;
+                unsigned long v = strtoul(token.c_str(), &end, 16);
+                if (*end != '\0') {
+                    std::cerr << "ERROR: " << in.path << ":" << line_no << ": bad "
+                              << k_field_names[field] << " '" << token << "'" << std::endl;
+                    return false;
+                }
+                words[field] = (uint32_t)v;
+                observed |= (uint16_t)(1u << field);
+            }
+            field++;
+        }
+
+        spike_trace_record_t rec;
+        memcpy(&rec, words, sizeof(rec));
+        in.parsed.push_back(rec);
+        in.observed.push_back(observed);
+        partial |= (observed != FIELD_ALL);
+    }
+
+    if (!partial) in.observed.clear();
+    in.records = in.parsed.data();
+    in.count = in.parsed.size();
+    return true;
+}
+
+/**
+ * Load an input, telling binary traces from text dumps by the magic
+ */
+static bool load_input(trace_input_t& in, const std::string& path) {
+    in.path = path;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "ERROR: Cannot open " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    char magic[sizeof(spike_trace_header_t::magic)] = {};
+    bool binary = fstat(fd, &st) == 0 &&
+                  (size_t)st.st_size >= sizeof(spike_trace_header_t) &&
+                  pread(fd, magic, sizeof(magic), 0) == (ssize_t)sizeof(magic) &&
+                  memcmp(magic, SPIKE_TRACE_MAGIC, sizeof(magic)) == 0;
+
+    bool ok = binary ? map_binary(in, fd, (size_t)st.st_size) : parse_text(in);
+    close(fd);
+    return ok;
+}
+
+static void release_input(trace_input_t& in) {
+    if (in.map != nullptr) munmap(in.map, in.map_size);
+    in.map = nullptr;
+}
+
+//==============================================================================
+// Comparison
+//==============================================================================
+
+static uint32_t observed_fields(const trace_input_t& in, size_t i) {
+    return in.observed.empty() ? FIELD_ALL : in.observed[i];
+}
+
+/**
+ * Fields of record i that differ, limited to those both sides observed
+ */
+static uint32_t differing_fields(const trace_input_t& a, const trace_input_t& b,
+                                 size_t i, uint32_t compare) {
+    const uint32_t* wa = (const uint32_t*)&a.records[i];
+    const uint32_t* wb = (const uint32_t*)&b.records[i];
+    uint32_t mask = compare & observed_fields(a, i) & observed_fields(b, i);
+    uint32_t diff = 0;
+
+    for (size_t f = 0; f < SPIKE_TRACE_FIELDS; f++) {
+        diff |= (uint32_t)(wa[f] != wb[f]) << f;
+    }
+    return diff & mask;
+}
+
+/**
+ * Index of the first record that differs within the common length
+ * @return count if all records match
+ */
+static size_t first_divergence(const trace_input_t& a, const trace_input_t& b,
+                               size_t count, uint32_t compare) {
+    if (compare == FIELD_ALL && a.observed.empty() && b.observed.empty()) {
+        // Every field of every record counts: compare raw memory in large
+        // chunks and only look at single records inside a chunk that differs
+        for (size_t base = 0; base < count; base += DIFF_CHUNK_RECORDS) {
+            size_t n = std::min<size_t>(DIFF_CHUNK_RECORDS, count - base);
+            if (memcmp(a.records + base, b.records + base, n * sizeof(spike_trace_record_t)) == 0) {
+                continue;
+            }
+            for (size_t i = base; i < base + n; i++) {
+                if (memcmp(&a.records[i], &b.records[i], sizeof(spike_trace_record_t)) != 0) return i;
+            }
+        }
+        return count;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (differing_fields(a, b, i, compare) != 0) return i;
+    }
+    return count;
+}
+
+//==============================================================================
+// Reporting
+//==============================================================================
+
+static std::string format_rd(uint32_t rd) {
+    char text[8];
+    if (!(rd & (1u << 8))) return "-";
+    snprintf(text, sizeof(text), "%c%u", (rd & (1u << 5)) ? 'f' : 'x', rd & 0x1Fu);
+    return text;
+}
+
+/**
+ * One record as a single line; fields the input did not observe print as '-'
+ */
+static std::string format_record(const trace_input_t& in, size_t i) {
+    if (i >= in.count) return "<end of trace>";
+
+    const spike_trace_record_t& r = in.records[i];
+    uint32_t seen = observed_fields(in, i);
+    const uint32_t* w = (const uint32_t*)&r;
+    char field[SPIKE_TRACE_FIELDS][16];
+
+    for (size_t f = 0; f < SPIKE_TRACE_FIELDS; f++) {
+        if (!(seen & (1u << f))) snprintf(field[f], sizeof(field[f]), "-");
+        else snprintf(field[f], sizeof(field[f]), "%08x", w[f]);
+    }
+    if (seen & (1u << 2)) snprintf(field[2], sizeof(field[2]), "%s", format_rd(r.rd).c_str());
+    if (seen & (1u << 4)) snprintf(field[4], sizeof(field[4]), "%02x", r.fflags & 0xFFu);
+
+    const char* mem = "";
+    switch (r.mem_op & 3u) {
+        case 1:  mem = "ld"; break;
+        case 2:  mem = "st"; break;
+        default: break;
+    }
+
+    char line[160];
+    if ((seen & (1u << 7)) && (r.mem_op & 3u)) {
+        snprintf(line, sizeof(line), "pc=%s insn=%s rd=%-3s val=%s ff=%s %s%u [%s]=%s",
+                 field[0], field[1], field[2], field[3], field[4],
+                 mem, (r.mem_op >> 4) & 0xFu, field[5], field[6]);
+    } else {
+        snprintf(line, sizeof(line), "pc=%s insn=%s rd=%-3s val=%s ff=%s",
+                 field[0], field[1], field[2], field[3], field[4]);
+    }
+
+    std::string text = line;
+    if ((seen & (1u << 8)) && (r.trap & SPIKE_TRACE_TRAP)) {
+        snprintf(line, sizeof(line), " trap=%u tval=%s epc=%s",
+                 r.trap & ~SPIKE_TRACE_TRAP, field[9], field[10]);
+        text += line;
+    }
+    return text;
+}
+
+static void report_divergence(const trace_input_t& a, const trace_input_t& b,
+                              size_t index, uint32_t compare, size_t context) {
+    std::cout << "First divergence at record " << index << std::endl;
+
+    if (index < a.count && index < b.count) {
+        uint32_t diff = differing_fields(a, b, index, compare);
+        const uint32_t* wa = (const uint32_t*)&a.records[index];
+        const uint32_t* wb = (const uint32_t*)&b.records[index];
+        char line[96];
+
+        for (size_t f = 0; f < SPIKE_TRACE_FIELDS; f++) {
+            if (!(diff & (1u << f))) continue;
+            snprintf(line, sizeof(line), "  %-12s expected 0x%08x  actual 0x%08x",
+                     k_field_names[f], wa[f], wb[f]);
+            std::cout << line << std::endl;
+        }
+    } else {
+        const trace_input_t& longer = (a.count > b.count) ? a : b;
+        const trace_input_t& shorter = (a.count > b.count) ? b : a;
+        std::cout << "  " << shorter.path << " ends after " << shorter.count << " records; "
+                  << longer.path << " has " << (longer.count - shorter.count)
+                  << " more" << std::endl;
+    }
+
+    std::cout << std::endl << "  expected: " << a.path << std::endl
+              << "  actual:   " << b.path << std::endl;
+
+    size_t first = (index > context) ? index - context : 0;
+    size_t last = index + context;
+    for (size_t i = first; i <= last && (i < a.count || i < b.count); i++) {
+        const char* marker = (i == index) ? ">>" : "  ";
+        char label[32];
+        snprintf(label, sizeof(label), "%s %10zu", marker, i);
+        std::cout << label << " E " << format_record(a, i) << std::endl
+                  << "              A " << format_record(b, i) << std::endl;
+    }
+}
+
+//==============================================================================
+// Main
+//==============================================================================
+
+static void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [-c context] [-i field,...] expected actual" << std::endl;
+}
+
+/**
+ * Parse the -i list into a mask of fields to skip
+ * @return false on an unknown field name
+ */
+static bool parse_ignore(const char* list, uint32_t* ignore) {
+    std::stringstream names(list);
+    std::string name;
+
+    while (std::getline(names, name, ',')) {
+        if (name == "mem") {
+            *ignore |= (1u << 5) | (1u << 6) | (1u << 7);
+            continue;
+        }
+        size_t f = 0;
+        while (f < SPIKE_TRACE_FIELDS && name != k_field_names[f]) f++;
+        if (f == SPIKE_TRACE_FIELDS) {
+            std::cerr << "ERROR: Unknown field '" << name << "'" << std::endl;
+            return false;
+        }
+        *ignore |= 1u << f;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    size_t context = 5;
+    uint32_t ignore = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:i:h")) != -1) {
+        switch (opt) {
+            case 'c':
+                context = strtoul(optarg, nullptr, 10);
+                break;
+            case 'i':
+                if (!parse_ignore(optarg, &ignore)) return 2;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    trace_input_t expected, actual;
+    if (!load_input(expected, argv[optind]) || !load_input(actual, argv[optind + 1])) {
+        release_input(expected);
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t compare = FIELD_ALL & ~ignore;
+    size_t common = std::min(expected.count, actual.count);
+    size_t index = first_divergence(expected, actual, common, compare);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int status = 0;
+    if (index < common || expected.count != actual.count) {
+        report_divergence(expected, actual, index, compare, context);
+        status = 1;
+    } else {
+        std::cout << "Traces match: " << common << " records" << std::endl;
+    }
+
+    char rate[96];
+    snprintf(rate, sizeof(rate), "Compared %zu records in %.3f s (%.0f MB/s)", index,
+             seconds, (seconds > 0) ? 2.0 * index * sizeof(spike_trace_record_t) / seconds / 1e6 : 0.0);
+    std::cout << rate << std::endl;
+
+    release_input(expected);
+    release_input(actual);
+    return status;
+}
@@ -5,13 +5,43 @@
  * for use as a golden reference model in UVM testbenches.
  * 
  * Compile: g++ -shared -fPIC -o libspike_wrapper.so spike_wrapper.cpp \
- *          -I$RISCV/include -L$RISCV/lib -lriscv
+ *          -I$RISCV/include -L$RISCV/lib -lriscv -pthread
+ *
+ * Direct injection (spike_set_direct_inject()) decodes through
+ * processor_t::decode_insn(), which stock Spike keeps private. It is only
+ * built with -DSPIKE_DIRECT_INJECT, against a Spike whose riscv/processor.h
+ * declares decode_insn() in the public section of processor_t.
  ******************************************************************************/
 
-#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstdarg>
 #include <vector>
 #include <cstring>
+#include <strings.h>
+#include <cstdint>
+#include <cstddef>
+#include <tuple>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <stdexcept>
+#include <chrono>
+#include <cmath>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <elf.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 #include "svdpi.h"
+#include "spike_trace.h"
+#include "spike_coverage.h"
 
 // Spike headers
 #include "riscv/sim.h"
@@ -19,353 +49,4012 @@
 #include "riscv/processor.h"
 #include "riscv/decode.h"
 
-// Global Spike simulator instance
-static sim_t* g_spike_sim = nullptr;
-static processor_t* g_spike_proc = nullptr;
-static bool g_spike_initialized = false;
+// Copy-on-write tracking of one memory region. While a checkpoint is held
+// the page-aligned part of the region is write-protected; the first write
+// to a page faults, and the fault handler saves the page's pre-image into
+// the shadow mapping before unprotecting it. Pages whose digest is cached
+// are write-protected the same way, and a write marks the digest stale.
+typedef struct {
+    char* host;          // First page-aligned byte of the region
+    size_t npages;       // Number of tracked pages
+    char* shadow;        // Pre-images, one slot per page (lazily committed)
+    uint8_t* saved;      // saved[i] != 0 once page i's pre-image is held
+    uint32_t* dirty;     // Pages saved since the checkpoint, in fault order
+    size_t ndirty;
+    bool armed;          // Saving pre-images; false until spike_checkpoint()
+    
+    // Cached XXH64 of each SPIKE_DIGEST_PAGE of the region, by offset from
+    // its start, and whether the page was written since it was hashed.
+    // Both stay null until the region is first digested.
+    size_t ndigest;
+    uint64_t* digests;
+    uint8_t* stale;
+    
+    // Unaligned head/tail bytes outside the tracked pages, copied eagerly
+    char* head;
+    std::vector<char> head_copy;
+    char* tail;
+    std::vector<char> tail_copy;
+} spike_cow_region_t;
+
+// Hart and memory snapshot taken by spike_checkpoint()
+typedef struct {
+    bool valid = false;
+    reg_t xpr[NXPR];
+    freg_t fpr[NFPR];
+    reg_t pc;
+    uint32_t fcsr;
+    reg_t minstret;
+    
+    // Trap state enter_trap() and stimulus change
+    reg_t mstatus;
+    reg_t mepc;
+    reg_t mcause;
+    reg_t mtval;
+    reg_t mtvec;
+    reg_t prv;
+} spike_checkpoint_t;
+
+// Result of spike_check_commit(): 0 on a match, else a mask of the fields
+// that differ. The same bits select which fields are checked.
+#define SPIKE_CHECK_PC      (1u << 0)
+#define SPIKE_CHECK_RD      (1u << 1)
+#define SPIKE_CHECK_FREG    (1u << 2)   // FP destination value
+#define SPIKE_CHECK_XREG    (1u << 3)   // Integer destination value
+#define SPIKE_CHECK_FFLAGS  (1u << 4)
+#define SPIKE_CHECK_ALL     0x1Fu
+
+// Running totals kept by spike_check_commit(); read with
+// spike_get_check_stats() as a flat int array in this order
+typedef struct {
+    uint32_t checks;
+    uint32_t passed;
+    uint32_t pc_mismatches;
+    uint32_t rd_mismatches;
+    uint32_t freg_mismatches;
+    uint32_t xreg_mismatches;
+    uint32_t fflags_mismatches;
+    uint32_t max_ulp;           // Largest FP distance accepted within tolerance
+} spike_check_stats_t;
+
+#define SPIKE_CHECK_STATS_WORDS (sizeof(spike_check_stats_t) / sizeof(uint32_t))
+
+// Exported entry points with call statistics, in spike_get_stats() order
+#define SPIKE_ENTRY_POINTS(X) \
+    X(init) X(init_mem) X(reset) X(checkpoint) X(restore) \
+    X(read_freg) X(write_freg) X(read_xreg) X(write_xreg) X(read_pc) X(write_pc) \
+    X(read_csr) X(write_csr) X(get_arch_state) X(set_arch_state) \
+    X(execute_instruction) X(execute_commit) X(execute_trap) X(execute_batch) X(step_one) \
+    X(set_direct_inject) X(set_async) X(submit) X(poll_result) \
+    X(trace_open) X(trace_close) X(replay_open) X(replay_close) \
+    X(set_check_config) X(check_commit) X(get_check_stats) \
+    X(read_mem) X(write_mem) X(read_mem_block) X(write_mem_block) \
+    X(mem_digest) X(mem_page_hashes) \
+    X(load_elf) X(run_until) \
+    X(coverage_enable) X(coverage_write) X(coverage_counts)
+
+enum {
+#define SPIKE_EP_ENUM(name) SPIKE_EP_##name,
+    SPIKE_ENTRY_POINTS(SPIKE_EP_ENUM)
+#undef SPIKE_EP_ENUM
+    SPIKE_EP_COUNT
+};
+
+// Calls and time spent in one entry point. Latency is in timestamp
+// counter ticks; bucket i counts calls taking [2^i, 2^(i+1)) ticks.
+#define SPIKE_STATS_BUCKETS 32
+
+typedef struct {
+    uint64_t calls;
+    uint64_t ticks;
+    uint64_t max_ticks;
+    uint64_t hist[SPIKE_STATS_BUCKETS];
+} spike_call_stats_t;
+
+// spike_get_stats() words per entry point: calls, total ns, max ns,
+// then the p50, p90 and p99 latency bounds in ns
+#define SPIKE_CALL_STATS_WORDS 6
+
+struct spike_async;
+struct spike_trace;
+struct spike_replay;
+struct spike_coverage;
+
+// One independent golden model instance. SV holds a pointer to it as a
+// chandle returned by spike_init().
+typedef struct spike_ctx {
+    sim_t* sim = nullptr;
+    processor_t* proc = nullptr;
+    bool initialized = false;
+    
+    // Direct injection mode: instructions are executed from a per-encoding
+    // decode cache instead of being stored to memory and fetched by step()
+    bool direct_inject = false;
+    std::unordered_map<uint32_t, insn_func_t> decode_cache;
+    
+    // Memory regions handed to sim_t, and the checkpoint taken over them.
+    // Write tracking, once started for a checkpoint or a digest, keeps one
+    // tracker per region in the same order.
+    std::vector<std::pair<reg_t, mem_t*>> mems;
+    reg_t start_pc = 0;
+    spike_checkpoint_t checkpoint;
+    std::vector<spike_cow_region_t*> cow_regions;
+    
+    // Worker thread state while asynchronous mode is on, else null
+    struct spike_async* async = nullptr;
+    
+    // Commit checking: fields compared, FP tolerance, totals and the report
+    // of the last failing check
+    uint32_t check_mask = SPIKE_CHECK_ALL;
+    uint32_t ulp_tolerance = 0;
+    spike_check_stats_t check_stats = {};
+    std::string check_report;
+    
+    // Commit trace file while recording, else null
+    struct spike_trace* trace = nullptr;
+    
+    // Precomputed results being replayed, else null
+    struct spike_replay* replay = nullptr;
+    
+    // FP coverage bitmap once spike_coverage_enable() has been called
+    struct spike_coverage* coverage = nullptr;
+    
+    // Per entry point call counts and latency
+    spike_call_stats_t call_stats[SPIKE_EP_COUNT] = {};
+    
+    // Most recent failure, SPIKE_OK if none since spike_get_last_error()
+    int last_error = 0;
+    
+    // Symbol table of the program loaded by spike_load_elf()
+    std::unordered_map<std::string, uint64_t> elf_symbols;
+} spike_ctx_t;
+
+// Every context handed out. spike_close() releases what a context holds
+// but never frees or reuses the context itself, so a handle kept after
+// spike_close() still points at a valid (uninitialized) context and is
+// rejected cleanly instead of reaching a later instance.
+static std::vector<spike_ctx_t*> g_ctx_pool;
+
+// Regions currently write-protected, scanned by the SIGSEGV handler
+#define SPIKE_MAX_COW_REGIONS 64
+static std::atomic<spike_cow_region_t*> g_cow_regions[SPIKE_MAX_COW_REGIONS];
+static struct sigaction g_prev_segv_action;
+static bool g_segv_handler_installed = false;
+static size_t g_page_size = 0;
+
+// Granule of spike_mem_digest(), in simulated address space
+#define SPIKE_DIGEST_PAGE 4096
+
+// Per-instruction commit record of one step.
+// Word order matches the canonical svBitVecVal layout of the SV packed
+// struct spike_commit_t, where the last declared field lands in word 0.
+typedef struct {
+    uint32_t pc;          // PC after the instruction retires
+    uint32_t rd;          // Destination descriptor (see SPIKE_RD_* below)
+    uint32_t value;       // Value written to the destination register
+    uint32_t fcsr;        // FCSR after the instruction retires
+    uint32_t fcsr_delta;  // [4:0] fflags newly set, [7:5] frm bits changed
+    uint32_t mem_addr;    // Data memory address accessed
+    uint32_t mem_data;    // Data loaded or stored
+    uint32_t mem_op;      // [1:0] SPIKE_MEM_* access kind, [7:4] size in bytes
+} spike_commit_t;
+
+#define SPIKE_RD_INDEX_MASK 0x1Fu
+#define SPIKE_RD_FP         (1u << 5)   // Destination is in the FP register file
+#define SPIKE_RD_VALID      (1u << 8)   // Instruction wrote a destination register
+
+#define SPIKE_FFLAGS_MASK   0x1Fu
+#define SPIKE_FRM_MASK      0xE0u
+
+#define SPIKE_MEM_NONE      0u
+#define SPIKE_MEM_LOAD      1u
+#define SPIKE_MEM_STORE     2u
+
+// Exception raised by an instruction; matches the SV packed struct
+// spike_trap_t (epc in word 0)
+typedef struct {
+    uint32_t epc;         // PC of the instruction that trapped (mepc)
+    uint32_t tval;        // Faulting address or instruction bits (mtval)
+    uint32_t cause;       // Exception code (mcause)
+} spike_trap_t;
+
+// Asynchronous mode: the simulator thread submits instructions into a
+// single-producer/single-consumer ring and a worker thread steps Spike.
+// A slot is reused only after its result has been polled.
+#define SPIKE_ASYNC_RING_SIZE 1024u   // Power of two
+#define SPIKE_ASYNC_TICKET_MASK 0x7FFFFFFFu
+
+typedef struct {
+    uint32_t instruction;
+    int status;              // SPIKE_OK or SPIKE_ERR_EXECUTION
+    bool polled;
+    spike_commit_t commit;
+} spike_async_slot_t;
+
+typedef struct spike_async {
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> submitted{0};   // Written by the simulator thread
+    std::atomic<uint64_t> completed{0};   // Written by the worker
+    uint64_t retired = 0;                 // Oldest unpolled slot (simulator thread)
+    spike_async_slot_t slots[SPIKE_ASYNC_RING_SIZE];
+} spike_async_t;
+
+// Commit trace writer. Records are collected in a fixed buffer and
+// written out in large unbuffered chunks.
+#define SPIKE_TRACE_BUFFER_RECORDS 8192u
+
+typedef struct spike_trace {
+    FILE* file;
+    std::string path;
+    std::vector<spike_trace_record_t> buffer;
+    uint64_t records;
+    bool failed;
+} spike_trace_t;
+
+// Replay mode: a results file from spike_replay_generate() (commit trace
+// format) is mapped read-only and consumed one record per instruction
+typedef struct spike_replay {
+    const spike_trace_record_t* records;
+    size_t count;
+    size_t next;
+    void* map;
+    size_t map_size;
+} spike_replay_t;
+
+// FP functional coverage (bin layout in spike_coverage.h). Bins are
+// kept while sampling is off so they can still be written out.
+typedef struct spike_coverage {
+    uint64_t bins[SPIKE_COV_WORDS];
+    uint64_t samples;
+    bool sampling;
+} spike_coverage_t;
+
+// Stimulus for spike_replay_generate(), split into independent segments
+#define SPIKE_STIM_INSN 0
+#define SPIKE_STIM_XREG 1
+#define SPIKE_STIM_FREG 2
+#define SPIKE_STIM_PC   3
+#define SPIKE_STIM_FCSR 4
+
+typedef struct {
+    uint32_t kind;              // SPIKE_STIM_*
+    uint32_t index;             // Register number for XREG/FREG
+    uint32_t value;
+} spike_stim_op_t;
+
+typedef struct {
+    std::vector<spike_stim_op_t> ops;
+    size_t first_record;        // Offset of this segment's results
+    size_t instructions;
+} spike_stim_segment_t;
+
+// One entry of the memory map passed to spike_init_mem(); matches the SV
+// packed struct spike_mem_region_t (base in word 0)
+typedef struct {
+    uint32_t base;
+    uint32_t size;
+} spike_mem_region_t;
+
+// Stop conditions for spike_run_until()
+#define SPIKE_RUN_PC       0    // PC equals the target
+#define SPIKE_RUN_INSTRET  1    // Target more instructions have retired
+#define SPIKE_RUN_TOHOST   2    // Program wrote a non-zero value to tohost
+
+// Instructions per processor_t::step() call while running natively. The
+// stop condition is checked between calls, so PC stops use single steps.
+#define SPIKE_RUN_CHUNK    10000
+
+// Memory map used by spike_init(): 128MB at 0x80000000
+static const spike_mem_region_t g_default_mem_map[] = {
+    { 0x80000000u, 0x8000000u }
+};
+
+// Architectural state exchanged with spike_get/set_arch_state() as a flat
+// array of 32-bit words; bit i of the dirty mask selects word i.
+typedef struct {
+    uint32_t xregs[NXPR];
+    uint32_t fregs[NFPR];
+    uint32_t pc;
+    uint32_t fcsr;
+} spike_arch_state_t;
+
+#define SPIKE_ARCH_STATE_WORDS (sizeof(spike_arch_state_t) / sizeof(uint32_t))
+
+// Status codes. Entry points that return int give one of these on
+// failure, and every failure is also kept for spike_get_last_error() so
+// calls returning a value or a handle can be checked too.
+#define SPIKE_OK                    0
+#define SPIKE_TRAPPED               1   // Instruction raised an exception
+#define SPIKE_ERR_NOT_INITIALIZED  -1   // Handle does not name a live instance
+#define SPIKE_ERR_ARGUMENT         -2   // Bad register number, array size, ticket...
+#define SPIKE_ERR_STATE            -3   // Call not valid in the current mode
+#define SPIKE_ERR_EXECUTION        -4   // Spike raised an error
+#define SPIKE_ERR_IO               -5   // File could not be read, written or mapped
+#define SPIKE_ERR_BUSY             -6   // Asynchronous queue full
+#define SPIKE_ERR_CONFIG           -7   // Bad memory map or ISA, or a mode left out of the build
+#define SPIKE_ERR_LIMIT            -8   // Step limit reached before the stop condition
+
+// Diagnostic log severities. Messages below the level chosen with
+// spike_set_log_level() (default: SPIKE_LOG_LEVEL from the environment,
+// else info) are dropped before they are formatted.
+#define SPIKE_LOG_DEBUG 0
+#define SPIKE_LOG_INFO  1
+#define SPIKE_LOG_WARN  2
+#define SPIKE_LOG_ERROR 3
+#define SPIKE_LOG_OFF   4
+
+// Log messages are formatted straight into a lock-free multi-producer
+// ring and written out by a background flusher, so logging costs the
+// caller no I/O. A full ring drops messages (counted) instead of waiting.
+#define SPIKE_LOG_RING_SIZE   1024u      // Power of two
+#define SPIKE_LOG_MSG_BYTES   256
+#define SPIKE_LOG_FLUSH_MS    10
+
+// Each call site may log SPIKE_LOG_BURST messages per window; the rest
+// are counted and reported with the site's next message that gets out
+#define SPIKE_LOG_BURST       10u
+#define SPIKE_LOG_WINDOW_NS   1000000000ULL
+
+typedef struct {
+    std::atomic<uint64_t> seq;          // Ticket the slot is ready for
+    int level;
+    char text[SPIKE_LOG_MSG_BYTES];
+} spike_log_slot_t;
+
+// Rate limiting state, one per logging call site
+typedef struct {
+    std::atomic<uint64_t> window_start;
+    std::atomic<uint32_t> emitted;
+    std::atomic<uint32_t> suppressed;
+} spike_log_site_t;
+
+typedef struct spike_log {
+    spike_log_slot_t ring[SPIKE_LOG_RING_SIZE];
+    std::atomic<uint64_t> head{0};          // Next ticket to claim (producers)
+    uint64_t tail = 0;                      // Next ticket to write (under drain_lock)
+    std::atomic<uint64_t> dropped{0};       // Lost to a full ring
+    std::atomic<uint64_t> suppressed{0};    // Held back by rate limiting
+    std::atomic<bool> running{false};       // Flusher thread is up
+    std::once_flag started;
+    std::mutex drain_lock;
+    std::thread flusher;
+    std::string out;                        // Drain buffers, info and below
+    std::string err;                        // and warnings and errors
+} spike_log_t;
+
+//==============================================================================
+// Diagnostic Logging
+//==============================================================================
+
+static spike_log_t g_log;
+
+// Last failure on a handle that does not name a live instance
+static std::atomic<int> g_last_error(SPIKE_OK);
+
+/**
+ * Initial log level: SPIKE_LOG_LEVEL (debug, info, warn, error, off or
+ * the number) if set, else info
+ */
+static int log_level_from_env() {
+    static const char* const names[] = {"debug", "info", "warn", "error", "off"};
+    const char* env = getenv("SPIKE_LOG_LEVEL");
+    
+    if (env == nullptr || *env == '\0') return SPIKE_LOG_INFO;
+    if (env[0] >= '0' && env[0] <= '4' && env[1] == '\0') return env[0] - '0';
+    for (int i = SPIKE_LOG_DEBUG; i <= SPIKE_LOG_OFF; i++) {
+        if (strcasecmp(env, names[i]) == 0) return i;
+    }
+    return SPIKE_LOG_INFO;
+}
+
+static std::atomic<int> g_log_level(log_level_from_env());
+
+/**
+ * Write out every published message, in order
+ *
+ * Runs on the flusher thread, and on the caller's thread when the
+ * flusher is not running (before start-up, after shutdown, or if it
+ * could not be started). Info goes to stdout, warnings and errors to
+ * stderr, each with a single write and flush per drain.
+ */
+static void log_drain() {
+    std::lock_guard<std::mutex> guard(g_log.drain_lock);
+    
+    for (;;) {
+        spike_log_slot_t* slot = &g_log.ring[g_log.tail & (SPIKE_LOG_RING_SIZE - 1)];
+        if (slot->seq.load(std::memory_order_acquire) != g_log.tail + 1) break;
+        
+        (slot->level >= SPIKE_LOG_WARN ? g_log.err : g_log.out) += slot->text;
+        slot->seq.store(g_log.tail + SPIKE_LOG_RING_SIZE, std::memory_order_release);
+        g_log.tail++;
+    }
+    
+    uint64_t dropped = g_log.dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped != 0) {
+        g_log.err += "WARNING: " + std::to_string(dropped) + " Spike log messages dropped (ring full)\n";
+    }
+    
+    if (!g_log.out.empty()) {
+        fwrite(g_log.out.data(), 1, g_log.out.size(), stdout);
+        fflush(stdout);
+        g_log.out.clear();
+    }
+    if (!g_log.err.empty()) {
+        fwrite(g_log.err.data(), 1, g_log.err.size(), stderr);
+        fflush(stderr);
+        g_log.err.clear();
+    }
+}
+
+static void log_flusher() {
+    while (g_log.running.load(std::memory_order_acquire)) {
+        log_drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(SPIKE_LOG_FLUSH_MS));
+    }
+}
+
+/**
+ * Stop the flusher at exit, write what is left and report how much rate
+ * limiting held back
+ */
+static void log_shutdown() {
+    if (g_log.running.exchange(false, std::memory_order_acq_rel)) {
+        g_log.flusher.join();
+    }
+    
+    log_drain();
+    
+    uint64_t suppressed = g_log.suppressed.exchange(0, std::memory_order_relaxed);
+    if (suppressed != 0) {
+        fprintf(stderr, "WARNING: %llu repeated Spike log messages were suppressed in total\n",
+                (unsigned long long)suppressed);
+    }
+}
+
+/**
+ * Set up the ring and start the flusher, once per process
+ */
+static void log_start() {
+    std::call_once(g_log.started, []() {
+        for (uint64_t i = 0; i < SPIKE_LOG_RING_SIZE; i++) {
+            g_log.ring[i].seq.store(i, std::memory_order_relaxed);
+        }
+        
+        try {
+            g_log.running.store(true, std::memory_order_release);
+            g_log.flusher = std::thread(log_flusher);
+        } catch (const std::exception&) {
+            // Fall back to writing from the logging thread
+            g_log.running.store(false, std::memory_order_release);
+        }
+        atexit(log_shutdown);
+    });
+}
+
+/**
+ * Apply a call site's rate limit
+ * @param suppressed - Set to the number of messages held back since the
+ *                     site's last window, when a new window opens
+ * @return true if the message may be logged
+ */
+static bool log_rate_allow(spike_log_site_t* site, uint32_t* suppressed) {
+    uint64_t now = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    uint64_t start = site->window_start.load(std::memory_order_relaxed);
+    
+    if (now - start >= SPIKE_LOG_WINDOW_NS &&
+        site->window_start.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+        site->emitted.store(0, std::memory_order_relaxed);
+        *suppressed = site->suppressed.exchange(0, std::memory_order_relaxed);
+    }
+    
+    if (site->emitted.fetch_add(1, std::memory_order_relaxed) < SPIKE_LOG_BURST) return true;
+    
+    site->suppressed.fetch_add(1, std::memory_order_relaxed);
+    g_log.suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+static void log_message(spike_log_site_t* site, int level, const char* fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * Queue one line for the flusher
+ * @param site - Call site rate limit, null for output that must not be
+ *               thinned out (such as a table)
+ */
+static void log_message(spike_log_site_t* site, int level, const char* fmt, ...) {
+    static const char* const prefixes[] = {"DEBUG: ", "", "WARNING: ", "ERROR: "};
+    
+    if (level < g_log_level.load(std::memory_order_relaxed)) return;
+    
+    uint32_t suppressed = 0;
+    if (site != nullptr && !log_rate_allow(site, &suppressed)) return;
+    
+    log_start();
+    
+    // Claim a slot (bounded MPMC queue: a slot is free for ticket t when
+    // its sequence equals t)
+    uint64_t ticket = g_log.head.load(std::memory_order_relaxed);
+    spike_log_slot_t* slot;
+    for (;;) {
+        slot = &g_log.ring[ticket & (SPIKE_LOG_RING_SIZE - 1)];
+        int64_t diff = (int64_t)(slot->seq.load(std::memory_order_acquire) - ticket);
+        
+        if (diff == 0) {
+            if (g_log.head.compare_exchange_weak(ticket, ticket + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            g_log.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            ticket = g_log.head.load(std::memory_order_relaxed);
+        }
+    }
+    
+    // Leave room for the suppression note and the newline
+    const size_t room = SPIKE_LOG_MSG_BYTES - 48;
+    int len = snprintf(slot->text, room, "%s", prefixes[level]);
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(slot->text + len, room - len, fmt, args);
+    va_end(args);
+    
+    len = (int)strlen(slot->text);
+    if (suppressed != 0) {
+        len += snprintf(slot->text + len, SPIKE_LOG_MSG_BYTES - len,
+                        " (%u similar messages suppressed)", suppressed);
+    }
+    slot->text[len] = '\n';
+    slot->text[len + 1] = '\0';
+    slot->level = level;
+    slot->seq.store(ticket + 1, std::memory_order_release);
+    
+    if (!g_log.running.load(std::memory_order_acquire)) log_drain();
+}
+
+#define SPIKE_LOG(level, ...) do { \
+    static spike_log_site_t spike_log_site_; \
+    log_message(&spike_log_site_, level, __VA_ARGS__); \
+} while (0)
+
+#define LOG_DEBUG(...) SPIKE_LOG(SPIKE_LOG_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)  SPIKE_LOG(SPIKE_LOG_INFO, __VA_ARGS__)
+#define LOG_WARN(...)  SPIKE_LOG(SPIKE_LOG_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) SPIKE_LOG(SPIKE_LOG_ERROR, __VA_ARGS__)
+
+/**
+ * Record a failure for spike_get_last_error()
+ * @param ctx - Instance it happened on, null if there is none
+ * @return code, so callers can write "return set_error(ctx, code);"
+ */
+static int set_error(spike_ctx_t* ctx, int code) {
+    if (ctx != nullptr) {
+        ctx->last_error = code;
+    } else {
+        g_last_error.store(code, std::memory_order_relaxed);
+    }
+    return code;
+}
 
 //==============================================================================
 // Helper Functions
 //==============================================================================
 
-static void check_initialized() {
-    if (!g_spike_initialized) {
-        std::cerr << "ERROR: Spike not initialized! Call spike_init() first." << std::endl;
+static void drain_async(spike_ctx_t* ctx);
+static char* host_address(spike_ctx_t* ctx, uint64_t addr, uint64_t size);
+static uint64_t xxh64(const void* data, size_t len);
+
+/**
+ * Resolve a handle to its context without synchronizing with the worker
+ * @return Context, or nullptr if the handle does not name a live instance
+ */
+static spike_ctx_t* lookup_context(void* handle) {
+    spike_ctx_t* ctx = (spike_ctx_t*)handle;
+    if (ctx == nullptr || !ctx->initialized) {
+        LOG_ERROR("Spike not initialized! Call spike_init() first.");
+        set_error(nullptr, SPIKE_ERR_NOT_INITIALIZED);
+        return nullptr;
+    }
+    return ctx;
+}
+
+/**
+ * Resolve a handle to its context
+ * @return Context, or nullptr if the handle does not name a live instance
+ *
+ * In asynchronous mode this waits for the worker to finish everything
+ * submitted so far, so the caller sees (and may modify) settled state.
+ */
+static spike_ctx_t* check_initialized(void* handle) {
+    spike_ctx_t* ctx = lookup_context(handle);
+    if (ctx != nullptr && ctx->async != nullptr) drain_async(ctx);
+    return ctx;
+}
+
+static state_t* get_state(spike_ctx_t* ctx) {
+    return ctx->proc->get_state();
+}
+
+/**
+ * Create a context and add it to the pool
+ */
+static spike_ctx_t* alloc_context() {
+    g_ctx_pool.push_back(new spike_ctx_t());
+    return g_ctx_pool.back();
+}
+
+/**
+ * Write a single-precision value into an FP register, NaN-boxed to FLEN
+ */
+static void write_freg32(state_t* state, int reg_num, uint32_t value) {
+    freg_t fp_value;
+    fp_value.v[0] = 0xFFFFFFFF00000000ULL | value;
+    fp_value.v[1] = 0xFFFFFFFFFFFFFFFFULL;
+    state->FPR.write(reg_num, fp_value);
+}
+
+/**
+ * Work out which register an RV32IF instruction writes, from its encoding
+ * @return SPIKE_RD_* descriptor, 0 if no register is written
+ */
+static uint32_t decode_destination(uint32_t instruction) {
+    uint32_t opcode = instruction & 0x7F;
+    uint32_t rd = (instruction >> 7) & SPIKE_RD_INDEX_MASK;
+    
+    switch (opcode) {
+        case 0x07:  // FLW
+        case 0x43:  // FMADD.S
+        case 0x47:  // FMSUB.S
+        case 0x4B:  // FNMSUB.S
+        case 0x4F:  // FNMADD.S
+            return SPIKE_RD_VALID | SPIKE_RD_FP | rd;
+        
+        case 0x53: {
+            // FCVT.W[U].S, FEQ/FLT/FLE.S, FMV.X.W and FCLASS.S write x[rd]
+            uint32_t funct5 = instruction >> 27;
+            if (funct5 == 0x18 || funct5 == 0x14 || funct5 == 0x1C) {
+                return rd != 0 ? (SPIKE_RD_VALID | rd) : 0;
+            }
+            return SPIKE_RD_VALID | SPIKE_RD_FP | rd;
+        }
+        
+        case 0x23:  // STORE
+        case 0x27:  // FSW
+        case 0x63:  // BRANCH
+        case 0x0F:  // FENCE
+            return 0;
+        
+        case 0x73:  // SYSTEM: only the CSR instructions write rd
+            if (((instruction >> 12) & 0x7) == 0) return 0;
+            return rd != 0 ? (SPIKE_RD_VALID | rd) : 0;
+        
+        default:
+            return rd != 0 ? (SPIKE_RD_VALID | rd) : 0;
+    }
+}
+
+// Data memory access of one instruction, worked out before it runs
+typedef struct {
+    uint32_t addr;
+    uint32_t data;              // Store data; loads take theirs from rd afterwards
+    uint32_t op;                // spike_commit_t.mem_op encoding, SPIKE_MEM_NONE if none
+} spike_mem_access_t;
+
+/**
+ * Decode the load or store an instruction will make from its encoding
+ * and the registers before it runs
+ */
+static void predict_access(const state_t* state, uint32_t instruction, spike_mem_access_t* access) {
+    uint32_t opcode = instruction & 0x7F;
+    uint32_t funct3 = (instruction >> 12) & 0x7;
+    uint32_t rs2 = (instruction >> 20) & 0x1F;
+    sreg_t imm;
+    
+    access->op = SPIKE_MEM_NONE;
+    access->data = 0;
+    switch (opcode) {
+        case 0x03:  // LB/LH/LW/LBU/LHU
+        case 0x07:  // FLW
+            if (funct3 == 3 || funct3 > 5 || (opcode == 0x07 && funct3 != 2)) return;
+            imm = (int32_t)instruction >> 20;
+            access->op = SPIKE_MEM_LOAD;
+            break;
+        case 0x23:  // SB/SH/SW
+        case 0x27:  // FSW
+            if (funct3 > 2 || (opcode == 0x27 && funct3 != 2)) return;
+            imm = ((int32_t)(instruction & 0xFE000000) >> 20) | ((instruction >> 7) & 0x1F);
+            access->op = SPIKE_MEM_STORE;
+            access->data = (opcode == 0x27) ? (uint32_t)state->FPR[rs2].v[0] : (uint32_t)state->XPR[rs2];
+            break;
+        default:
+            return;
+    }
+    
+    uint32_t size = 1u << (funct3 & 3);
+    access->addr = (uint32_t)(state->XPR[(instruction >> 15) & 0x1F] + (reg_t)imm);
+    access->op |= size << 4;
+    if (size < 4) access->data &= (1u << (size * 8)) - 1;
+}
+
+/**
+ * Fill a commit record from the state one step left behind
+ * @param fcsr_before - FCSR before the step
+ * @param access - The step's memory access from predict_access()
+ *
+ * The record is built from the encoding rather than Spike's commit log,
+ * which is only kept with commit logging on and then also printed per
+ * instruction. fflags are those newly set in the accrued flags: a flag
+ * that was already set is not reported again. SYSTEM instructions report
+ * none, since their CSR writes are not raised exceptions.
+ */
+static void capture_commit(state_t* state, uint32_t instruction, uint32_t fcsr_before,
+                           const spike_mem_access_t* access, spike_commit_t* commit) {
+    uint32_t raised = 0;
+    if ((instruction & 0x7F) != 0x73) raised = state->fcsr & ~fcsr_before & SPIKE_FFLAGS_MASK;
+    
+    commit->pc = state->pc;
+    commit->fcsr = state->fcsr;
+    commit->fcsr_delta = raised | ((fcsr_before ^ state->fcsr) & SPIKE_FRM_MASK);
+    
+    uint32_t dest = decode_destination(instruction);
+    uint32_t index = dest & SPIKE_RD_INDEX_MASK;
+    commit->rd = dest;
+    commit->value = 0;
+    if (dest & SPIKE_RD_VALID) {
+        commit->value = (dest & SPIKE_RD_FP) ? (uint32_t)state->FPR[index].v[0]
+                                             : (uint32_t)state->XPR[index];
+    }
+    
+    commit->mem_addr = 0;
+    commit->mem_data = 0;
+    commit->mem_op = access->op;
+    if (access->op != SPIKE_MEM_NONE) {
+        uint32_t size = access->op >> 4;
+        commit->mem_addr = access->addr;
+        commit->mem_data = ((access->op & 3u) == SPIKE_MEM_STORE) ? access->data : commit->value;
+        if (size < 4) commit->mem_data &= (1u << (size * 8)) - 1;
+    }
+}
+
+/**
+ * Write out the buffered trace records
+ * @return true if the file is still good
+ */
+static bool trace_flush(spike_trace_t* t) {
+    if (t->failed) return false;
+    
+    size_t count = t->buffer.size();
+    if (count != 0 && fwrite(t->buffer.data(), sizeof(spike_trace_record_t), count, t->file) != count) {
+        LOG_ERROR("Failed writing commit trace %s; recording stopped", t->path.c_str());
+        t->failed = true;
+    }
+    t->buffer.clear();
+    return !t->failed;
+}
+
+/**
+ * Digest of the source operands an instruction reads: the PC, the integer
+ * and FP registers its fields name as sources, frm when it rounds
+ * dynamically and the memory a load reads, each as its 32-bit RV32 value
+ *
+ * Stored with each trace record, so replay can tell a result computed from
+ * other operands (a register or memory write the stimulus did not carry)
+ * from one it can reuse.
+ */
+static uint32_t operand_digest(spike_ctx_t* ctx, const state_t* state, uint32_t instruction) {
+    uint32_t opcode = instruction & 0x7F;
+    uint32_t funct3 = (instruction >> 12) & 0x7;
+    uint32_t funct7 = instruction >> 25;
+    uint32_t rs1 = (instruction >> 15) & 0x1F;
+    uint32_t rs2 = (instruction >> 20) & 0x1F;
+    uint32_t rs3 = instruction >> 27;
+    uint32_t words[6];
+    int n = 0;
+    bool rounds = false;
+    
+    words[n++] = (uint32_t)state->pc;
+    switch (opcode) {
+        case 0x03:  // Loads
+        case 0x07:  // FLW
+        case 0x13:  // OP-IMM
+        case 0x67:  // JALR
+        case 0x73:  // SYSTEM
+            words[n++] = (uint32_t)state->XPR[rs1];
+            break;
+        case 0x23:  // Stores
+        case 0x33:  // OP
+        case 0x63:  // Branches
+            words[n++] = (uint32_t)state->XPR[rs1];
+            words[n++] = (uint32_t)state->XPR[rs2];
+            break;
+        case 0x27:  // FSW
+            words[n++] = (uint32_t)state->XPR[rs1];
+            words[n++] = (uint32_t)state->FPR[rs2].v[0];
+            break;
+        case 0x43:  // FMADD/FMSUB/FNMSUB/FNMADD
+        case 0x47:
+        case 0x4B:
+        case 0x4F:
+            words[n++] = (uint32_t)state->FPR[rs1].v[0];
+            words[n++] = (uint32_t)state->FPR[rs2].v[0];
+            words[n++] = (uint32_t)state->FPR[rs3].v[0];
+            rounds = true;
+            break;
+        case 0x53:
+            if (funct7 == 0x68 || funct7 == 0x78) {
+                words[n++] = (uint32_t)state->XPR[rs1];       // FCVT.S.W[U], FMV.W.X
+            } else {
+                words[n++] = (uint32_t)state->FPR[rs1].v[0];
+                // FSQRT, FCVT.W[U].S, FMV.X.W and FCLASS have no rs2
+                if (funct7 != 0x2C && funct7 != 0x60 && funct7 != 0x70) words[n++] = (uint32_t)state->FPR[rs2].v[0];
+            }
+            rounds = true;
+            break;
+        default:    // LUI, AUIPC, JAL: the PC only
+            break;
+    }
+    
+    // Only rounding operations encode rm = 7 (dynamic)
+    if (rounds && funct3 == 7) words[n++] = state->fcsr & SPIKE_FRM_MASK;
+    
+    if (opcode == 0x03 || opcode == 0x07) {
+        spike_mem_access_t access;
+        predict_access(state, instruction, &access);
+        uint32_t size = access.op >> 4;
+        const char* data = (access.op != SPIKE_MEM_NONE) ? host_address(ctx, access.addr, size) : nullptr;
+        uint32_t loaded = 0;
+        if (data != nullptr) memcpy(&loaded, data, size);
+        words[n++] = loaded;
+    }
+    
+    uint64_t h = xxh64(words, n * sizeof(uint32_t));
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/**
+ * Build the trace record of one executed instruction
+ * @param digest - operand_digest() taken before it ran
+ * @param trap - Trap it raised, null if it retired
+ */
+static void make_trace_record(spike_trace_record_t* rec, uint32_t instruction, uint32_t digest,
+                              const spike_commit_t* commit, const spike_trap_t* trap) {
+    rec->pc = commit->pc;
+    rec->instruction = instruction;
+    rec->rd = commit->rd;
+    rec->value = commit->value;
+    rec->fflags = commit->fcsr_delta & SPIKE_FFLAGS_MASK;
+    rec->mem_addr = commit->mem_addr;
+    rec->mem_data = commit->mem_data;
+    rec->mem_op = commit->mem_op;
+    rec->trap = (trap != nullptr) ? (SPIKE_TRACE_TRAP | trap->cause) : 0;
+    rec->tval = (trap != nullptr) ? trap->tval : 0;
+    rec->epc = (trap != nullptr) ? trap->epc : 0;
+    rec->operands = digest;
+}
+
+/**
+ * Append one executed instruction to the commit trace
+ * @param digest - operand_digest() taken before it ran
+ * @param trap - Trap it raised, null if it retired
+ */
+static void trace_append(spike_trace_t* t, uint32_t instruction, uint32_t digest,
+                         const spike_commit_t* commit, const spike_trap_t* trap) {
+    spike_trace_record_t rec;
+    make_trace_record(&rec, instruction, digest, commit, trap);
+    
+    t->buffer.push_back(rec);
+    t->records++;
+    if (t->buffer.size() == SPIKE_TRACE_BUFFER_RECORDS) trace_flush(t);
+}
+
+/**
+ * Flush and close the commit trace
+ * @return Number of records written, -1 if writing failed
+ */
+static int64_t trace_stop(spike_ctx_t* ctx) {
+    spike_trace_t* t = ctx->trace;
+    if (t == nullptr) return 0;
+    
+    bool ok = trace_flush(t);
+    ok = (fclose(t->file) == 0) && ok;
+    int64_t records = ok ? (int64_t)t->records : -1;
+    
+    ctx->trace = nullptr;
+    delete t;
+    return records;
+}
+
+/**
+ * Enter the trap handler for an exception at the current PC, as Spike's
+ * take_trap() does for a machine-mode hart (no delegation applies)
+ * @return false if the hart is not in M-mode; Spike must take the trap
+ */
+static bool enter_trap(state_t* state, reg_t cause, reg_t tval) {
+    if (state->prv != PRV_M) return false;
+    
+    reg_t s = state->mstatus;
+    s = set_field(s, MSTATUS_MPIE, get_field(s, MSTATUS_MIE));
+    s = set_field(s, MSTATUS_MPP, PRV_M);
+    s = set_field(s, MSTATUS_MIE, 0);
+    state->mstatus = s;
+    
+    state->mepc = state->pc;
+    state->mcause = cause;
+    state->mtval = tval;
+    state->pc = state->mtvec & ~(reg_t)3;
+    return true;
+}
+
+/**
+ * Apply the next precomputed result in place of executing an instruction
+ * @param digest - operand_digest() of the hart as it is now
+ * @param commit - Optional record to fill from the result
+ * @return false if the instruction must still run live (SYSTEM
+ *         instructions, whose CSR side effects the result does not carry)
+ *
+ * The destination register, stores, PC and raised flags are written back
+ * to the hart, so state reads and live-executed instructions see what
+ * stepping would have left behind. A result that trapped enters the trap
+ * instead: the trap CSRs are set and minstret is left alone, as when the
+ * instruction runs live.
+ */
+static bool replay_step(spike_ctx_t* ctx, uint32_t instruction, uint32_t digest, spike_commit_t* commit) {
+    spike_replay_t* rp = ctx->replay;
+    
+    if (rp->next == rp->count) {
+        throw std::runtime_error("replay results exhausted after " + std::to_string(rp->count) +
+                                 " instructions");
+    }
+    const spike_trace_record_t& rec = rp->records[rp->next];
+    if (rec.instruction != instruction) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "stimulus diverged from replay results at record %zu "
+                 "(expected 0x%08x)", rp->next, rec.instruction);
+        throw std::runtime_error(msg);
+    }
+    if (rec.operands != digest) {
+        // Same instruction, other operands: the recorded result is stale
+        char msg[128];
+        snprintf(msg, sizeof(msg), "operands of 0x%08x diverged from replay results at record %zu",
+                 instruction, rp->next);
+        throw std::runtime_error(msg);
+    }
+    rp->next++;
+    
+    if ((instruction & 0x7F) == 0x73) return false;
+    
+    state_t* state = get_state(ctx);
+    uint32_t index = rec.rd & SPIKE_RD_INDEX_MASK;
+    
+    if (rec.trap & SPIKE_TRACE_TRAP) {
+        // Outside M-mode Spike must take the trap, so run it live
+        if (!enter_trap(state, rec.trap & ~SPIKE_TRACE_TRAP, rec.tval)) return false;
+        state->mepc = rec.epc;
+        state->pc = rec.pc;
+        if (commit != nullptr) {
+            memset(commit, 0, sizeof(spike_commit_t));
+            commit->pc = rec.pc;
+            commit->fcsr = state->fcsr;
+        }
+        return true;
+    }
+    
+    if (rec.rd & SPIKE_RD_VALID) {
+        if (rec.rd & SPIKE_RD_FP) {
+            write_freg32(state, index, rec.value);
+        } else if (index != 0) {
+            state->XPR.write(index, (reg_t)(int64_t)(int32_t)rec.value);
+        }
+    }
+    
+    if ((rec.mem_op & 3u) == SPIKE_MEM_STORE) {
+        mmu_t* mmu = ctx->proc->get_mmu();
+        try {
+            switch ((rec.mem_op >> 4) & 0xFu) {
+                case 1:  mmu->store_uint8(rec.mem_addr, (uint8_t)rec.mem_data); break;
+                case 2:  mmu->store_uint16(rec.mem_addr, (uint16_t)rec.mem_data); break;
+                default: mmu->store_uint32(rec.mem_addr, rec.mem_data); break;
+            }
+        } catch (trap_t&) {
+            // Results generated against a different memory map
+            char msg[96];
+            snprintf(msg, sizeof(msg), "replayed store to unmapped address 0x%08x at record %zu",
+                     rec.mem_addr, rp->next - 1);
+            throw std::runtime_error(msg);
+        }
+    }
+    
+    state->pc = rec.pc;
+    state->fcsr |= rec.fflags & SPIKE_FFLAGS_MASK;
+    state->minstret++;
+    
+    if (commit != nullptr) {
+        commit->pc = rec.pc;
+        commit->rd = rec.rd;
+        commit->value = rec.value;
+        commit->fcsr = state->fcsr;
+        commit->fcsr_delta = rec.fflags;
+        commit->mem_addr = rec.mem_addr;
+        commit->mem_data = rec.mem_data;
+        commit->mem_op = rec.mem_op;
+    }
+    return true;
+}
+
+/**
+ * Unmap the replay results
+ * @return Number of results consumed
+ */
+static size_t replay_stop(spike_ctx_t* ctx) {
+    spike_replay_t* rp = ctx->replay;
+    if (rp == nullptr) return 0;
+    
+    size_t consumed = rp->next;
+    munmap(rp->map, rp->map_size);
+    ctx->replay = nullptr;
+    delete rp;
+    return consumed;
+}
+
+#ifdef SPIKE_DIRECT_INJECT
+/**
+ * Look up the decoded handler for an encoding, decoding it on first use
+ */
+static insn_func_t lookup_decoded(spike_ctx_t* ctx, uint32_t instruction) {
+    auto it = ctx->decode_cache.find(instruction);
+    if (it != ctx->decode_cache.end()) {
+        return it->second;
+    }
+    
+    insn_func_t func = ctx->proc->decode_insn(insn_t(instruction));
+    ctx->decode_cache.emplace(instruction, func);
+    return func;
+}
+#endif // SPIKE_DIRECT_INJECT
+
+/**
+ * Store an instruction at the current PC and let Spike fetch and step it
+ *
+ * A PC outside simulated memory (an unset trap vector, a wild jump)
+ * cannot hold the instruction; fetching it raises an instruction access
+ * fault, taken here as Spike would.
+ */
+static void execute_fetched(processor_t* proc, state_t* state, uint32_t instruction) {
+    try {
+        proc->get_mmu()->store_uint32(state->pc, instruction);
+    } catch (trap_t&) {
+        if (enter_trap(state, CAUSE_FETCH_ACCESS, state->pc)) return;
+        char msg[64];
+        snprintf(msg, sizeof(msg), "fetch from unmapped PC 0x%08x", (uint32_t)state->pc);
+        throw std::runtime_error(msg);
+    }
+    proc->step(1);
+}
+
+/**
+ * Recognise a misaligned load or store from its encoding and the base
+ * register, before it runs
+ * @return true if the access will raise an address-misaligned exception
+ *
+ * Only the accesses whose legality does not depend on the ISA string are
+ * covered (byte/half/word integer loads and stores, FLW/FSW with the FPU
+ * on); anything else is left to Spike.
+ */
+static bool predict_misaligned(const state_t* state, uint32_t instruction, reg_t* cause, reg_t* tval) {
+    uint32_t opcode = instruction & 0x7F;
+    uint32_t funct3 = (instruction >> 12) & 0x7;
+    sreg_t imm;
+    
+    switch (opcode) {
+        case 0x03:  // LB/LH/LW/LBU/LHU
+            if (funct3 == 3 || funct3 > 5) return false;
+            imm = (int32_t)instruction >> 20;
+            *cause = CAUSE_MISALIGNED_LOAD;
+            break;
+        case 0x07:  // FLW
+            if (funct3 != 2 || (state->mstatus & MSTATUS_FS) == 0) return false;
+            imm = (int32_t)instruction >> 20;
+            *cause = CAUSE_MISALIGNED_LOAD;
+            break;
+        case 0x23:  // SB/SH/SW
+            if (funct3 > 2) return false;
+            imm = ((int32_t)(instruction & 0xFE000000) >> 20) | ((instruction >> 7) & 0x1F);
+            *cause = CAUSE_MISALIGNED_STORE;
+            break;
+        case 0x27:  // FSW
+            if (funct3 != 2 || (state->mstatus & MSTATUS_FS) == 0) return false;
+            imm = ((int32_t)(instruction & 0xFE000000) >> 20) | ((instruction >> 7) & 0x1F);
+            *cause = CAUSE_MISALIGNED_STORE;
+            break;
+        default:
+            return false;
+    }
+    
+    reg_t addr = state->XPR[(instruction >> 15) & 0x1F] + (reg_t)imm;
+    *tval = addr;
+    return (addr & ((1u << (funct3 & 3)) - 1)) != 0;
+}
+
+#ifdef SPIKE_DIRECT_INJECT
+/**
+ * Execute an instruction straight from the decode cache against the hart
+ * state, without touching simulated memory
+ *
+ * Illegal encodings go straight to the trap handler without running the
+ * handler that would throw. Other exceptions cost one throw, and the
+ * trap is taken here rather than by running the instruction again.
+ */
+static void execute_direct(spike_ctx_t* ctx, state_t* state, uint32_t instruction) {
+    processor_t* proc = ctx->proc;
+    insn_func_t func = lookup_decoded(ctx, instruction);
+    reg_t pc = state->pc;
+    reg_t npc;
+    
+    if (func == &illegal_instruction && enter_trap(state, CAUSE_ILLEGAL_INSTRUCTION, instruction)) {
+        return;
+    }
+    
+    try {
+        npc = func(proc, insn_t(instruction), pc);
+    } catch (trap_t& t) {
+        // Outside M-mode, let Spike's own step loop take the trap
+        if (!enter_trap(state, t.cause(), t.get_tval())) execute_fetched(proc, state, instruction);
+        return;
+    }
+    
+    if (invalid_pc(npc)) {
+        if (npc == PC_SERIALIZE_BEFORE) {
+            // Instruction asked to serialize before running: it has not
+            // executed yet, so hand it to the regular step path
+            execute_fetched(proc, state, instruction);
+            return;
+        }
+        // PC_SERIALIZE_AFTER: the instruction already set state->pc
+    } else {
+        state->pc = npc;
+    }
+    
+    state->minstret++;
+}
+#endif // SPIKE_DIRECT_INJECT
+
+/**
+ * Coverage instruction of an encoding
+ * @return SPIKE_COV_* instruction, -1 if it is not an RV32F one
+ */
+static int coverage_op(uint32_t instruction) {
+    uint32_t funct3 = (instruction >> 12) & 0x7;
+    uint32_t fmt = (instruction >> 25) & 0x3;
+    
+    switch (instruction & 0x7F) {
+        case 0x07: return funct3 == 2 ? SPIKE_COV_FLW : -1;
+        case 0x27: return funct3 == 2 ? SPIKE_COV_FSW : -1;
+        case 0x43: return fmt == 0 ? SPIKE_COV_FMADD : -1;
+        case 0x47: return fmt == 0 ? SPIKE_COV_FMSUB : -1;
+        case 0x4B: return fmt == 0 ? SPIKE_COV_FNMSUB : -1;
+        case 0x4F: return fmt == 0 ? SPIKE_COV_FNMADD : -1;
+        case 0x53: break;
+        default:   return -1;
+    }
+    
+    uint32_t rs2 = (instruction >> 20) & 0x1F;
+    switch (instruction >> 25) {
+        case 0x00: return SPIKE_COV_FADD;
+        case 0x04: return SPIKE_COV_FSUB;
+        case 0x08: return SPIKE_COV_FMUL;
+        case 0x0C: return SPIKE_COV_FDIV;
+        case 0x2C: return SPIKE_COV_FSQRT;
+        case 0x10: return funct3 <= 2 ? SPIKE_COV_FSGNJ + (int)funct3 : -1;
+        case 0x14: return funct3 <= 1 ? SPIKE_COV_FMIN + (int)funct3 : -1;
+        case 0x50: return funct3 == 2 ? SPIKE_COV_FEQ : funct3 == 1 ? SPIKE_COV_FLT :
+                          funct3 == 0 ? SPIKE_COV_FLE : -1;
+        case 0x60: return rs2 <= 1 ? SPIKE_COV_FCVT_W_S + (int)rs2 : -1;
+        case 0x68: return rs2 <= 1 ? SPIKE_COV_FCVT_S_W + (int)rs2 : -1;
+        case 0x70: return funct3 == 0 ? SPIKE_COV_FMV_X_W : funct3 == 1 ? SPIKE_COV_FCLASS : -1;
+        case 0x78: return SPIKE_COV_FMV_W_X;
+        default:   return -1;
+    }
+}
+
+/**
+ * Read the FP registers named by the rs1, rs2 and rs3 fields
+ */
+static void coverage_operands(state_t* state, uint32_t instruction, uint32_t operands[3]) {
+    operands[0] = (uint32_t)state->FPR[(instruction >> 15) & 0x1F].v[0];
+    operands[1] = (uint32_t)state->FPR[(instruction >> 20) & 0x1F].v[0];
+    operands[2] = (uint32_t)state->FPR[(instruction >> 27) & 0x1F].v[0];
+}
+
+static inline void coverage_hit(spike_coverage_t* cov, uint32_t bin) {
+    cov->bins[bin / 64] |= 1ull << (bin % 64);
+}
+
+/**
+ * Record the bins one retired instruction hits
+ * @param operands - FP source registers before the instruction ran
+ * @param fcsr_before - FCSR before the instruction (frm for dynamic rounding)
+ */
+static void coverage_sample(spike_coverage_t* cov, uint32_t instruction, const uint32_t operands[3],
+                            uint32_t fcsr_before, const spike_commit_t* commit) {
+    int index = coverage_op(instruction);
+    if (index < 0) return;
+    
+    const spike_cov_op_t& op = k_spike_cov_ops[index];
+    uint32_t base = (uint32_t)index * SPIKE_COV_BINS_PER_OP;
+    int classes[3] = {0, 0, 0};
+    
+    for (int s = 0; s < 3; s++) {
+        if (!((op.sources >> s) & 1)) continue;
+        classes[s] = spike_cov_class(operands[s]);
+        coverage_hit(cov, base + SPIKE_COV_BIN_OPERAND + s * SPIKE_COV_CLASSES + classes[s]);
+    }
+    if ((op.sources & 3) == 3) {
+        coverage_hit(cov, base + SPIKE_COV_BIN_PAIR + classes[0] * SPIKE_COV_CLASSES + classes[1]);
+    }
+    
+    if (op.results != 0 && (commit->rd & SPIKE_RD_FP)) {
+        coverage_hit(cov, base + SPIKE_COV_BIN_RESULT + spike_cov_class(commit->value));
+    }
+    
+    if (op.rounds) {
+        uint32_t rm = (instruction >> 12) & 0x7;
+        if (rm == 7) rm = (fcsr_before & SPIKE_FRM_MASK) >> 5;
+        if (rm < SPIKE_COV_MODES) {
+            uint32_t row = base + SPIKE_COV_BIN_ROUNDING + rm * 6;
+            uint32_t raised = commit->fcsr_delta & SPIKE_FFLAGS_MASK;
+            if (raised == 0) coverage_hit(cov, row + SPIKE_COV_FLAG_NONE);
+            for (; raised != 0; raised &= raised - 1) coverage_hit(cov, row + __builtin_ctz(raised));
+        }
+    }
+    cov->samples++;
+}
+
+/**
+ * Execute one instruction at the current PC
+ * @param commit - Optional record to fill with the retired state
+ * @param trap - Optional record to fill if the instruction traps
+ * @return true if the instruction retired, false if it raised an
+ *         exception (the hart is then at the trap handler)
+ *
+ * A trapped instruction leaves minstret alone, which is how traps taken
+ * inside Spike's step loop are told apart.
+ */
+static bool execute_one(spike_ctx_t* ctx, uint32_t instruction, spike_commit_t* commit,
+                        spike_trap_t* trap) {
+    state_t* state = get_state(ctx);
+    uint32_t fcsr_before = state->fcsr;
+    reg_t minstret_before = state->minstret;
+    spike_commit_t traced;
+    reg_t cause, tval;
+    
+    // Coverage classifies the source operands, so they are read up front
+    bool sampling = ctx->coverage != nullptr && ctx->coverage->sampling;
+    uint32_t operands[3] = {0, 0, 0};
+    if (sampling) coverage_operands(state, instruction, operands);
+    
+    // Tracing and coverage need the commit record even when the caller does not
+    if (commit == nullptr && (ctx->trace != nullptr || sampling)) commit = &traced;
+    
+    // Operands are digested before they can change, for the trace or the
+    // replay check
+    uint32_t digest = 0;
+    if (ctx->trace != nullptr || ctx->replay != nullptr) digest = operand_digest(ctx, state, instruction);
+    
+    bool replayed = ctx->replay != nullptr && replay_step(ctx, instruction, digest, commit);
+    spike_mem_access_t access;
+    
+    if (!replayed) {
+        if (commit != nullptr) predict_access(state, instruction, &access);
+        
+        // Misaligned accesses are sent to the trap handler up front, sparing
+        // Spike a thrown and unwound trap_t
+        if (predict_misaligned(state, instruction, &cause, &tval) && enter_trap(state, cause, tval)) {
+            // Trap taken
+#ifdef SPIKE_DIRECT_INJECT
+        } else if (ctx->direct_inject) {
+            execute_direct(ctx, state, instruction);
+#endif
+        } else {
+            execute_fetched(ctx->proc, state, instruction);
+        }
+    }
+    
+    bool retired = (state->minstret != minstret_before);
+    spike_trap_t taken = {0, 0, 0};
+    if (!retired) {
+        taken.epc = (uint32_t)state->mepc;
+        taken.tval = (uint32_t)state->mtval;
+        taken.cause = (uint32_t)state->mcause;
+        if (trap != nullptr) *trap = taken;
+    }
+    
+    if (commit != nullptr) {
+        if (!replayed) {
+            capture_commit(state, instruction, fcsr_before, &access, commit);
+            if (!retired) {
+                // Nothing was written; only the trap CSRs changed
+                commit->rd = 0;
+                commit->value = 0;
+                commit->mem_addr = 0;
+                commit->mem_data = 0;
+                commit->mem_op = SPIKE_MEM_NONE;
+            }
+        }
+        if (ctx->trace != nullptr) trace_append(ctx->trace, instruction, digest, commit, retired ? nullptr : &taken);
+        if (sampling && retired) coverage_sample(ctx->coverage, instruction, operands, fcsr_before, commit);
+    }
+    return retired;
+}
+
+/**
+ * Step the instruction at the current PC out of memory through
+ * execute_one(), so it reaches the commit trace like an injected one
+ */
+static void step_traced(spike_ctx_t* ctx) {
+    state_t* state = get_state(ctx);
+    uint32_t instruction = 0;
+    
+    try {
+        instruction = ctx->proc->get_mmu()->load_uint32(state->pc);
+    } catch (trap_t&) {
+        // Not in memory: execute_one() takes the fetch fault
+    }
+    execute_one(ctx, instruction, nullptr, nullptr);
+}
+
+//==============================================================================
+// Copy-on-Write Checkpoint Support
+//==============================================================================
+
+/**
+ * SIGSEGV handler: save the pre-image of a protected page on its first
+ * write, then unprotect it so the faulting store can complete
+ *
+ * The handler is process-wide. Faults outside tracked regions go to the
+ * handler that was installed before it (a simulator's crash reporter,
+ * say), called directly with the same arguments; with none, the default
+ * action is restored and the fault taken again, so the process dies as it
+ * would have without the wrapper.
+ */
+static void cow_fault_handler(int sig, siginfo_t* info, void* uctx) {
+    char* addr = (char*)info->si_addr;
+    
+    for (int i = 0; i < SPIKE_MAX_COW_REGIONS; i++) {
+        spike_cow_region_t* r = g_cow_regions[i].load(std::memory_order_acquire);
+        if (r == nullptr || addr < r->host || addr >= r->host + r->npages * g_page_size) {
+            continue;
+        }
+        
+        size_t page = (size_t)(addr - r->host) / g_page_size;
+        char* page_addr = r->host + page * g_page_size;
+        
+        if (r->armed && !r->saved[page]) {
+            memcpy(r->shadow + page * g_page_size, page_addr, g_page_size);
+            r->saved[page] = 1;
+            r->dirty[r->ndirty++] = (uint32_t)page;
+        }
+        if (r->stale != nullptr) {
+            // A host page overlaps at most two digest pages
+            size_t offset = (size_t)(page_addr - r->head);
+            r->stale[offset / SPIKE_DIGEST_PAGE] = 1;
+            r->stale[(offset + g_page_size - 1) / SPIKE_DIGEST_PAGE] = 1;
+        }
+        mprotect(page_addr, g_page_size, PROT_READ | PROT_WRITE);
+        return;
+    }
+    
+    // Not one of ours
+    if (g_prev_segv_action.sa_flags & SA_SIGINFO) {
+        g_prev_segv_action.sa_sigaction(sig, info, uctx);
+    } else if (g_prev_segv_action.sa_handler != SIG_DFL && g_prev_segv_action.sa_handler != SIG_IGN) {
+        g_prev_segv_action.sa_handler(sig);
+    } else {
+        // Take the default action: a real fault repeats once the handler
+        // returns, a sent signal (kill, raise) has to be raised again
+        signal(SIGSEGV, SIG_DFL);
+        if (info->si_code <= 0) raise(sig);
+    }
+}
+
+/**
+ * Make cow_fault_handler() the SIGSEGV handler, chaining to the current one
+ *
+ * Called each time memory tracking is started or re-armed: a handler
+ * installed after ours (simulators may set one up at any point) would
+ * otherwise receive the write faults on protected pages and treat them
+ * as crashes. Ours is put back in front of it, and it becomes the handler
+ * that foreign faults are passed to.
+ */
+static void install_cow_handler() {
+    struct sigaction current;
+    if (sigaction(SIGSEGV, nullptr, &current) == 0 && (current.sa_flags & SA_SIGINFO) &&
+        current.sa_sigaction == cow_fault_handler) {
+        return;
+    }
+    if (g_segv_handler_installed) {
+        LOG_WARN("SIGSEGV handler was replaced; reinstalling it in front of the new one");
+    }
+    
+    // SA_ONSTACK: a stack overflow fault still reaches the previous handler
+    // when the process has an alternate signal stack
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = cow_fault_handler;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &g_prev_segv_action);
+    g_segv_handler_installed = true;
+}
+
+/**
+ * Build the copy-on-write tracker for one mem_t region
+ * @return Tracker, nullptr if the shadow mapping could not be reserved
+ */
+static spike_cow_region_t* create_cow_region(mem_t* mem) {
+    if (g_page_size == 0) g_page_size = (size_t)sysconf(_SC_PAGESIZE);
+    
+    uintptr_t start = (uintptr_t)mem->contents();
+    uintptr_t end = start + mem->size();
+    uintptr_t first = (start + g_page_size - 1) & ~(uintptr_t)(g_page_size - 1);
+    uintptr_t last = end & ~(uintptr_t)(g_page_size - 1);
+    if (last < first) last = first;
+    
+    spike_cow_region_t* r = new spike_cow_region_t();
+    r->host = (char*)first;
+    r->npages = (last - first) / g_page_size;
+    r->ndirty = 0;
+    r->armed = false;
+    r->ndigest = (mem->size() + SPIKE_DIGEST_PAGE - 1) / SPIKE_DIGEST_PAGE;
+    r->digests = nullptr;
+    r->stale = nullptr;
+    r->head = (char*)start;
+    r->head_copy.resize(first - start);
+    r->tail = (char*)last;
+    r->tail_copy.resize(end > last ? end - last : 0);
+    
+    // Shadow and bookkeeping are only touched for pages that get written
+    size_t shadow_size = std::max(r->npages, (size_t)1) * g_page_size;
+    r->shadow = (char*)mmap(nullptr, shadow_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (r->shadow == MAP_FAILED) {
+        delete r;
+        return nullptr;
+    }
+    r->saved = (uint8_t*)calloc(r->npages + 1, sizeof(uint8_t));
+    r->dirty = (uint32_t*)calloc(r->npages + 1, sizeof(uint32_t));
+    
+    return r;
+}
+
+/**
+ * Unprotect, unregister and free a tracker
+ */
+static void destroy_cow_region(spike_cow_region_t* r) {
+    for (int i = 0; i < SPIKE_MAX_COW_REGIONS; i++) {
+        spike_cow_region_t* expected = r;
+        g_cow_regions[i].compare_exchange_strong(expected, nullptr);
+    }
+    
+    mprotect(r->host, r->npages * g_page_size, PROT_READ | PROT_WRITE);
+    munmap(r->shadow, std::max(r->npages, (size_t)1) * g_page_size);
+    free(r->saved);
+    free(r->dirty);
+    free(r->digests);
+    free(r->stale);
+    delete r;
+}
+
+/**
+ * Start a new copy-on-write epoch: forget saved pages, snapshot the
+ * unaligned edges and write-protect the tracked pages
+ */
+static void arm_cow_region(spike_cow_region_t* r) {
+    for (size_t i = 0; i < r->ndirty; i++) {
+        r->saved[r->dirty[i]] = 0;
+    }
+    r->ndirty = 0;
+    r->armed = true;
+    
+    memcpy(r->head_copy.data(), r->head, r->head_copy.size());
+    memcpy(r->tail_copy.data(), r->tail, r->tail_copy.size());
+    mprotect(r->host, r->npages * g_page_size, PROT_READ);
+}
+
+/**
+ * Copy saved pre-images back and write-protect those pages again
+ */
+static void rollback_cow_region(spike_cow_region_t* r) {
+    std::sort(r->dirty, r->dirty + r->ndirty);
+    
+    for (size_t i = 0; i < r->ndirty; ) {
+        // Re-protect each run of adjacent pages with one call
+        size_t run = 1;
+        while (i + run < r->ndirty && r->dirty[i + run] == r->dirty[i] + run) run++;
+        
+        for (size_t j = i; j < i + run; j++) {
+            size_t page = r->dirty[j];
+            memcpy(r->host + page * g_page_size, r->shadow + page * g_page_size, g_page_size);
+            r->saved[page] = 0;
+        }
+        mprotect(r->host + r->dirty[i] * g_page_size, run * g_page_size, PROT_READ);
+        i += run;
+    }
+    r->ndirty = 0;
+    
+    memcpy(r->head, r->head_copy.data(), r->head_copy.size());
+    memcpy(r->tail, r->tail_copy.data(), r->tail_copy.size());
+}
+
+/**
+ * Start tracking writes to every memory region of a context, if not
+ * already. Nothing is protected until a checkpoint or digest asks for it.
+ * @return SPIKE_OK, or SPIKE_ERR_STATE if a region cannot be tracked
+ */
+static int track_memory(spike_ctx_t* ctx) {
+    install_cow_handler();
+    if (!ctx->cow_regions.empty()) return SPIKE_OK;
+    
+    for (auto& mem : ctx->mems) {
+        spike_cow_region_t* r = create_cow_region(mem.second);
+        int slot = 0;
+        
+        while (slot < SPIKE_MAX_COW_REGIONS && g_cow_regions[slot].load() != nullptr) slot++;
+        if (r == nullptr || slot == SPIKE_MAX_COW_REGIONS) {
+            LOG_ERROR("Cannot track writes to memory at 0x%llx", (unsigned long long)mem.first);
+            if (r != nullptr) destroy_cow_region(r);
+            for (spike_cow_region_t* t : ctx->cow_regions) destroy_cow_region(t);
+            ctx->cow_regions.clear();
+            return SPIKE_ERR_STATE;
+        }
+        
+        ctx->cow_regions.push_back(r);
+        g_cow_regions[slot].store(r, std::memory_order_release);
+    }
+    return SPIKE_OK;
+}
+
+/**
+ * Drop a context's checkpoint and cached digests, and stop tracking its
+ * memory
+ */
+static void release_mem_tracking(spike_ctx_t* ctx) {
+    for (spike_cow_region_t* r : ctx->cow_regions) {
+        destroy_cow_region(r);
+    }
+    ctx->cow_regions.clear();
+    ctx->checkpoint.valid = false;
+}
+
+//==============================================================================
+// Program Loading
+//==============================================================================
+
+/**
+ * Find the host address of a simulated physical range
+ * @return Host address of addr, nullptr unless one region holds all of
+ *         [addr, addr + size)
+ */
+static char* host_address(spike_ctx_t* ctx, uint64_t addr, uint64_t size) {
+    for (auto& mem : ctx->mems) {
+        uint64_t base = mem.first;
+        uint64_t limit = base + mem.second->size();
+        
+        if (addr >= base && addr <= limit && size <= limit - addr) {
+            return mem.second->contents() + (addr - base);
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Load the PT_LOAD segments and symbol table of a mapped ELF image
+ * @param entry - Set to the entry point
+ * @return Number of segments loaded, or a negative SPIKE_ERR_* code
+ */
+template <typename Ehdr, typename Phdr, typename Shdr, typename Sym>
+static int load_elf_image(spike_ctx_t* ctx, const char* path, const char* file, size_t file_size,
+                          reg_t* entry) {
+    const Ehdr* eh = (const Ehdr*)file;
+    
+    if (eh->e_machine != EM_RISCV || eh->e_phentsize != sizeof(Phdr) ||
+        eh->e_phoff + (uint64_t)eh->e_phnum * sizeof(Phdr) > file_size) {
+        LOG_ERROR("%s is not a RISC-V executable", path);
+        return SPIKE_ERR_ARGUMENT;
+    }
+    
+    const Phdr* ph = (const Phdr*)(file + eh->e_phoff);
+    int segments = 0;
+    
+    for (int i = 0; i < eh->e_phnum; i++) {
+        if (ph[i].p_type != PT_LOAD || ph[i].p_memsz == 0) continue;
+        
+        char* dst = host_address(ctx, ph[i].p_paddr, ph[i].p_memsz);
+        if (dst == nullptr || ph[i].p_filesz > ph[i].p_memsz ||
+            ph[i].p_offset + (uint64_t)ph[i].p_filesz > file_size) {
+            LOG_ERROR("%s: segment at 0x%llx (0x%llx bytes) is outside the memory map", path,
+                      (unsigned long long)ph[i].p_paddr, (unsigned long long)ph[i].p_memsz);
+            return SPIKE_ERR_CONFIG;
+        }
+        
+        // Copied into the region's own memory, so checkpoints, digests and
+        // write tracking see the program like any other store
+        memcpy(dst, file + ph[i].p_offset, ph[i].p_filesz);
+        memset(dst + ph[i].p_filesz, 0, ph[i].p_memsz - ph[i].p_filesz);
+        segments++;
+    }
+    
+    // Keep the defined symbols so tests can find tohost, signatures etc.
+    ctx->elf_symbols.clear();
+    if (eh->e_shentsize == sizeof(Shdr) && eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(Shdr) <= file_size) {
+        const Shdr* sh = (const Shdr*)(file + eh->e_shoff);
+        
+        for (int i = 0; i < eh->e_shnum; i++) {
+            if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum) continue;
+            
+            const Shdr& strtab = sh[sh[i].sh_link];
+            if (sh[i].sh_offset + sh[i].sh_size > file_size ||
+                strtab.sh_offset + strtab.sh_size > file_size) continue;
+            
+            const Sym* sym = (const Sym*)(file + sh[i].sh_offset);
+            const char* names = file + strtab.sh_offset;
+            for (size_t n = 0; n < sh[i].sh_size / sizeof(Sym); n++) {
+                if (sym[n].st_name == 0 || sym[n].st_name >= strtab.sh_size || sym[n].st_shndx == SHN_UNDEF) continue;
+                const char* name = names + sym[n].st_name;
+                if (memchr(name, '\0', strtab.sh_size - sym[n].st_name) == nullptr) continue;
+                ctx->elf_symbols[name] = sym[n].st_value;
+            }
+        }
+    }
+    
+    *entry = eh->e_entry;
+    return segments;
+}
+
+/**
+ * Whether the PC is at a run target. A target that fits in 32 bits,
+ * signed or not, is compared on the low 32 bits, since DPI callers may
+ * pass RV32 addresses either way.
+ */
+static bool pc_matches(reg_t pc, int64_t target) {
+    if (pc == (reg_t)target) return true;
+    bool narrow = (target == (int64_t)(int32_t)target) || (target == (int64_t)(uint32_t)target);
+    return narrow && (uint32_t)pc == (uint32_t)target;
+}
+
+//==============================================================================
+// Memory Digests
+//==============================================================================
+
+static const uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t xxh_rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t xxh_read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME64_2;
+    return xxh_rotl64(acc, 31) * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge(uint64_t acc, uint64_t val) {
+    acc ^= xxh64_round(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+/**
+ * XXH64 of a buffer (seed 0), bit-compatible with the reference xxHash
+ * so digests can be reproduced outside the wrapper. Little-endian host.
+ */
+static uint64_t xxh64(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + len;
+    uint64_t h;
+    
+    if (len >= 32) {
+        uint64_t v1 = XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = XXH_PRIME64_2;
+        uint64_t v3 = 0;
+        uint64_t v4 = 0 - XXH_PRIME64_1;
+        
+        do {
+            v1 = xxh64_round(v1, xxh_read64(p));
+            v2 = xxh64_round(v2, xxh_read64(p + 8));
+            v3 = xxh64_round(v3, xxh_read64(p + 16));
+            v4 = xxh64_round(v4, xxh_read64(p + 24));
+            p += 32;
+        } while (p + 32 <= end);
+        
+        h = xxh_rotl64(v1, 1) + xxh_rotl64(v2, 7) + xxh_rotl64(v3, 12) + xxh_rotl64(v4, 18);
+        h = xxh64_merge(h, v1);
+        h = xxh64_merge(h, v2);
+        h = xxh64_merge(h, v3);
+        h = xxh64_merge(h, v4);
+    } else {
+        h = XXH_PRIME64_5;
+    }
+    h += len;
+    
+    for (; p + 8 <= end; p += 8) {
+        h ^= xxh64_round(0, xxh_read64(p));
+        h = xxh_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        uint32_t w;
+        memcpy(&w, p, sizeof(w));
+        h ^= (uint64_t)w * XXH_PRIME64_1;
+        h = xxh_rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= (*p) * XXH_PRIME64_5;
+        h = xxh_rotl64(h, 11) * XXH_PRIME64_1;
+    }
+    
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/**
+ * Hash each piece of [addr, addr + size) split at SPIKE_DIGEST_PAGE
+ * address boundaries
+ * @param data - The range's bytes
+ * @param hashes - Receives one XXH64 per piece, in address order
+ */
+static void hash_pieces(const char* data, uint64_t addr, uint64_t size, std::vector<uint64_t>& hashes) {
+    hashes.clear();
+    for (uint64_t offset = 0; offset < size; ) {
+        uint64_t len = std::min<uint64_t>(SPIKE_DIGEST_PAGE - ((addr + offset) % SPIKE_DIGEST_PAGE),
+                                          size - offset);
+        hashes.push_back(xxh64(data + offset, len));
+        offset += len;
+    }
+}
+
+/**
+ * Per-page hashes of a simulated memory range, rehashing only pages
+ * written since their hash was cached
+ * @param hashes - Receives the hashes, as hash_pieces() would compute them
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ *
+ * Whole pages of regions based on a SPIKE_DIGEST_PAGE boundary are cached.
+ * A rehashed page is marked clean and write-protected before it is read,
+ * so a store racing with the hash still marks it stale. Pages sharing
+ * host memory with the region's unaligned head or tail are never write
+ * tracked and are always hashed afresh.
+ */
+static int mem_page_hashes(spike_ctx_t* ctx, uint64_t addr, uint64_t size, std::vector<uint64_t>& hashes) {
+    size_t index = 0;
+    while (index < ctx->mems.size()) {
+        uint64_t base = ctx->mems[index].first;
+        if (addr >= base && addr - base <= ctx->mems[index].second->size() &&
+            size <= ctx->mems[index].second->size() - (addr - base)) break;
+        index++;
+    }
+    if (index == ctx->mems.size()) {
+        LOG_ERROR("Digest range 0x%llx (0x%llx bytes) is outside the memory map",
+                  (unsigned long long)addr, (unsigned long long)size);
+        return SPIKE_ERR_ARGUMENT;
+    }
+    
+    uint64_t base = ctx->mems[index].first;
+    const char* data = ctx->mems[index].second->contents() + (addr - base);
+    if (base % SPIKE_DIGEST_PAGE != 0) {
+        hash_pieces(data, addr, size, hashes);
+        return SPIKE_OK;
+    }
+    
+    if (track_memory(ctx) != SPIKE_OK) return SPIKE_ERR_STATE;
+    spike_cow_region_t* r = ctx->cow_regions[index];
+    if (r->stale == nullptr) {
+        r->digests = (uint64_t*)calloc(r->ndigest, sizeof(uint64_t));
+        r->stale = (uint8_t*)malloc(r->ndigest);
+        memset(r->stale, 1, r->ndigest);
+    }
+    
+    // Claim the stale whole pages, then protect them in runs of host pages
+    uint64_t first = (addr - base + SPIKE_DIGEST_PAGE - 1) / SPIKE_DIGEST_PAGE;
+    uint64_t last = (addr - base + size) / SPIKE_DIGEST_PAGE;
+    char* tracked_end = r->host + r->npages * g_page_size;
+    std::vector<uint64_t> rehash;
+    char* run_start = nullptr;
+    char* run_end = nullptr;
+    
+    for (uint64_t page = first; page < last; page++) {
+        char* lo = r->head + page * SPIKE_DIGEST_PAGE;
+        char* hi = lo + SPIKE_DIGEST_PAGE;
+        if (lo < r->host || hi > tracked_end || !r->stale[page]) continue;
+        
+        r->stale[page] = 0;
+        rehash.push_back(page);
+        
+        lo = r->host + (size_t)(lo - r->host) / g_page_size * g_page_size;
+        hi = std::min(tracked_end, r->host + ((size_t)(hi - r->host) + g_page_size - 1) / g_page_size * g_page_size);
+        if (run_start != nullptr && lo > run_end) {
+            mprotect(run_start, run_end - run_start, PROT_READ);
+            run_start = nullptr;
+        }
+        if (run_start == nullptr) run_start = lo;
+        run_end = hi;
+    }
+    if (run_start != nullptr) mprotect(run_start, run_end - run_start, PROT_READ);
+    
+    for (uint64_t page : rehash) {
+        r->digests[page] = xxh64(r->head + page * SPIKE_DIGEST_PAGE, SPIKE_DIGEST_PAGE);
+    }
+    
+    hashes.clear();
+    for (uint64_t offset = 0; offset < size; ) {
+        uint64_t page = (addr - base + offset) / SPIKE_DIGEST_PAGE;
+        uint64_t len = std::min<uint64_t>(SPIKE_DIGEST_PAGE - ((addr + offset) % SPIKE_DIGEST_PAGE),
+                                          size - offset);
+        char* lo = r->head + page * SPIKE_DIGEST_PAGE;
+        bool cached = len == SPIKE_DIGEST_PAGE && lo >= r->host && lo + SPIKE_DIGEST_PAGE <= tracked_end;
+        
+        hashes.push_back(cached ? r->digests[page] : xxh64(data + offset, len));
+        offset += len;
+    }
+    return SPIKE_OK;
+}
+
+//==============================================================================
+// Asynchronous Execution
+//==============================================================================
+
+/**
+ * Back off while waiting on the other thread: spin briefly, then yield,
+ * then sleep so an idle worker does not hold a core
+ */
+static void async_backoff(unsigned idle) {
+    if (idle < 64) return;
+    if (idle < 1024) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+static void async_worker(spike_ctx_t* ctx) {
+    spike_async_t* q = ctx->async;
+    uint64_t next = q->completed.load(std::memory_order_relaxed);
+    unsigned idle = 0;
+    
+    for (;;) {
+        if (next == q->submitted.load(std::memory_order_acquire)) {
+            // Stop only once everything submitted has been executed
+            if (!q->running.load(std::memory_order_acquire)) break;
+            async_backoff(idle++);
+            continue;
+        }
+        idle = 0;
+        
+        spike_async_slot_t* slot = &q->slots[next & (SPIKE_ASYNC_RING_SIZE - 1)];
+        try {
+            execute_one(ctx, slot->instruction, &slot->commit, nullptr);
+            slot->status = SPIKE_OK;
+        } catch (const std::exception& e) {
+            LOG_ERROR("Cannot execute instruction 0x%08x (async): %s", slot->instruction, e.what());
+            slot->status = SPIKE_ERR_EXECUTION;
+        }
+        q->completed.store(++next, std::memory_order_release);
+    }
+}
+
+/**
+ * Wait until the worker has executed every submitted instruction
+ */
+static void drain_async(spike_ctx_t* ctx) {
+    spike_async_t* q = ctx->async;
+    uint64_t target = q->submitted.load(std::memory_order_relaxed);
+    unsigned idle = 0;
+    
+    while (q->completed.load(std::memory_order_acquire) != target) {
+        async_backoff(idle++);
+    }
+}
+
+static void start_async(spike_ctx_t* ctx) {
+    spike_async_t* q = new spike_async_t();
+    q->running.store(true, std::memory_order_release);
+    ctx->async = q;
+    q->worker = std::thread(async_worker, ctx);
+}
+
+/**
+ * Finish outstanding work, join the worker and drop unpolled results
+ */
+static void stop_async(spike_ctx_t* ctx) {
+    spike_async_t* q = ctx->async;
+    q->running.store(false, std::memory_order_release);
+    q->worker.join();
+    ctx->async = nullptr;
+    delete q;
+}
+
+//==============================================================================
+// Precomputed Replay
+//==============================================================================
+
+extern "C" int spike_restore(void* handle);
+
+/**
+ * Parse a stimulus file into segments
+ * @return false on a read or syntax error (message already logged)
+ *
+ * One item per line, '#' starts a comment:
+ *   reset              Start a new segment from the reset state
+ *   x<N>|f<N> <hex>    Write a register
+ *   pc|fcsr <hex>      Write the PC or FCSR
+ *   <hex>              Execute an instruction
+ * Lines before the first reset form a segment of their own.
+ */
+static bool parse_stimulus(const char* path, std::vector<spike_stim_segment_t>& segments) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        LOG_ERROR("Cannot open stimulus %s", path);
+        return false;
+    }
+    
+    char line[256];
+    int line_no = 0;
+    bool ok = true;
+    
+    segments.assign(1, spike_stim_segment_t());
+    while (ok && fgets(line, sizeof(line), file) != nullptr) {
+        line_no++;
+        char* comment = strchr(line, '#');
+        if (comment != nullptr) *comment = '\0';
+        
+        char word[32], arg[32], extra[2];
+        int fields = sscanf(line, "%31s %31s %1s", word, arg, extra);
+        if (fields <= 0) continue;
+        
+        spike_stim_op_t op = {SPIKE_STIM_INSN, 0, 0};
+        char* end = nullptr;
+        unsigned long reg = 0;
+        
+        if (fields == 1 && strcmp(word, "reset") == 0) {
+            segments.push_back(spike_stim_segment_t());
+            continue;
+        } else if (fields == 1) {
+            op.value = (uint32_t)strtoul(word, &end, 16);
+            ok = (*end == '\0');
+        } else if (fields == 2) {
+            op.value = (uint32_t)strtoul(arg, &end, 16);
+            ok = (*end == '\0');
+            if (strcmp(word, "pc") == 0) {
+                op.kind = SPIKE_STIM_PC;
+            } else if (strcmp(word, "fcsr") == 0) {
+                op.kind = SPIKE_STIM_FCSR;
+            } else if ((word[0] == 'x' || word[0] == 'f') && word[1] != '\0') {
+                op.kind = (word[0] == 'x') ? SPIKE_STIM_XREG : SPIKE_STIM_FREG;
+                reg = strtoul(word + 1, &end, 10);
+                ok = ok && (*end == '\0') && reg < 32;
+                op.index = (uint32_t)reg;
+            } else {
+                ok = false;
+            }
+        } else {
+            ok = false;
+        }
+        
+        if (!ok) {
+            LOG_ERROR("%s:%d: cannot parse stimulus line", path, line_no);
+            break;
+        }
+        
+        spike_stim_segment_t& seg = segments.back();
+        seg.ops.push_back(op);
+        if (op.kind == SPIKE_STIM_INSN) seg.instructions++;
+    }
+    
+    fclose(file);
+    return ok;
+}
+
+/**
+ * Run one stimulus segment from the checkpointed reset state
+ * @param out - Where this segment's results go
+ */
+static void generate_segment(spike_ctx_t* ctx, const spike_stim_segment_t& seg,
+                             spike_trace_record_t* out) {
+    spike_restore(ctx);
+    state_t* state = get_state(ctx);
+    spike_commit_t commit;
+    spike_trap_t trap;
+    uint32_t digest;
+    
+    for (const spike_stim_op_t& op : seg.ops) {
+        switch (op.kind) {
+            case SPIKE_STIM_XREG:
+                if (op.index != 0) state->XPR.write(op.index, (reg_t)(int64_t)(int32_t)op.value);
+                break;
+            case SPIKE_STIM_FREG:
+                write_freg32(state, op.index, op.value);
+                break;
+            case SPIKE_STIM_PC:
+                state->pc = op.value;
+                break;
+            case SPIKE_STIM_FCSR:
+                state->fcsr = op.value & (SPIKE_FRM_MASK | SPIKE_FFLAGS_MASK);
+                break;
+            default:
+                digest = operand_digest(ctx, state, op.value);
+                if (execute_one(ctx, op.value, &commit, &trap)) {
+                    make_trace_record(out, op.value, digest, &commit, nullptr);
+                } else {
+                    make_trace_record(out, op.value, digest, &commit, &trap);
+                }
+                out++;
+                break;
+        }
+    }
+}
+
+//==============================================================================
+// Commit Checking
+//==============================================================================
+
+static bool is_nan32(uint32_t v) {
+    return (v & 0x7F800000u) == 0x7F800000u && (v & 0x007FFFFFu);
+}
+
+static bool is_inf32(uint32_t v) {
+    return (v & 0x7FFFFFFFu) == 0x7F800000u;
+}
+
+/**
+ * Compare two single-precision results
+ * @param tolerance - Allowed distance in ULPs; 0 requires identical bits
+ * @param ulp - Distance found, when both are finite with the same sign
+ * @return true if got is acceptable for expected
+ *
+ * With a tolerance, any NaN matches any NaN, infinities must match
+ * exactly and a sign difference (including +0 vs -0) always fails.
+ */
+static bool fp32_within(uint32_t expected, uint32_t got, uint32_t tolerance, uint32_t* ulp) {
+    *ulp = 0;
+    if (expected == got) return true;
+    
+    if (is_nan32(expected) || is_nan32(got)) {
+        return tolerance != 0 && is_nan32(expected) && is_nan32(got);
+    }
+    if (is_inf32(expected) || is_inf32(got)) return false;
+    if ((expected ^ got) >> 31) return false;
+    
+    uint32_t a = expected & 0x7FFFFFFFu;
+    uint32_t b = got & 0x7FFFFFFFu;
+    *ulp = (a > b) ? a - b : b - a;
+    return *ulp <= tolerance;
+}
+
+static void append_report(std::string& report, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void append_report(std::string& report, const char* fmt, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    report += line;
+}
+
+static float bits_to_float(uint32_t v) {
+    float f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+//==============================================================================
+// Call Statistics
+//==============================================================================
+
+static const char* const g_entry_point_names[SPIKE_EP_COUNT] = {
+#define SPIKE_EP_NAME(name) "spike_" #name,
+    SPIKE_ENTRY_POINTS(SPIKE_EP_NAME)
+#undef SPIKE_EP_NAME
+};
+
+static inline uint64_t read_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Reference point for converting ticks to time, taken at load
+static const uint64_t g_ticks_origin = read_ticks();
+static const std::chrono::steady_clock::time_point g_clock_origin = std::chrono::steady_clock::now();
+
+/**
+ * Timestamp counter ticks per nanosecond, measured since load
+ */
+static double ticks_per_ns() {
+#if defined(__x86_64__) || defined(__i386__)
+    // Make sure the measurement spans at least 10ms
+    std::chrono::steady_clock::time_point now;
+    uint64_t ticks;
+    do {
+        now = std::chrono::steady_clock::now();
+        ticks = read_ticks();
+    } while (now - g_clock_origin < std::chrono::milliseconds(10));
+    
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(now - g_clock_origin).count();
+    return (double)(ticks - g_ticks_origin) / ns;
+#else
+    return 1.0;
+#endif
+}
+
+/**
+ * Latency below which the given fraction of calls completed, in ticks
+ * (the upper edge of the histogram bucket it falls in)
+ */
+static uint64_t percentile_ticks(const spike_call_stats_t& st, double fraction) {
+    uint64_t target = (uint64_t)std::ceil(fraction * (double)st.calls);
+    uint64_t seen = 0;
+    
+    for (int b = 0; b < SPIKE_STATS_BUCKETS; b++) {
+        seen += st.hist[b];
+        if (seen >= target) return std::min<uint64_t>(st.max_ticks, (2ULL << b) - 1);
+    }
+    return st.max_ticks;
+}
+
+// Times one exported call and charges it to the context it ran on
+class spike_call_timer_t {
+public:
+    spike_call_timer_t(void* handle, int entry)
+        : handle_(handle), entry_(entry), start_(read_ticks()) {}
+    
+    ~spike_call_timer_t() {
+        spike_ctx_t* ctx = (spike_ctx_t*)handle_;
+        if (ctx == nullptr || !ctx->initialized) return;
+        
+        uint64_t ticks = read_ticks() - start_;
+        int bucket = 63 - __builtin_clzll(ticks | 1);
+        spike_call_stats_t& st = ctx->call_stats[entry_];
+        
+        st.calls++;
+        st.ticks += ticks;
+        if (ticks > st.max_ticks) st.max_ticks = ticks;
+        st.hist[std::min(bucket, SPIKE_STATS_BUCKETS - 1)]++;
+    }
+    
+    // For calls that create the context they run on
+    void bind(void* handle) { handle_ = handle; }
+    
+private:
+    void* handle_;
+    int entry_;
+    uint64_t start_;
+};
+
+#define SPIKE_TIMED(handle, name) spike_call_timer_t call_timer(handle, SPIKE_EP_##name)
+
+/**
+ * Log a table of the entry points a context has used
+ */
+static void dump_call_stats(spike_ctx_t* ctx) {
+    double tpn = 0;
+    char line[160];
+    
+    for (int i = 0; i < SPIKE_EP_COUNT; i++) {
+        const spike_call_stats_t& st = ctx->call_stats[i];
+        if (st.calls == 0) continue;
+        
+        if (tpn == 0) {
+            tpn = ticks_per_ns();
+            snprintf(line, sizeof(line), "  %-26s %12s %12s %9s %9s %9s %11s",
+                     "entry point", "calls", "total ms", "avg ns", "p50 ns", "p99 ns", "max ns");
+            log_message(nullptr, SPIKE_LOG_INFO, "Spike DPI call statistics:");
+            log_message(nullptr, SPIKE_LOG_INFO, "%s", line);
+        }
+        snprintf(line, sizeof(line), "  %-26s %12llu %12.3f %9.0f %9.0f %9.0f %11.0f",
+                 g_entry_point_names[i], (unsigned long long)st.calls,
+                 st.ticks / tpn / 1e6, st.ticks / tpn / st.calls,
+                 percentile_ticks(st, 0.50) / tpn, percentile_ticks(st, 0.99) / tpn,
+                 st.max_ticks / tpn);
+        log_message(nullptr, SPIKE_LOG_INFO, "%s", line);
+    }
+}
+
+//==============================================================================
+// Context Construction
+//==============================================================================
+
+/**
+ * Check a memory map for empty, wrapping or overlapping regions
+ * @return true if the map is usable
+ */
+static bool validate_mem_map(const spike_mem_region_t* regions, int count) {
+    if (count <= 0) {
+        LOG_ERROR("Memory map is empty");
+        return false;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        uint64_t base = regions[i].base;
+        uint64_t end = base + regions[i].size;
+        
+        if (regions[i].size == 0 || end > 0x100000000ULL) {
+            LOG_ERROR("Invalid memory region 0x%llx size 0x%x", (unsigned long long)base, regions[i].size);
+            return false;
+        }
+        
+        for (int j = 0; j < i; j++) {
+            uint64_t other = regions[j].base;
+            if (base < other + regions[j].size && other < end) {
+                LOG_ERROR("Memory region 0x%llx overlaps region 0x%llx",
+                          (unsigned long long)base, (unsigned long long)other);
+                return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+/**
+ * Free a context's memory regions; sim_t does not own them, so this
+ * runs after the simulator is deleted
+ */
+static void free_mems(spike_ctx_t* ctx) {
+    for (auto& mem : ctx->mems) delete mem.second;
+    ctx->mems.clear();
+    ctx->mems.shrink_to_fit();
+}
+
+/**
+ * Build a context's simulator over the given memory map
+ * @return Context, nullptr on failure
+ *
+ * mem_t backing comes from calloc, which serves large regions straight
+ * from anonymous mmap: pages are zero-filled on first touch, so init time
+ * and resident footprint do not grow with the configured region sizes.
+ */
+static spike_ctx_t* init_context(const char* isa_string, const spike_mem_region_t* regions, int count) {
+    if (!validate_mem_map(regions, count)) {
+        set_error(nullptr, SPIKE_ERR_CONFIG);
+        return nullptr;
+    }
+    
+    spike_ctx_t* ctx = alloc_context();
+    
+    try {
+        // Create memory regions; execution starts at the first one
+        std::vector<std::pair<reg_t, mem_t*>>& mems = ctx->mems;
+        mems.clear();
+        for (int i = 0; i < count; i++) {
+            mems.push_back(std::make_pair(reg_t(regions[i].base), new mem_t(regions[i].size)));
+        }
+        ctx->start_pc = regions[0].base;
+        
+        // Create simulator
+        std::vector<std::string> htif_args;
+        ctx->sim = new sim_t(
+            isa_string,           // ISA string
+            1,                    // Number of cores
+            false,                // Halted
+            ctx->start_pc,        // Start PC
+            mems,                 // Memory regions
+            htif_args,            // HTIF arguments
+            std::vector<int>()    // Hartids
+        );
+        
+        // Get processor handle; commit records come from the encoding, so
+        // Spike's commit logging (and its per-instruction output) stays off
+        ctx->proc = ctx->sim->get_core(0);
+        
+        // Spike resets mtvec to 0, which is not mapped. Trap to the start
+        // of memory instead, where the next injected instruction is stored
+        // like any other; stimulus that installs a handler overrides it.
+        get_state(ctx)->mtvec = ctx->start_pc;
+        ctx->direct_inject = false;
+        ctx->check_mask = SPIKE_CHECK_ALL;
+        ctx->ulp_tolerance = 0;
+        ctx->check_stats = spike_check_stats_t();
+        memset(ctx->call_stats, 0, sizeof(ctx->call_stats));
+        ctx->last_error = SPIKE_OK;
+        ctx->initialized = true;
+        
+        LOG_INFO("Spike initialized with ISA: %s", isa_string);
+        return ctx;
+        
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot initialize Spike: %s", e.what());
+        set_error(nullptr, SPIKE_ERR_CONFIG);
+        // Never handed out, so it can go
+        delete ctx->sim;
+        free_mems(ctx);
+        g_ctx_pool.pop_back();
+        delete ctx;
+        return nullptr;
+    }
+}
+
+//==============================================================================
+// DPI-C Exported Functions
+//==============================================================================
+
+extern "C" {
+
+void spike_close(void* handle);
+
+/**
+ * Initialize a Spike simulator instance with the default memory map
+ * @param isa_string - ISA string (e.g., "RV32IF", "RV64IMAFD")
+ * @return Context handle passed to every other call, null on failure
+ *
+ * Each call creates an independent instance; existing ones are untouched.
+ */
+void* spike_init(const char* isa_string) {
+    SPIKE_TIMED(nullptr, init);
+    spike_ctx_t* ctx = init_context(isa_string, g_default_mem_map,
+                                    sizeof(g_default_mem_map) / sizeof(g_default_mem_map[0]));
+    call_timer.bind(ctx);
+    return ctx;
+}
+
+/**
+ * Initialize a Spike simulator instance with a custom memory map
+ * @param isa_string - ISA string (e.g., "RV32IF", "RV64IMAFD")
+ * @param regions - Open array of spike_mem_region_t {base, size}; the
+ *                  first region's base is the reset PC
+ * @return Context handle passed to every other call, null on failure
+ */
+void* spike_init_mem(const char* isa_string, const svOpenArrayHandle regions) {
+    SPIKE_TIMED(nullptr, init_mem);
+    int count = svSize(regions, 1);
+    int lo = svLow(regions, 1);
+    std::vector<spike_mem_region_t> map(count > 0 ? count : 0);
+    
+    for (int i = 0; i < count; i++) {
+        map[i] = *(const spike_mem_region_t*)svGetArrElemPtr1(regions, lo + i);
+    }
+    
+    spike_ctx_t* ctx = init_context(isa_string, map.data(), count);
+    call_timer.bind(ctx);
+    return ctx;
+}
+
+/**
+ * Reset Spike state
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ */
+int spike_reset(void* handle) {
+    SPIKE_TIMED(handle, reset);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    try {
+        state_t* state = get_state(ctx);
+        
+        // Reset integer registers
+        for (int i = 0; i < NXPR; i++) {
+            state->XPR.write(i, 0);
+        }
+        
+        // Reset FP registers
+        for (int i = 0; i < NFPR; i++) {
+            state->FPR.write(i, 0);
+        }
+        
+        // Reset PC; traps also vector to the start of memory (see init_context)
+        state->pc = ctx->start_pc;
+        state->mtvec = ctx->start_pc;
+        
+        // Reset FCSR
+        state->fcsr = 0;
+        
+        LOG_DEBUG("Spike reset completed");
+        return SPIKE_OK;
+        
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot reset Spike: %s", e.what());
+        return set_error(ctx, SPIKE_ERR_EXECUTION);
+    }
+}
+
+/**
+ * Close a Spike instance. The handle stays invalid from then on; the
+ * context is not reused by later spike_init() calls.
+ */
+void spike_close(void* handle) {
+    spike_ctx_t* ctx = (spike_ctx_t*)handle;
+    
+    if (ctx != nullptr && ctx->initialized) {
+        if (ctx->async != nullptr) stop_async(ctx);
+        dump_call_stats(ctx);
+        trace_stop(ctx);
+        replay_stop(ctx);
+        delete ctx->coverage;
+        ctx->coverage = nullptr;
+        release_mem_tracking(ctx);
+        delete ctx->sim;
+        std::unordered_map<uint32_t, insn_func_t>().swap(ctx->decode_cache);
+        std::unordered_map<std::string, uint64_t>().swap(ctx->elf_symbols);
+        std::string().swap(ctx->check_report);
+        ctx->sim = nullptr;
+        ctx->proc = nullptr;
+        free_mems(ctx);
+        ctx->initialized = false;
+        LOG_INFO("Spike closed");
+        log_drain();
+    }
+}
+
+/**
+ * Checkpoint hart state and memory
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ *
+ * Memory is tracked copy-on-write: taking the checkpoint write-protects
+ * the memory regions, and each page is copied only when it is first
+ * written afterwards. A later checkpoint replaces this one.
+ *
+ * The write faults are caught by a process-wide SIGSEGV handler (see
+ * cow_fault_handler()). Faults elsewhere still reach the handler that was
+ * installed before, and a handler installed later is chained behind ours
+ * by the next spike_checkpoint() or digest call; until then, writes to
+ * tracked memory reach it instead, so a simulator or library that sets
+ * its own SIGSEGV handler mid-run should be followed by a new checkpoint.
+ */
+int spike_checkpoint(void* handle) {
+    SPIKE_TIMED(handle, checkpoint);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    spike_checkpoint_t& cp = ctx->checkpoint;
+    state_t* state = get_state(ctx);
+    
+    for (int i = 0; i < NXPR; i++) cp.xpr[i] = state->XPR[i];
+    for (int i = 0; i < NFPR; i++) cp.fpr[i] = state->FPR[i];
+    cp.pc = state->pc;
+    cp.fcsr = state->fcsr;
+    cp.minstret = state->minstret;
+    cp.mstatus = state->mstatus;
+    cp.mepc = state->mepc;
+    cp.mcause = state->mcause;
+    cp.mtval = state->mtval;
+    cp.mtvec = state->mtvec;
+    cp.prv = state->prv;
+    
+    if (track_memory(ctx) != SPIKE_OK) {
+        cp.valid = false;
+        return set_error(ctx, SPIKE_ERR_STATE);
+    }
+    
+    for (spike_cow_region_t* r : ctx->cow_regions) {
+        arm_cow_region(r);
+    }
+    cp.valid = true;
+    
+    return SPIKE_OK;
+}
+
+/**
+ * Return hart state and memory to the last checkpoint
+ * @return Number of memory pages restored, SPIKE_ERR_STATE if there is
+ *         no checkpoint
+ *
+ * The checkpoint stays valid, so many short tests can be forked from it.
+ */
+int spike_restore(void* handle) {
+    SPIKE_TIMED(handle, restore);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    spike_checkpoint_t& cp = ctx->checkpoint;
+    if (!cp.valid) {
+        LOG_ERROR("spike_restore called without a checkpoint");
+        return set_error(ctx, SPIKE_ERR_STATE);
+    }
+    
+    state_t* state = get_state(ctx);
+    for (int i = 0; i < NXPR; i++) state->XPR.write(i, cp.xpr[i]);
+    for (int i = 0; i < NFPR; i++) state->FPR.write(i, cp.fpr[i]);
+    state->pc = cp.pc;
+    state->fcsr = cp.fcsr;
+    state->minstret = cp.minstret;
+    state->mstatus = cp.mstatus;
+    state->mepc = cp.mepc;
+    state->mcause = cp.mcause;
+    state->mtval = cp.mtval;
+    state->mtvec = cp.mtvec;
+    state->prv = cp.prv;
+    
+    int pages = 0;
+    for (spike_cow_region_t* r : ctx->cow_regions) {
+        pages += (int)r->ndirty;
+        rollback_cow_region(r);
+    }
+    
+    // Previously fetched code may have been rolled back
+    ctx->proc->get_mmu()->flush_icache();
+    
+    return pages;
+}
+
+/**
+ * Read floating-point register
+ * @param reg_num - Register number (0-31)
+ * @return Register value as 32-bit integer
+ */
+int spike_read_freg(void* handle, int reg_num) {
+    SPIKE_TIMED(handle, read_freg);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return 0;
+    
+    if (reg_num < 0 || reg_num >= NFPR) {
+        LOG_ERROR("Invalid FP register number: %d", reg_num);
+        set_error(ctx, SPIKE_ERR_ARGUMENT);
+        return 0;
+    }
+    
+    try {
+        // Read FP register and return as 32-bit value
+        freg_t fp_value = get_state(ctx)->FPR[reg_num];
+        return fp_value.v[0] & 0xFFFFFFFF;  // Get lower 32 bits
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot read FP register: %s", e.what());
+        set_error(ctx, SPIKE_ERR_EXECUTION);
+        return 0;
+    }
+}
+
+/**
+ * Write floating-point register
+ * @param reg_num - Register number (0-31)
+ * @param value - 32-bit value to write
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ */
+int spike_write_freg(void* handle, int reg_num, int value) {
+    SPIKE_TIMED(handle, write_freg);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    if (reg_num < 0 || reg_num >= NFPR) {
+        LOG_ERROR("Invalid FP register number: %d", reg_num);
+        return set_error(ctx, SPIKE_ERR_ARGUMENT);
+    }
+    
+    try {
+        write_freg32(get_state(ctx), reg_num, value);
+        return SPIKE_OK;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot write FP register: %s", e.what());
+        return set_error(ctx, SPIKE_ERR_EXECUTION);
+    }
+}
+
+/**
+ * Read integer register
+ * @param reg_num - Register number (0-31)
+ * @return Register value
+ */
+int spike_read_xreg(void* handle, int reg_num) {
+    SPIKE_TIMED(handle, read_xreg);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return 0;
+    
+    if (reg_num < 0 || reg_num >= NXPR) {
+        LOG_ERROR("Invalid integer register number: %d", reg_num);
+        set_error(ctx, SPIKE_ERR_ARGUMENT);
+        return 0;
+    }
+    
+    try {
+        return get_state(ctx)->XPR[reg_num];
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot read integer register: %s", e.what());
+        set_error(ctx, SPIKE_ERR_EXECUTION);
+        return 0;
+    }
+}
+
+/**
+ * Write integer register
+ * @param reg_num - Register number (0-31)
+ * @param value - Value to write
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ */
+int spike_write_xreg(void* handle, int reg_num, int value) {
+    SPIKE_TIMED(handle, write_xreg);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    if (reg_num < 0 || reg_num >= NXPR) {
+        LOG_ERROR("Invalid integer register number: %d", reg_num);
+        return set_error(ctx, SPIKE_ERR_ARGUMENT);
+    }
+    
+    try {
+        get_state(ctx)->XPR.write(reg_num, value);
+        return SPIKE_OK;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot write integer register: %s", e.what());
+        return set_error(ctx, SPIKE_ERR_EXECUTION);
+    }
+}
+
+/**
+ * Read program counter
+ * @return Current PC value
+ */
+int spike_read_pc(void* handle) {
+    SPIKE_TIMED(handle, read_pc);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return 0;
+    
+    try {
+        return get_state(ctx)->pc;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot read PC: %s", e.what());
+        set_error(ctx, SPIKE_ERR_EXECUTION);
+        return 0;
+    }
+}
+
+/**
+ * Write program counter
+ * @param pc_value - New PC value, zero-extended like the memory addresses
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ */
+int spike_write_pc(void* handle, int pc_value) {
+    SPIKE_TIMED(handle, write_pc);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    try {
+        get_state(ctx)->pc = (uint32_t)pc_value;
+        return SPIKE_OK;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot write PC: %s", e.what());
+        return set_error(ctx, SPIKE_ERR_EXECUTION);
+    }
+}
+
+/**
+ * Read CSR (Control and Status Register)
+ * @param csr_addr - CSR address
+ * @return CSR value
+ */
+int spike_read_csr(void* handle, int csr_addr) {
+    SPIKE_TIMED(handle, read_csr);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return 0;
+    
+    try {
+        // Special handling for FCSR (0x003)
+        if (csr_addr == 0x003) {
+            return get_state(ctx)->fcsr;
+        }
+        // Add other CSRs as needed
+        return 0;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot read CSR: %s", e.what());
+        set_error(ctx, SPIKE_ERR_EXECUTION);
+        return 0;
+    }
+}
+
+/**
+ * Write CSR (Control and Status Register)
+ * @param csr_addr - CSR address
+ * @param value - Value to write
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ */
+int spike_write_csr(void* handle, int csr_addr, int value) {
+    SPIKE_TIMED(handle, write_csr);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    try {
+        // Special handling for FCSR (0x003)
+        if (csr_addr == 0x003) {
+            get_state(ctx)->fcsr = value;
+        }
+        // Add other CSRs as needed
+        return SPIKE_OK;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot write CSR: %s", e.what());
+        return set_error(ctx, SPIKE_ERR_EXECUTION);
+    }
+}
+
+/**
+ * Read the whole architectural state in one call
+ * @param state - Open array of at least SPIKE_ARCH_STATE_WORDS ints,
+ *                laid out as spike_arch_state_t
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ */
+int spike_get_arch_state(void* handle, const svOpenArrayHandle state) {
+    SPIKE_TIMED(handle, get_arch_state);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    if (svSize(state, 1) < (int)SPIKE_ARCH_STATE_WORDS) {
+        LOG_ERROR("spike_get_arch_state needs %zu words, got %d", SPIKE_ARCH_STATE_WORDS, svSize(state, 1));
+        return set_error(ctx, SPIKE_ERR_ARGUMENT);
+    }
+    
+    spike_arch_state_t snapshot;
+    state_t* s = get_state(ctx);
+    
+    for (int i = 0; i < NXPR; i++) snapshot.xregs[i] = (uint32_t)s->XPR[i];
+    for (int i = 0; i < NFPR; i++) snapshot.fregs[i] = (uint32_t)s->FPR[i].v[0];
+    snapshot.pc = (uint32_t)s->pc;
+    snapshot.fcsr = s->fcsr;
+    
+    const uint32_t* words = (const uint32_t*)&snapshot;
+    uint32_t* dst = (uint32_t*)svGetArrayPtr(state);
+    
+    if (dst != nullptr) {
+        memcpy(dst, words, sizeof(snapshot));
+    } else {
+        int lo = svLow(state, 1);
+        for (size_t i = 0; i < SPIKE_ARCH_STATE_WORDS; i++) {
+            *(uint32_t*)svGetArrElemPtr1(state, lo + (int)i) = words[i];
+        }
+    }
+    
+    return SPIKE_OK;
+}
+
+/**
+ * Write the selected parts of the architectural state in one call
+ * @param state - Open array laid out as spike_arch_state_t
+ * @param dirty - SPIKE_ARCH_STATE_WORDS-bit mask, bit i writes word i
+ * @return Number of words written, or a negative SPIKE_ERR_* code
+ */
+int spike_set_arch_state(void* handle, const svOpenArrayHandle state, const svBitVecVal* dirty) {
+    SPIKE_TIMED(handle, set_arch_state);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    if (svSize(state, 1) < (int)SPIKE_ARCH_STATE_WORDS) {
+        LOG_ERROR("spike_set_arch_state needs %zu words, got %d", SPIKE_ARCH_STATE_WORDS, svSize(state, 1));
+        return set_error(ctx, SPIKE_ERR_ARGUMENT);
+    }
+    
+    const uint32_t* src = (const uint32_t*)svGetArrayPtr(state);
+    int lo = svLow(state, 1);
+    state_t* s = get_state(ctx);
+    int written = 0;
+    
+    for (size_t i = 0; i < SPIKE_ARCH_STATE_WORDS; i++) {
+        if (!((dirty[i / 32] >> (i % 32)) & 1)) continue;
+        
+        uint32_t value = src ? src[i] : *(const uint32_t*)svGetArrElemPtr1(state, lo + (int)i);
+        
+        if (i < NXPR) {
+            s->XPR.write(i, (reg_t)(int64_t)(int32_t)value);
+        } else if (i < NXPR + NFPR) {
+            write_freg32(s, i - NXPR, value);
+        } else if (i == offsetof(spike_arch_state_t, pc) / sizeof(uint32_t)) {
+            s->pc = value;
+        } else {
+            s->fcsr = value;
+        }
+        written++;
+    }
+    
+    return written;
+}
+
+/**
+ * Execute a single instruction
+ * @param instruction - 32-bit instruction encoding
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ */
+int spike_execute_instruction(void* handle, int instruction) {
+    SPIKE_TIMED(handle, execute_instruction);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    try {
+        execute_one(ctx, instruction, nullptr, nullptr);
+        return SPIKE_OK;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot execute instruction 0x%08x: %s", (uint32_t)instruction, e.what());
+        return set_error(ctx, SPIKE_ERR_EXECUTION);
+    }
+}
+
+/**
+ * Execute a single instruction and return its commit record
+ * @param instruction - 32-bit instruction encoding
+ * @param commit - spike_commit_t record to fill
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ */
+int spike_execute_commit(void* handle, int instruction, svBitVecVal* commit) {
+    SPIKE_TIMED(handle, execute_commit);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    try {
+        execute_one(ctx, instruction, (spike_commit_t*)commit, nullptr);
+        return SPIKE_OK;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot execute instruction 0x%08x: %s", (uint32_t)instruction, e.what());
+        return set_error(ctx, SPIKE_ERR_EXECUTION);
+    }
+}
+
+/**
+ * Execute a single instruction and report whether it trapped
+ * @param instruction - 32-bit instruction encoding
+ * @param commit - spike_commit_t record to fill
+ * @param trap - spike_trap_t record, filled (cause, tval, epc) when the
+ *               instruction traps and zeroed when it retires
+ * @return SPIKE_OK if it retired, SPIKE_TRAPPED if it raised an exception
+ *         (the hart is then at the trap handler), or a negative
+ *         SPIKE_ERR_* code
+ *
+ * Misaligned loads and stores, and illegal encodings in direct-inject
+ * mode, are recognised before they run and no exception is thrown, so
+ * deliberate faults cost no more than ordinary instructions.
+ */
+int spike_execute_trap(void* handle, int instruction, svBitVecVal* commit, svBitVecVal* trap) {
+    SPIKE_TIMED(handle, execute_trap);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    spike_trap_t* t = (spike_trap_t*)trap;
+    memset(t, 0, sizeof(spike_trap_t));
+    
+    try {
+        return execute_one(ctx, instruction, (spike_commit_t*)commit, t) ? SPIKE_OK : SPIKE_TRAPPED;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot execute instruction 0x%08x: %s", (uint32_t)instruction, e.what());
+        return set_error(ctx, SPIKE_ERR_EXECUTION);
+    }
+}
+
+/**
+ * Execute a block of instructions in one call
+ * @param instructions - Open array of 32-bit instruction encodings
+ * @param results - Open array of spike_commit_t records, one per instruction
+ * @return Number of instructions executed, or a negative SPIKE_ERR_* code
+ *         if none could be
+ *
+ * Execution stops at the first instruction that fails; records up to that
+ * point are valid and the failure is kept for spike_get_last_error().
+ */
+int spike_execute_batch(void* handle, const svOpenArrayHandle instructions,
+                        const svOpenArrayHandle results) {
+    SPIKE_TIMED(handle, execute_batch);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    int count = svSize(instructions, 1);
+    if (svSize(results, 1) < count) {
+        LOG_ERROR("spike_execute_batch result array holds %d records for %d instructions",
+                  svSize(results, 1), count);
+        return set_error(ctx, SPIKE_ERR_ARGUMENT);
+    }
+    
+    int insn_lo = svLow(instructions, 1);
+    int result_lo = svLow(results, 1);
+    int executed = 0;
+    
+    try {
+        for (; executed < count; executed++) {
+            uint32_t instruction = *(const uint32_t*)svGetArrElemPtr1(instructions, insn_lo + executed);
+            spike_commit_t* commit = (spike_commit_t*)svGetArrElemPtr1(results, result_lo + executed);
+            execute_one(ctx, instruction, commit, nullptr);
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot execute batch entry %d: %s", executed, e.what());
+        set_error(ctx, SPIKE_ERR_EXECUTION);
+    }
+    
+    return executed;
+}
+
+/**
+ * Select how injected instructions are executed
+ * @param enable - 1: run from the decode cache without storing to memory,
+ *                 0: store at PC and step (default)
+ * @return SPIKE_OK, SPIKE_ERR_CONFIG if direct injection was left out of
+ *         the build (see SPIKE_DIRECT_INJECT at the top of this file), or
+ *         another negative SPIKE_ERR_* code
+ */
+int spike_set_direct_inject(void* handle, int enable) {
+    SPIKE_TIMED(handle, set_direct_inject);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+#ifndef SPIKE_DIRECT_INJECT
+    if (enable != 0) {
+        LOG_ERROR("Direct injection needs a build with -DSPIKE_DIRECT_INJECT; using fetched execution");
+        return set_error(ctx, SPIKE_ERR_CONFIG);
+    }
+#endif
+    ctx->direct_inject = (enable != 0);
+    return SPIKE_OK;
+}
+
+/**
+ * Turn asynchronous execution on or off
+ * @param enable - 1: start a worker thread that executes instructions
+ *                 queued by spike_submit(), 0: stop it (pending work is
+ *                 finished first, unpolled results are dropped)
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ *
+ * While the worker runs, every other call on this handle (register and
+ * memory access, checkpoints, synchronous execution) first waits for the
+ * queue to drain, so mixing them with submitted work stays consistent.
+ */
+int spike_set_async(void* handle, int enable) {
+    SPIKE_TIMED(handle, set_async);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    try {
+        if (enable && ctx->async == nullptr) {
+            start_async(ctx);
+        } else if (!enable && ctx->async != nullptr) {
+            stop_async(ctx);
+        }
+        return SPIKE_OK;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Cannot start Spike worker: %s", e.what());
+        return set_error(ctx, SPIKE_ERR_EXECUTION);
+    }
+}
+
+/**
+ * Queue an instruction for the worker thread
+ * @param instruction - 32-bit instruction encoding
+ * @return Ticket for spike_poll_result(); SPIKE_ERR_STATE if asynchronous
+ *         mode is off, SPIKE_ERR_BUSY if SPIKE_ASYNC_RING_SIZE results are
+ *         waiting to be polled
+ *
+ * Instructions execute in submission order.
+ */
+int spike_submit(void* handle, int instruction) {
+    SPIKE_TIMED(handle, submit);
+    spike_ctx_t* ctx = lookup_context(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    spike_async_t* q = ctx->async;
+    if (q == nullptr) {
+        LOG_ERROR("spike_submit called without spike_set_async(1)");
+        return set_error(ctx, SPIKE_ERR_STATE);
+    }
+    
+    uint64_t seq = q->submitted.load(std::memory_order_relaxed);
+    if (seq - q->retired >= SPIKE_ASYNC_RING_SIZE) {
+        LOG_WARN("Spike async queue full (%u unpolled results)", SPIKE_ASYNC_RING_SIZE);
+        return set_error(ctx, SPIKE_ERR_BUSY);
+    }
+    
+    spike_async_slot_t* slot = &q->slots[seq & (SPIKE_ASYNC_RING_SIZE - 1)];
+    slot->instruction = (uint32_t)instruction;
+    slot->polled = false;
+    q->submitted.store(seq + 1, std::memory_order_release);
+    
+    return (int)(seq & SPIKE_ASYNC_TICKET_MASK);
+}
+
+/**
+ * Collect the result of a submitted instruction
+ * @param ticket - Value returned by spike_submit()
+ * @param commit - spike_commit_t record filled when the result is ready
+ * @return 1 if ready, 0 if still pending; SPIKE_ERR_ARGUMENT for an
+ *         unknown or already polled ticket, SPIKE_ERR_EXECUTION if the
+ *         instruction failed
+ *
+ * Results may be polled in any order; each can be polled once.
+ */
+int spike_poll_result(void* handle, int ticket, svBitVecVal* commit) {
+    SPIKE_TIMED(handle, poll_result);
+    spike_ctx_t* ctx = lookup_context(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    if (ctx->async == nullptr) return set_error(ctx, SPIKE_ERR_STATE);
+    
+    spike_async_t* q = ctx->async;
+    uint64_t submitted = q->submitted.load(std::memory_order_relaxed);
+    uint64_t seq = q->retired + (((uint32_t)ticket - (uint32_t)q->retired) & SPIKE_ASYNC_TICKET_MASK);
+    if (ticket < 0 || seq >= submitted) {
+        LOG_ERROR("Unknown Spike async ticket %d", ticket);
+        return set_error(ctx, SPIKE_ERR_ARGUMENT);
+    }
+    if (seq >= q->completed.load(std::memory_order_acquire)) return 0;
+    
+    spike_async_slot_t* slot = &q->slots[seq & (SPIKE_ASYNC_RING_SIZE - 1)];
+    if (slot->polled) {
+        LOG_ERROR("Spike async ticket %d already polled", ticket);
+        return set_error(ctx, SPIKE_ERR_ARGUMENT);
+    }
+    
+    memcpy(commit, &slot->commit, sizeof(spike_commit_t));
+    slot->polled = true;
+    
+    // Release the contiguous run of polled slots at the head
+    uint64_t completed = q->completed.load(std::memory_order_acquire);
+    while (q->retired < completed && q->slots[q->retired & (SPIKE_ASYNC_RING_SIZE - 1)].polled) {
+        q->retired++;
+    }
+    
+    return (slot->status == SPIKE_OK) ? 1 : set_error(ctx, slot->status);
+}
+
+/**
+ * Start recording every executed instruction to a binary commit trace
+ * @param path - Output file (spike_trace.h format), replaced if it exists
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ *
+ * Any trace already being recorded is closed first. Compare traces with
+ * the spike_trace_diff tool.
+ */
+int spike_trace_open(void* handle, const char* path) {
+    SPIKE_TIMED(handle, trace_open);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    trace_stop(ctx);
+    
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Cannot create commit trace %s", path);
+        return set_error(ctx, SPIKE_ERR_IO);
+    }
+    // Records reach the file in SPIKE_TRACE_BUFFER_RECORDS chunks already
+    setvbuf(file, nullptr, _IONBF, 0);
+    
+    spike_trace_header_t header = {};
+    memcpy(header.magic, SPIKE_TRACE_MAGIC, sizeof(header.magic));
+    header.version = SPIKE_TRACE_VERSION;
+    header.record_size = sizeof(spike_trace_record_t);
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        LOG_ERROR("Failed writing commit trace %s", path);
+        fclose(file);
+        return set_error(ctx, SPIKE_ERR_IO);
     }
+    
+    spike_trace_t* t = new spike_trace_t();
+    t->file = file;
+    t->path = path;
+    t->buffer.reserve(SPIKE_TRACE_BUFFER_RECORDS);
+    t->records = 0;
+    t->failed = false;
+    ctx->trace = t;
+    return SPIKE_OK;
 }
 
-static processor_t* get_processor() {
-    check_initialized();
-    return g_spike_proc;
+/**
+ * Stop recording the commit trace and close the file
+ * @return Number of records written, or a negative SPIKE_ERR_* code
+ */
+int spike_trace_close(void* handle) {
+    SPIKE_TIMED(handle, trace_close);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    int64_t records = trace_stop(ctx);
+    if (records < 0) return set_error(ctx, SPIKE_ERR_IO);
+    return (records > 0x7FFFFFFF) ? 0x7FFFFFFF : (int)records;
 }
 
-static state_t* get_state() {
-    return get_processor()->get_state();
+/**
+ * Precompute the results of a stimulus file for replay
+ * @param isa_string - ISA string, as for spike_init()
+ * @param stimulus_path - Stimulus (see parse_stimulus() for the format)
+ * @param results_path - Output results file (commit trace format)
+ * @param threads - Worker count; 0 uses every host core
+ * @param direct_inject - Execution mode, as for spike_set_direct_inject();
+ *                        must match the mode used at simulation time
+ * @return Number of results written, or a negative SPIKE_ERR_* code
+ *
+ * Segments start from the reset state with memory as it was after init,
+ * so they are independent and are shared out between threads, each with
+ * its own Spike instance (on the default memory map). Every result is
+ * written straight to its final place in the mapped output file.
+ * Stimulus whose segments communicate through memory must be one segment.
+ */
+int spike_replay_generate(const char* isa_string, const char* stimulus_path,
+                          const char* results_path, int threads, int direct_inject) {
+    std::vector<spike_stim_segment_t> segments;
+    if (!parse_stimulus(stimulus_path, segments)) return set_error(nullptr, SPIKE_ERR_IO);
+    
+    size_t total = 0;
+    for (spike_stim_segment_t& seg : segments) {
+        seg.first_record = total;
+        total += seg.instructions;
+    }
+    
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    // One copy-on-write region per instance
+    threads = std::max(1, std::min({threads, (int)segments.size(), SPIKE_MAX_COW_REGIONS}));
+    
+    // Size the output and map it so workers can fill their slices in place
+    size_t size = sizeof(spike_trace_header_t) + total * sizeof(spike_trace_record_t);
+    int fd = open(results_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)size) != 0) {
+        LOG_ERROR("Cannot create replay results %s", results_path);
+        if (fd >= 0) close(fd);
+        return set_error(nullptr, SPIKE_ERR_IO);
+    }
+    char* map = (char*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Cannot map replay results %s", results_path);
+        return set_error(nullptr, SPIKE_ERR_IO);
+    }
+    
+    spike_trace_header_t* header = (spike_trace_header_t*)map;
+    memcpy(header->magic, SPIKE_TRACE_MAGIC, sizeof(header->magic));
+    header->version = SPIKE_TRACE_VERSION;
+    header->record_size = sizeof(spike_trace_record_t);
+    spike_trace_record_t* records = (spike_trace_record_t*)(map + sizeof(spike_trace_header_t));
+    
+    // Instances are built and checkpointed here: the context pool and
+    // the copy-on-write region table are not thread safe
+    std::vector<void*> instances;
+    bool ok = true;
+    for (int i = 0; i < threads && ok; i++) {
+        void* handle = spike_init(isa_string);
+        ok = (handle != nullptr);
+        if (ok) {
+            instances.push_back(handle);
+            ok = (spike_set_direct_inject(handle, direct_inject) == 0);
+            spike_reset(handle);
+            ok = ok && (spike_checkpoint(handle) == 0);
+        }
+    }
+    
+    std::atomic<size_t> next_segment(0);
+    std::atomic<bool> failed(!ok);
+    std::vector<std::thread> workers;
+    
+    for (size_t i = 0; i < instances.size() && ok; i++) {
+        workers.emplace_back([&, i]() {
+            spike_ctx_t* ctx = (spike_ctx_t*)instances[i];
+            size_t n;
+            while (!failed.load(std::memory_order_relaxed) &&
+                   (n = next_segment.fetch_add(1)) < segments.size()) {
+                try {
+                    generate_segment(ctx, segments[n], records + segments[n].first_record);
+                } catch (const std::exception& e) {
+                    LOG_ERROR("Cannot generate replay segment %zu: %s", n, e.what());
+                    failed = true;
+                }
+            }
+        });
+    }
+    for (std::thread& w : workers) w.join();
+    
+    for (void* handle : instances) spike_close(handle);
+    msync(map, size, MS_SYNC);
+    munmap(map, size);
+    
+    if (failed) return set_error(nullptr, SPIKE_ERR_EXECUTION);
+    LOG_INFO("Replay results: %zu instructions in %zu segments, %d threads",
+             total, segments.size(), threads);
+    return (total > 0x7FFFFFFF) ? 0x7FFFFFFF : (int)total;
 }
 
-//==============================================================================
-// DPI-C Exported Functions
-//==============================================================================
+/**
+ * Replay precomputed results instead of executing instructions
+ * @param path - Results file from spike_replay_generate()
+ * @return Number of results available, or a negative SPIKE_ERR_* code
+ *
+ * Each executed instruction then takes the next result in order; an
+ * instruction that differs from the one the result was generated for, or
+ * that would read different source operands, is reported as an execution
+ * error. Results are written back to the hart,
+ * so register, PC and memory reads stay meaningful.
+ */
+int spike_replay_open(void* handle, const char* path) {
+    SPIKE_TIMED(handle, replay_open);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    replay_stop(ctx);
+    
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(spike_trace_header_t)) {
+        LOG_ERROR("Cannot read replay results %s", path);
+        if (fd >= 0) close(fd);
+        return set_error(ctx, SPIKE_ERR_IO);
+    }
+    
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Cannot map replay results %s", path);
+        return set_error(ctx, SPIKE_ERR_IO);
+    }
+    
+    const spike_trace_header_t* header = (const spike_trace_header_t*)map;
+    if (memcmp(header->magic, SPIKE_TRACE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SPIKE_TRACE_VERSION ||
+        header->record_size != sizeof(spike_trace_record_t)) {
+        LOG_ERROR("%s is not a replay results file", path);
+        munmap(map, size);
+        return set_error(ctx, SPIKE_ERR_IO);
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    
+    spike_replay_t* rp = new spike_replay_t();
+    rp->map = map;
+    rp->map_size = size;
+    rp->records = (const spike_trace_record_t*)((const char*)map + sizeof(spike_trace_header_t));
+    rp->count = (size - sizeof(spike_trace_header_t)) / sizeof(spike_trace_record_t);
+    rp->next = 0;
+    ctx->replay = rp;
+    
+    return (rp->count > 0x7FFFFFFF) ? 0x7FFFFFFF : (int)rp->count;
+}
 
-extern "C" {
+/**
+ * Leave replay mode and go back to executing instructions
+ * @return Number of results consumed, or a negative SPIKE_ERR_* code
+ */
+int spike_replay_close(void* handle) {
+    SPIKE_TIMED(handle, replay_close);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    size_t consumed = replay_stop(ctx);
+    return (consumed > 0x7FFFFFFF) ? 0x7FFFFFFF : (int)consumed;
+}
 
 /**
- * Initialize Spike simulator
- * @param isa_string - ISA string (e.g., "RV32IF", "RV64IMAFD")
+ * Configure spike_check_commit()
+ * @param check_mask - SPIKE_CHECK_* fields to compare
+ * @param ulp_tolerance - Allowed FP result distance in ULPs (0: exact bits)
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
  */
-void spike_init(const char* isa_string) {
-    try {
-        if (g_spike_initialized) {
-            std::cout << "WARNING: Spike already initialized, re-initializing..." << std::endl;
-            spike_close();
-        }
-        
-        // Create memory region (128MB at 0x80000000)
-        std::vector<std::pair<reg_t, mem_t*>> mems;
-        mems.push_back(std::make_pair(reg_t(0x80000000), new mem_t(0x8000000)));
-        
-        // Create simulator
-        std::vector<std::string> htif_args;
-        g_spike_sim = new sim_t(
-            isa_string,           // ISA string
-            1,                    // Number of cores
-            false,                // Halted
-            0x80000000,           // Start PC
-            mems,                 // Memory regions
-            htif_args,            // HTIF arguments
-            std::vector<int>()    // Hartids
-        );
-        
-        // Get processor handle
-        g_spike_proc = g_spike_sim->get_core(0);
-        g_spike_initialized = true;
-        
-        std::cout << "Spike initialized with ISA: " << isa_string << std::endl;
-        
-    } catch (const std::exception& e) {
-        std::cerr << "ERROR initializing Spike: " << e.what() << std::endl;
-        g_spike_initialized = false;
-    }
+int spike_set_check_config(void* handle, int check_mask, int ulp_tolerance) {
+    SPIKE_TIMED(handle, set_check_config);
+    spike_ctx_t* ctx = lookup_context(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    ctx->check_mask = (uint32_t)check_mask & SPIKE_CHECK_ALL;
+    ctx->ulp_tolerance = (ulp_tolerance > 0) ? (uint32_t)ulp_tolerance : 0;
+    return SPIKE_OK;
 }
 
 /**
- * Reset Spike state
+ * Compare what the DUT retired against a Spike commit record
+ * @param commit - spike_commit_t from spike_execute_commit() and friends
+ * @param dut_pc - PC observed on the DUT
+ * @param dut_rd - Destination descriptor (SPIKE_RD_* layout), -1 if not observed
+ * @param dut_value - Destination value observed on the DUT
+ * @param dut_fflags - fflags raised by the DUT, -1 if not observed
+ * @param report - Set to a formatted description of the mismatches, or to
+ *                 an empty string when everything matches
+ * @return 0 on a match, else the SPIKE_CHECK_* mask of differing fields;
+ *         SPIKE_ERR_NOT_INITIALIZED if the handle is invalid
+ *
+ * Totals are kept per instance and read with spike_get_check_stats(), so
+ * a passing check costs no formatting on either side of the DPI.
  */
-void spike_reset() {
-    check_initialized();
+int spike_check_commit(void* handle, const svBitVecVal* commit, int dut_pc, int dut_rd,
+                       int dut_value, int dut_fflags, const char** report) {
+    SPIKE_TIMED(handle, check_commit);
+    spike_ctx_t* ctx = lookup_context(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
     
-    try {
-        state_t* state = get_state();
-        
-        // Reset integer registers
-        for (int i = 0; i < NXPR; i++) {
-            state->XPR.write(i, 0);
+    const spike_commit_t* c = (const spike_commit_t*)commit;
+    spike_check_stats_t& stats = ctx->check_stats;
+    uint32_t mask = ctx->check_mask;
+    uint32_t status = 0;
+    uint32_t ulp = 0;
+    bool rd_valid = (c->rd & SPIKE_RD_VALID) != 0;
+    bool rd_fp = (c->rd & SPIKE_RD_FP) != 0;
+    
+    stats.checks++;
+    
+    if ((mask & SPIKE_CHECK_PC) && c->pc != (uint32_t)dut_pc) {
+        status |= SPIKE_CHECK_PC;
+        stats.pc_mismatches++;
+    }
+    
+    if ((mask & SPIKE_CHECK_RD) && dut_rd >= 0 && rd_valid &&
+        (c->rd & (SPIKE_RD_FP | SPIKE_RD_INDEX_MASK)) !=
+        ((uint32_t)dut_rd & (SPIKE_RD_FP | SPIKE_RD_INDEX_MASK))) {
+        status |= SPIKE_CHECK_RD;
+        stats.rd_mismatches++;
+    }
+    
+    if ((mask & SPIKE_CHECK_FREG) && rd_valid && rd_fp) {
+        if (!fp32_within(c->value, (uint32_t)dut_value, ctx->ulp_tolerance, &ulp)) {
+            status |= SPIKE_CHECK_FREG;
+            stats.freg_mismatches++;
+        } else if (ulp > stats.max_ulp) {
+            stats.max_ulp = ulp;
         }
-        
-        // Reset FP registers
-        for (int i = 0; i < NFPR; i++) {
-            state->FPR.write(i, 0);
+    }
+    
+    if ((mask & SPIKE_CHECK_XREG) && rd_valid && !rd_fp && c->value != (uint32_t)dut_value) {
+        status |= SPIKE_CHECK_XREG;
+        stats.xreg_mismatches++;
+    }
+    
+    uint32_t spike_fflags = c->fcsr_delta & SPIKE_FFLAGS_MASK;
+    if ((mask & SPIKE_CHECK_FFLAGS) && dut_fflags >= 0 &&
+        spike_fflags != ((uint32_t)dut_fflags & SPIKE_FFLAGS_MASK)) {
+        status |= SPIKE_CHECK_FFLAGS;
+        stats.fflags_mismatches++;
+    }
+    
+    if (status == 0) {
+        stats.passed++;
+        *report = "";
+        return 0;
+    }
+    
+    // Failure path only: format the details
+    std::string& r = ctx->check_report;
+    r.clear();
+    if (status & SPIKE_CHECK_PC) {
+        append_report(r, "\n  ✗ PC Mismatch:\n    Expected (Spike): 0x%08x\n    Got (DUT):        0x%08x",
+                      c->pc, (uint32_t)dut_pc);
+    }
+    if (status & SPIKE_CHECK_RD) {
+        append_report(r, "\n  ✗ Destination Mismatch:\n    Expected (Spike): %c%u\n    Got (DUT):        %c%u",
+                      rd_fp ? 'f' : 'x', c->rd & SPIKE_RD_INDEX_MASK,
+                      (dut_rd & SPIKE_RD_FP) ? 'f' : 'x', (uint32_t)dut_rd & SPIKE_RD_INDEX_MASK);
+    }
+    if (status & (SPIKE_CHECK_FREG | SPIKE_CHECK_XREG)) {
+        if (rd_fp) {
+            append_report(r, "\n  ✗ FP Register f%u Mismatch:\n    Expected (Spike): 0x%08x (%.9g)\n"
+                          "    Got (DUT):        0x%08x (%.9g)",
+                          c->rd & SPIKE_RD_INDEX_MASK, c->value, bits_to_float(c->value),
+                          (uint32_t)dut_value, bits_to_float((uint32_t)dut_value));
+            if (ulp != 0) {
+                append_report(r, "\n    Distance:         %u ULP (tolerance: %u)", ulp, ctx->ulp_tolerance);
+            }
+        } else {
+            append_report(r, "\n  ✗ Integer Register x%u Mismatch:\n    Expected (Spike): 0x%08x\n"
+                          "    Got (DUT):        0x%08x",
+                          c->rd & SPIKE_RD_INDEX_MASK, c->value, (uint32_t)dut_value);
         }
-        
-        // Reset PC
-        state->pc = 0x80000000;
-        
-        // Reset FCSR
-        state->fcsr = 0;
-        
-        std::cout << "Spike reset completed" << std::endl;
-        
-    } catch (const std::exception& e) {
-        std::cerr << "ERROR resetting Spike: " << e.what() << std::endl;
     }
+    if (status & SPIKE_CHECK_FFLAGS) {
+        uint32_t d = (uint32_t)dut_fflags;
+        append_report(r, "\n  ✗ FFLAGS Mismatch:\n    Expected (Spike): NV=%u DZ=%u OF=%u UF=%u NX=%u"
+                      "\n    Got (DUT):        NV=%u DZ=%u OF=%u UF=%u NX=%u",
+                      (spike_fflags >> 4) & 1, (spike_fflags >> 3) & 1, (spike_fflags >> 2) & 1,
+                      (spike_fflags >> 1) & 1, spike_fflags & 1,
+                      (d >> 4) & 1, (d >> 3) & 1, (d >> 2) & 1, (d >> 1) & 1, d & 1);
+    }
+    
+    *report = r.c_str();
+    return (int)status;
 }
 
 /**
- * Close and cleanup Spike
+ * Read the totals accumulated by spike_check_commit()
+ * @param stats - Open array of at least SPIKE_CHECK_STATS_WORDS ints,
+ *                laid out as spike_check_stats_t
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
  */
-void spike_close() {
-    if (g_spike_sim != nullptr) {
-        delete g_spike_sim;
-        g_spike_sim = nullptr;
-        g_spike_proc = nullptr;
-        g_spike_initialized = false;
-        std::cout << "Spike closed" << std::endl;
+int spike_get_check_stats(void* handle, const svOpenArrayHandle stats) {
+    SPIKE_TIMED(handle, get_check_stats);
+    spike_ctx_t* ctx = lookup_context(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    if (svSize(stats, 1) < (int)SPIKE_CHECK_STATS_WORDS) {
+        LOG_ERROR("spike_get_check_stats needs %zu words, got %d", SPIKE_CHECK_STATS_WORDS, svSize(stats, 1));
+        return set_error(ctx, SPIKE_ERR_ARGUMENT);
+    }
+    
+    const uint32_t* words = (const uint32_t*)&ctx->check_stats;
+    int lo = svLow(stats, 1);
+    for (size_t i = 0; i < SPIKE_CHECK_STATS_WORDS; i++) {
+        *(uint32_t*)svGetArrElemPtr1(stats, lo + (int)i) = words[i];
     }
+    return SPIKE_OK;
 }
 
 /**
- * Read floating-point register
- * @param reg_num - Register number (0-31)
- * @return Register value as 32-bit integer
+ * Read the per entry point call statistics
+ * @param stats - Open array of longint, SPIKE_CALL_STATS_WORDS per entry
+ *                point in spike_get_stat_name() order: calls, total ns,
+ *                max ns, p50 ns, p90 ns, p99 ns. Entries that do not fit
+ *                are left out.
+ * @return Number of entry points, or a negative SPIKE_ERR_* code
+ *
+ * Percentiles are the upper edge of a power-of-two latency bucket.
  */
-int spike_read_freg(int reg_num) {
-    check_initialized();
+int spike_get_stats(void* handle, const svOpenArrayHandle stats) {
+    spike_ctx_t* ctx = lookup_context(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
     
-    if (reg_num < 0 || reg_num >= NFPR) {
-        std::cerr << "ERROR: Invalid FP register number: " << reg_num << std::endl;
-        return 0;
-    }
+    int lo = svLow(stats, 1);
+    int fit = std::min(svSize(stats, 1) / SPIKE_CALL_STATS_WORDS, (int)SPIKE_EP_COUNT);
+    double tpn = ticks_per_ns();
     
-    try {
-        // Read FP register and return as 32-bit value
-        freg_t fp_value = get_state()->FPR[reg_num];
-        return fp_value.v[0] & 0xFFFFFFFF;  // Get lower 32 bits
-    } catch (const std::exception& e) {
-        std::cerr << "ERROR reading FP register: " << e.what() << std::endl;
-        return 0;
+    for (int i = 0; i < fit; i++) {
+        const spike_call_stats_t& st = ctx->call_stats[i];
+        int64_t words[SPIKE_CALL_STATS_WORDS] = {
+            (int64_t)st.calls,
+            (int64_t)(st.ticks / tpn),
+            (int64_t)(st.max_ticks / tpn),
+            (int64_t)(percentile_ticks(st, 0.50) / tpn),
+            (int64_t)(percentile_ticks(st, 0.90) / tpn),
+            (int64_t)(percentile_ticks(st, 0.99) / tpn)
+        };
+        for (int w = 0; w < SPIKE_CALL_STATS_WORDS; w++) {
+            *(int64_t*)svGetArrElemPtr1(stats, lo + i * SPIKE_CALL_STATS_WORDS + w) = words[w];
+        }
     }
+    return SPIKE_EP_COUNT;
 }
 
 /**
- * Write floating-point register
- * @param reg_num - Register number (0-31)
- * @param value - 32-bit value to write
+ * Name of an entry point in spike_get_stats() order
+ * @return Function name, empty string if out of range
+ */
+const char* spike_get_stat_name(int index) {
+    if (index < 0 || index >= SPIKE_EP_COUNT) return "";
+    return g_entry_point_names[index];
+}
+
+/**
+ * Choose which diagnostics are logged, for every instance
+ * @param level - SPIKE_LOG_DEBUG, _INFO, _WARN, _ERROR or _OFF
+ * @return Previous level
+ *
+ * Call before spike_init() so initialization messages follow it too.
  */
-void spike_write_freg(int reg_num, int value) {
-    check_initialized();
+int spike_set_log_level(int level) {
+    level = std::max((int)SPIKE_LOG_DEBUG, std::min(level, (int)SPIKE_LOG_OFF));
+    return g_log_level.exchange(level, std::memory_order_relaxed);
+}
+
+/**
+ * Read and clear the most recent failure
+ * @param handle - Instance to ask about; null (or a closed handle) gives
+ *                 failures that had no instance, such as spike_init()
+ * @return SPIKE_ERR_* code, SPIKE_OK if nothing failed since the last call
+ */
+int spike_get_last_error(void* handle) {
+    spike_ctx_t* ctx = (spike_ctx_t*)handle;
+    if (ctx == nullptr || !ctx->initialized) {
+        return g_last_error.exchange(SPIKE_OK, std::memory_order_relaxed);
+    }
     
-    if (reg_num < 0 || reg_num >= NFPR) {
-        std::cerr << "ERROR: Invalid FP register number: " << reg_num << std::endl;
-        return;
+    int code = ctx->last_error;
+    ctx->last_error = SPIKE_OK;
+    return code;
+}
+
+/**
+ * Describe a status code
+ */
+const char* spike_error_string(int code) {
+    switch (code) {
+        case SPIKE_OK:                  return "success";
+        case SPIKE_ERR_NOT_INITIALIZED: return "Spike not initialized";
+        case SPIKE_ERR_ARGUMENT:        return "invalid argument";
+        case SPIKE_ERR_STATE:           return "not valid in the current mode";
+        case SPIKE_ERR_EXECUTION:       return "Spike execution error";
+        case SPIKE_ERR_IO:              return "file error";
+        case SPIKE_ERR_BUSY:            return "asynchronous queue full";
+        case SPIKE_ERR_CONFIG:          return "invalid configuration";
+        case SPIKE_ERR_LIMIT:           return "step limit reached";
+        default:                        return "unknown error";
     }
+}
+
+/**
+ * Step one instruction (without specifying instruction)
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ *
+ * The instruction is fetched from memory. It is recorded to the commit
+ * trace when one is open.
+ */
+int spike_step_one(void* handle) {
+    SPIKE_TIMED(handle, step_one);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
     
     try {
-        // Create freg_t with 32-bit value (NaN-boxed for RV64)
-        freg_t fp_value;
-        fp_value.v[0] = value;
-        fp_value.v[1] = 0xFFFFFFFFFFFFFFFFULL;  // NaN-box upper bits
-        get_state()->FPR.write(reg_num, fp_value);
+        if (ctx->trace != nullptr && ctx->replay == nullptr) {
+            step_traced(ctx);
+        } else {
+            ctx->proc->step(1);
+        }
+        return SPIKE_OK;
     } catch (const std::exception& e) {
-        std::cerr << "ERROR writing FP register: " << e.what() << std::endl;
+        LOG_ERROR("Cannot step: %s", e.what());
+        return set_error(ctx, SPIKE_ERR_EXECUTION);
     }
 }
 
 /**
- * Read integer register
- * @param reg_num - Register number (0-31)
- * @return Register value
+ * Load an ELF program and point the PC at its entry
+ * @param path - RISC-V ELF executable (32 or 64-bit); each PT_LOAD
+ *               segment must fit in one region of the memory map, at
+ *               its physical address
+ * @return Number of segments loaded, or a negative SPIKE_ERR_* code
+ *
+ * Segments are copied straight into Spike's memory in one block each,
+ * with no per-word stores through the MMU.
+ * The symbol table is kept for spike_elf_symbol() and the tohost stop
+ * condition of spike_run_until().
  */
-int spike_read_xreg(int reg_num) {
-    check_initialized();
+int spike_load_elf(void* handle, const char* path) {
+    SPIKE_TIMED(handle, load_elf);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
     
-    if (reg_num < 0 || reg_num >= NXPR) {
-        std::cerr << "ERROR: Invalid integer register number: " << reg_num << std::endl;
-        return 0;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < EI_NIDENT) {
+        LOG_ERROR("Cannot read ELF program %s", path);
+        if (fd >= 0) close(fd);
+        return set_error(ctx, SPIKE_ERR_IO);
     }
     
-    try {
-        return get_state()->XPR[reg_num];
-    } catch (const std::exception& e) {
-        std::cerr << "ERROR reading integer register: " << e.what() << std::endl;
-        return 0;
+    size_t size = (size_t)st.st_size;
+    const char* file = (const char*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (file == (const char*)MAP_FAILED) {
+        LOG_ERROR("Cannot map ELF program %s", path);
+        close(fd);
+        return set_error(ctx, SPIKE_ERR_IO);
+    }
+    
+    const unsigned char* ident = (const unsigned char*)file;
+    reg_t entry = 0;
+    int result;
+    
+    if (memcmp(ident, ELFMAG, SELFMAG) != 0 || ident[EI_DATA] != ELFDATA2LSB) {
+        LOG_ERROR("%s is not a little-endian ELF file", path);
+        result = SPIKE_ERR_ARGUMENT;
+    } else if (ident[EI_CLASS] == ELFCLASS32 && size >= sizeof(Elf32_Ehdr)) {
+        result = load_elf_image<Elf32_Ehdr, Elf32_Phdr, Elf32_Shdr, Elf32_Sym>(ctx, path, file, size, &entry);
+    } else if (ident[EI_CLASS] == ELFCLASS64 && size >= sizeof(Elf64_Ehdr)) {
+        result = load_elf_image<Elf64_Ehdr, Elf64_Phdr, Elf64_Shdr, Elf64_Sym>(ctx, path, file, size, &entry);
+    } else {
+        LOG_ERROR("%s: unsupported ELF class", path);
+        result = SPIKE_ERR_ARGUMENT;
     }
+    
+    munmap((void*)file, size);
+    close(fd);
+    if (result < 0) return set_error(ctx, result);
+    
+    get_state(ctx)->pc = entry;
+    ctx->proc->get_mmu()->flush_icache();
+    LOG_INFO("Loaded %s: %d segments, entry 0x%llx", path, result, (unsigned long long)entry);
+    return result;
 }
 
 /**
- * Write integer register
- * @param reg_num - Register number (0-31)
- * @param value - Value to write
+ * Address of a symbol in the program loaded by spike_load_elf()
+ * @return Symbol value, SPIKE_ERR_ARGUMENT if it is not defined
  */
-void spike_write_xreg(int reg_num, int value) {
-    check_initialized();
+int64_t spike_elf_symbol(void* handle, const char* name) {
+    spike_ctx_t* ctx = lookup_context(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
     
-    if (reg_num < 0 || reg_num >= NXPR) {
-        std::cerr << "ERROR: Invalid integer register number: " << reg_num << std::endl;
-        return;
+    auto it = ctx->elf_symbols.find(name);
+    if (it == ctx->elf_symbols.end()) return set_error(ctx, SPIKE_ERR_ARGUMENT);
+    return (int64_t)it->second;
+}
+
+/**
+ * Run from the current PC natively until a stop condition holds
+ * @param mode - SPIKE_RUN_PC: until the PC equals target;
+ *               SPIKE_RUN_INSTRET: until target more instructions retire;
+ *               SPIKE_RUN_TOHOST: until the 64-bit word at target (0: the
+ *               loaded program's tohost symbol) becomes non-zero
+ * @param max_steps - Give up after this many steps, trapped ones
+ *                    included; 0 for no limit
+ * @param retired - Set to the number of instructions retired
+ * @return SPIKE_OK when the condition holds, SPIKE_ERR_LIMIT if
+ *         max_steps ran out first, or another negative SPIKE_ERR_* code
+ *
+ * Spike steps SPIKE_RUN_CHUNK instructions per call (one at a time when
+ * stopping on a PC) and takes traps itself. While a commit trace is open
+ * every instruction is stepped on its own and recorded, which is much
+ * slower. The call is refused while replaying precomputed results.
+ */
+int spike_run_until(void* handle, int mode, int64_t target, int64_t max_steps, int64_t* retired) {
+    SPIKE_TIMED(handle, run_until);
+    *retired = 0;
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    if (ctx->replay != nullptr) {
+        LOG_ERROR("spike_run_until called while replaying precomputed results");
+        return set_error(ctx, SPIKE_ERR_STATE);
     }
     
+    const char* tohost = nullptr;
+    if (mode == SPIKE_RUN_TOHOST) {
+        uint64_t addr = (uint64_t)target;
+        auto it = ctx->elf_symbols.find("tohost");
+        if (addr == 0 && it != ctx->elf_symbols.end()) addr = it->second;
+        
+        tohost = (addr != 0) ? host_address(ctx, addr, sizeof(uint64_t)) : nullptr;
+        if (tohost == nullptr) {
+            LOG_ERROR("No tohost in memory for spike_run_until (address 0x%llx)", (unsigned long long)addr);
+            return set_error(ctx, SPIKE_ERR_ARGUMENT);
+        }
+    } else if (mode != SPIKE_RUN_PC && mode != SPIKE_RUN_INSTRET) {
+        LOG_ERROR("Invalid spike_run_until mode %d", mode);
+        return set_error(ctx, SPIKE_ERR_ARGUMENT);
+    }
+    
+    state_t* state = get_state(ctx);
+    reg_t start = state->minstret;
+    uint64_t limit = (max_steps > 0) ? (uint64_t)max_steps : UINT64_MAX;
+    uint64_t steps = 0;
+    int status = SPIKE_ERR_LIMIT;
+    
     try {
-        get_state()->XPR.write(reg_num, value);
+        for (;;) {
+            uint64_t chunk = std::min<uint64_t>(SPIKE_RUN_CHUNK, limit - steps);
+            
+            if (mode == SPIKE_RUN_PC) {
+                if (pc_matches(state->pc, target)) status = SPIKE_OK;
+                chunk = 1;
+            } else if (mode == SPIKE_RUN_INSTRET) {
+                uint64_t done = state->minstret - start;
+                if (done >= (uint64_t)target) status = SPIKE_OK;
+                chunk = std::min<uint64_t>(chunk, (uint64_t)target - done);
+            } else {
+                uint64_t value;
+                memcpy(&value, tohost, sizeof(value));
+                if (value != 0) status = SPIKE_OK;
+            }
+            if (status == SPIKE_OK || steps >= limit) break;
+            
+            if (ctx->trace != nullptr) {
+                step_traced(ctx);
+                chunk = 1;
+            } else {
+                ctx->proc->step(chunk);
+            }
+            steps += chunk;
+        }
     } catch (const std::exception& e) {
-        std::cerr << "ERROR writing integer register: " << e.what() << std::endl;
+        LOG_ERROR("Spike stopped after %llu steps: %s", (unsigned long long)steps, e.what());
+        status = SPIKE_ERR_EXECUTION;
+    }
+    
+    *retired = (int64_t)(state->minstret - start);
+    if (status == SPIKE_ERR_LIMIT) {
+        LOG_WARN("spike_run_until stopped at the %lld step limit, PC 0x%llx", (long long)max_steps,
+                 (unsigned long long)state->pc);
     }
+    return (status == SPIKE_OK) ? SPIKE_OK : set_error(ctx, status);
 }
 
 /**
- * Read program counter
- * @return Current PC value
+ * Read memory
+ * @param addr - Memory address
+ * @return 32-bit value from memory
  */
-int spike_read_pc() {
-    check_initialized();
+int spike_read_mem(void* handle, int addr) {
+    SPIKE_TIMED(handle, read_mem);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return 0;
     
     try {
-        return get_state()->pc;
+        mmu_t* mmu = ctx->proc->get_mmu();
+        return mmu->load_uint32((uint32_t)addr);
+    } catch (trap_t&) {
+        LOG_ERROR("Cannot read memory at 0x%08x: address not mapped", (uint32_t)addr);
+        set_error(ctx, SPIKE_ERR_EXECUTION);
+        return 0;
     } catch (const std::exception& e) {
-        std::cerr << "ERROR reading PC: " << e.what() << std::endl;
+        LOG_ERROR("Cannot read memory at 0x%08x: %s", (uint32_t)addr, e.what());
+        set_error(ctx, SPIKE_ERR_EXECUTION);
         return 0;
     }
 }
 
 /**
- * Write program counter
- * @param pc_value - New PC value
+ * Write memory
+ * @param addr - Memory address
+ * @param data - 32-bit value to write
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
  */
-void spike_write_pc(int pc_value) {
-    check_initialized();
+int spike_write_mem(void* handle, int addr, int data) {
+    SPIKE_TIMED(handle, write_mem);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
     
     try {
-        get_state()->pc = pc_value;
+        mmu_t* mmu = ctx->proc->get_mmu();
+        mmu->store_uint32((uint32_t)addr, data);
+        return SPIKE_OK;
+    } catch (trap_t&) {
+        LOG_ERROR("Cannot write memory at 0x%08x: address not mapped", (uint32_t)addr);
+        return set_error(ctx, SPIKE_ERR_EXECUTION);
     } catch (const std::exception& e) {
-        std::cerr << "ERROR writing PC: " << e.what() << std::endl;
+        LOG_ERROR("Cannot write memory at 0x%08x: %s", (uint32_t)addr, e.what());
+        return set_error(ctx, SPIKE_ERR_EXECUTION);
     }
 }
 
 /**
- * Read CSR (Control and Status Register)
- * @param csr_addr - CSR address
- * @return CSR value
+ * Resolve a block transfer to host memory
+ * @return Host address of the block, nullptr (with the error recorded)
+ *         unless one region of the memory map holds all of it
+ */
+static char* mem_block(spike_ctx_t* ctx, const char* caller, int addr, int words) {
+    char* host = host_address(ctx, (uint32_t)addr, (uint64_t)words * sizeof(uint32_t));
+    if (host == nullptr) {
+        LOG_ERROR("%s: %d words at 0x%08x are outside the memory map", caller, words, (uint32_t)addr);
+        set_error(ctx, SPIKE_ERR_ARGUMENT);
+    }
+    return host;
+}
+
+/**
+ * Read a block of memory in one call
+ * @param addr - Address of the first word
+ * @param data - Open array of 32-bit words, filled from addr upwards
+ * @return Number of words read, or a negative SPIKE_ERR_* code
+ *
+ * The block is bounds checked once against the memory map and copied
+ * from Spike's backing store, without going through the MMU.
  */
-int spike_read_csr(int csr_addr) {
-    check_initialized();
+int spike_read_mem_block(void* handle, int addr, const svOpenArrayHandle data) {
+    SPIKE_TIMED(handle, read_mem_block);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
     
-    try {
-        // Special handling for FCSR (0x003)
-        if (csr_addr == 0x003) {
-            return get_state()->fcsr;
+    int words = svSize(data, 1);
+    const char* src = mem_block(ctx, "spike_read_mem_block", addr, words);
+    if (src == nullptr) return SPIKE_ERR_ARGUMENT;
+    
+    uint32_t* dst = (uint32_t*)svGetArrayPtr(data);
+    
+    if (dst != nullptr) {
+        memcpy(dst, src, (size_t)words * sizeof(uint32_t));
+    } else {
+        int lo = svLow(data, 1);
+        for (int i = 0; i < words; i++) {
+            memcpy(svGetArrElemPtr1(data, lo + i), src + (size_t)i * sizeof(uint32_t), sizeof(uint32_t));
         }
-        // Add other CSRs as needed
-        return 0;
-    } catch (const std::exception& e) {
-        std::cerr << "ERROR reading CSR: " << e.what() << std::endl;
-        return 0;
     }
+    
+    return words;
 }
 
 /**
- * Write CSR (Control and Status Register)
- * @param csr_addr - CSR address
- * @param value - Value to write
+ * Write a block of memory in one call
+ * @param addr - Address of the first word
+ * @param data - Open array of 32-bit words to store from addr upwards
+ * @return Number of words written, or a negative SPIKE_ERR_* code
+ *
+ * Like spike_read_mem_block(), a single bounds check and a copy into
+ * Spike's backing store. The instruction cache is flushed afterwards
+ * since the block may hold code.
  */
-void spike_write_csr(int csr_addr, int value) {
-    check_initialized();
+int spike_write_mem_block(void* handle, int addr, const svOpenArrayHandle data) {
+    SPIKE_TIMED(handle, write_mem_block);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
     
-    try {
-        // Special handling for FCSR (0x003)
-        if (csr_addr == 0x003) {
-            get_state()->fcsr = value;
+    int words = svSize(data, 1);
+    char* dst = mem_block(ctx, "spike_write_mem_block", addr, words);
+    if (dst == nullptr) return SPIKE_ERR_ARGUMENT;
+    
+    const uint32_t* src = (const uint32_t*)svGetArrayPtr(data);
+    
+    if (src != nullptr) {
+        memcpy(dst, src, (size_t)words * sizeof(uint32_t));
+    } else {
+        int lo = svLow(data, 1);
+        for (int i = 0; i < words; i++) {
+            memcpy(dst + (size_t)i * sizeof(uint32_t), svGetArrElemPtr1(data, lo + i), sizeof(uint32_t));
         }
-        // Add other CSRs as needed
-    } catch (const std::exception& e) {
-        std::cerr << "ERROR writing CSR: " << e.what() << std::endl;
     }
+    
+    ctx->proc->get_mmu()->flush_icache();
+    return words;
 }
 
 /**
- * Execute a single instruction
- * @param instruction - 32-bit instruction encoding
- * @return 0 on success, non-zero on error
+ * Digest a memory range in one call
+ * @param addr - Address of the first byte
+ * @param size - Bytes in the range, which must lie in one memory region
+ * @param digest - Set to the digest
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ *
+ * The range is split at SPIKE_DIGEST_PAGE (4KB) address boundaries and
+ * each piece hashed with XXH64; the digest is the XXH64 of those hashes
+ * in address order, as 64-bit little-endian words. spike_image_digest()
+ * computes the same over an array holding the expected contents.
+ *
+ * Page hashes are cached and the pages write-protected, so later calls
+ * only rehash pages written since: repeated end-of-test equivalence
+ * checks cost O(dirty pages), not O(memory size).
  */
-int spike_execute_instruction(int instruction) {
-    check_initialized();
+int spike_mem_digest(void* handle, int addr, int size, int64_t* digest) {
+    SPIKE_TIMED(handle, mem_digest);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
     
-    try {
-        // Store instruction in memory at current PC
-        reg_t pc = get_state()->pc;
-        mmu_t* mmu = get_processor()->get_mmu();
-        
-        // Write instruction to memory
-        mmu->store_uint32(pc, instruction);
-        
-        // Execute one instruction
-        get_processor()->step(1);
-        
-        return 0;
-    } catch (const std::exception& e) {
-        std::cerr << "ERROR executing instruction 0x" << std::hex << instruction 
-                  << ": " << e.what() << std::endl;
-        return -1;
+    std::vector<uint64_t> hashes;
+    int status = mem_page_hashes(ctx, (uint32_t)addr, (uint32_t)size, hashes);
+    if (status != SPIKE_OK) return set_error(ctx, status);
+    
+    *digest = (int64_t)xxh64(hashes.data(), hashes.size() * sizeof(uint64_t));
+    return SPIKE_OK;
+}
+
+/**
+ * Hash each page of a memory range, to locate the pages that differ
+ * from a reference
+ * @param hashes - Open array of longint, at least one element per
+ *                 SPIKE_DIGEST_PAGE piece of the range (see spike_mem_digest())
+ * @return Number of pieces hashed, or a negative SPIKE_ERR_* code
+ */
+int spike_mem_page_hashes(void* handle, int addr, int size, const svOpenArrayHandle hashes) {
+    SPIKE_TIMED(handle, mem_page_hashes);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    std::vector<uint64_t> pages;
+    int status = mem_page_hashes(ctx, (uint32_t)addr, (uint32_t)size, pages);
+    if (status != SPIKE_OK) return set_error(ctx, status);
+    
+    if (svSize(hashes, 1) < (int)pages.size()) {
+        LOG_ERROR("spike_mem_page_hashes needs %zu hashes, got %d", pages.size(), svSize(hashes, 1));
+        return set_error(ctx, SPIKE_ERR_ARGUMENT);
+    }
+    
+    int lo = svLow(hashes, 1);
+    for (size_t i = 0; i < pages.size(); i++) {
+        memcpy(svGetArrElemPtr1(hashes, lo + (int)i), &pages[i], sizeof(uint64_t));
     }
+    return (int)pages.size();
 }
 
 /**
- * Step one instruction (without specifying instruction)
- * @return 0 on success, non-zero on error
+ * Digest an array of words as if it were memory at addr
+ * @param words - Open array of 32-bit words, e.g. the DUT's data memory
+ * @param digest - Set to what spike_mem_digest() returns for memory
+ *                 holding these words
+ * @return SPIKE_OK
  */
-int spike_step_one() {
-    check_initialized();
+int spike_image_digest(int addr, const svOpenArrayHandle words, int64_t* digest) {
+    size_t size = (size_t)svSize(words, 1) * sizeof(uint32_t);
+    const char* data = (const char*)svGetArrayPtr(words);
+    std::vector<char> copy;
     
-    try {
-        get_processor()->step(1);
-        return 0;
-    } catch (const std::exception& e) {
-        std::cerr << "ERROR stepping: " << e.what() << std::endl;
-        return -1;
+    if (data == nullptr) {
+        int lo = svLow(words, 1);
+        copy.resize(size);
+        for (int i = 0; i < svSize(words, 1); i++) {
+            memcpy(&copy[(size_t)i * sizeof(uint32_t)], svGetArrElemPtr1(words, lo + i), sizeof(uint32_t));
+        }
+        data = copy.data();
     }
+    
+    std::vector<uint64_t> hashes;
+    hash_pieces(data, (uint32_t)addr, size, hashes);
+    *digest = (int64_t)xxh64(hashes.data(), hashes.size() * sizeof(uint64_t));
+    return SPIKE_OK;
 }
 
 /**
- * Read memory
- * @param addr - Memory address
- * @return 32-bit value from memory
+ * Start or stop FP functional coverage on the commit path
+ * @param enable - Nonzero to sample every instruction retired from now on
+ * @return SPIKE_OK, or a negative SPIKE_ERR_* code
+ *
+ * Bins (spike_coverage.h) accumulate across spike_reset() and are kept
+ * when sampling stops. Every execute, batch, async and replay path is
+ * sampled; spike_step_one() and spike_run_until() are not.
  */
-int spike_read_mem(int addr) {
-    check_initialized();
+int spike_coverage_enable(void* handle, int enable) {
+    SPIKE_TIMED(handle, coverage_enable);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
     
-    try {
-        mmu_t* mmu = get_processor()->get_mmu();
-        return mmu->load_uint32(addr);
-    } catch (const std::exception& e) {
-        std::cerr << "ERROR reading memory at 0x" << std::hex << addr 
-                  << ": " << e.what() << std::endl;
-        return 0;
+    if (ctx->coverage == nullptr) {
+        if (!enable) return SPIKE_OK;
+        ctx->coverage = new spike_coverage_t();
     }
+    ctx->coverage->sampling = (enable != 0);
+    return SPIKE_OK;
 }
 
 /**
- * Write memory
- * @param addr - Memory address
- * @param data - 32-bit value to write
+ * Write the coverage bitmap for spike_cov_merge
+ * @param path - Output file (spike_coverage.h format), replaced if it exists
+ * @return Number of bins hit, or a negative SPIKE_ERR_* code
+ *
+ * Runs in parallel should write separate files; spike_cov_merge ORs them
+ * and prints the combined report.
  */
-void spike_write_mem(int addr, int data) {
-    check_initialized();
+int spike_coverage_write(void* handle, const char* path) {
+    SPIKE_TIMED(handle, coverage_write);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
     
-    try {
-        mmu_t* mmu = get_processor()->get_mmu();
-        mmu->store_uint32(addr, data);
-    } catch (const std::exception& e) {
-        std::cerr << "ERROR writing memory at 0x" << std::hex << addr 
-                  << ": " << e.what() << std::endl;
+    if (ctx->coverage == nullptr) {
+        LOG_ERROR("spike_coverage_write: coverage was never enabled");
+        return set_error(ctx, SPIKE_ERR_STATE);
+    }
+    
+    spike_cov_header_t header = {};
+    memcpy(header.magic, SPIKE_COV_MAGIC, sizeof(header.magic));
+    header.version = SPIKE_COV_VERSION;
+    header.bins = SPIKE_COV_BINS;
+    header.samples = ctx->coverage->samples;
+    header.runs = 1;
+    
+    FILE* file = fopen(path, "wb");
+    bool ok = file != nullptr &&
+              fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(ctx->coverage->bins, sizeof(uint64_t), SPIKE_COV_WORDS, file) == SPIKE_COV_WORDS;
+    if (file != nullptr) ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        LOG_ERROR("Cannot write coverage %s", path);
+        return set_error(ctx, SPIKE_ERR_IO);
+    }
+    
+    int hit = 0;
+    for (uint64_t word : ctx->coverage->bins) hit += __builtin_popcountll(word);
+    return hit;
+}
+
+/**
+ * Covered and reachable bins per coverpoint
+ * @param counts - Open array of at least 2 * SPIKE_COV_GROUPS ints: for
+ *                 each SPIKE_COV_GROUP_*, bins hit then bins reachable
+ * @return Instructions sampled (saturated to int), or a negative
+ *         SPIKE_ERR_* code
+ */
+int spike_coverage_counts(void* handle, const svOpenArrayHandle counts) {
+    SPIKE_TIMED(handle, coverage_counts);
+    spike_ctx_t* ctx = check_initialized(handle);
+    if (ctx == nullptr) return SPIKE_ERR_NOT_INITIALIZED;
+    
+    if (svSize(counts, 1) < 2 * SPIKE_COV_GROUPS) {
+        LOG_ERROR("spike_coverage_counts needs %d words, got %d", 2 * SPIKE_COV_GROUPS, svSize(counts, 1));
+        return set_error(ctx, SPIKE_ERR_ARGUMENT);
+    }
+    
+    int hit[SPIKE_COV_GROUPS] = {}, reachable[SPIKE_COV_GROUPS] = {};
+    for (uint32_t bin = 0; bin < SPIKE_COV_BINS; bin++) {
+        int group = spike_cov_bin_group(bin);
+        if (group < 0) continue;
+        reachable[group]++;
+        if (ctx->coverage != nullptr && ((ctx->coverage->bins[bin / 64] >> (bin % 64)) & 1)) hit[group]++;
+    }
+    
+    int lo = svLow(counts, 1);
+    for (int g = 0; g < SPIKE_COV_GROUPS; g++) {
+        *(int*)svGetArrElemPtr1(counts, lo + 2 * g) = hit[g];
+        *(int*)svGetArrElemPtr1(counts, lo + 2 * g + 1) = reachable[g];
     }
+    
+    uint64_t samples = ctx->coverage != nullptr ? ctx->coverage->samples : 0;
+    return samples > 0x7FFFFFFF ? 0x7FFFFFFF : (int)samples;
 }
 
 } // extern "C"